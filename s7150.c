@@ -45,10 +45,36 @@
  2016-02-17     updated doc (JHa)
  2017-01-06     updated doc (JHa)
  2025-08-11     moved everything to GitHub (JHa)
+ 2026-10-18     shadow of instrument settings, only changed fields are
+                sent and merged into one write; bus transactions counted;
+                serial poll; fixed-format decoder (see s7150fmt.h) and
+                its verification against recorded data (-V);
+                binary files with exact fixed-point values (-b, -X);
+                audit file with raw bytes where needed (-R, -C);
+                data to stdout ('-') and clean stop on SIGTERM, for
+                use with s7150sup; output plugins (-P, see s7150sink.h)
+                fed in batches by a writer thread; back-pressure
+                policy per plugin, with spill to disk (-Q);
+                committed length for readers during the run;
+                display policy on/off/auto (-D); oversampling on
+                the host with standard error per sample (-O);
+                adaptive sampling rate (-A); settling detector (-S)
+                to hold off logging (-H) and to stop (-E); line
+                frequency 50/60 Hz or detected (-L); plugins are
+                closed by their writer thread; samples formatted
+                once for all plugins, failing plugins switched off,
+                CPU time per plugin; quantiles of the readings
+                (t-digest, see s7150td.h), saved for merging (-K);
+                histogram of the counts per range with DNL/INL (-G);
+                online fit of an exponential approach, with the
+                final value predicted (-x); step detection (CUSUM)
+                with events sidecar and capture at the fast rate (-J);
+                summary of the readings in the footer (text) or the
+                header (binary), for s7150cat
 
  This should compile with any C compiler, something like:
 
- gcc -Wall -O2 -lgpib -o s7150 s7150.c
+ gcc -Wall -O2 -o s7150 s7150.c -lgpib -lm -lpthread -ldl
 
  To compile this for the S7150plus, either enable the PLUS flag below
  or specify it at the compiler command line (-DPLUS)
@@ -57,7 +83,7 @@
 
 */
 
-#define VERSION "V20250811"     /* String! */
+#define VERSION "V20261018"     /* String! */
 
 //#define DEBUG             /* diagnostic mode, for development only */
 //#define PLUS                /* enable this for Solartron S7150plus */
@@ -68,10 +94,18 @@
 #include <string.h>
 #include <errno.h>          /* command line reading */
 #include <unistd.h>
+#include <fcntl.h>          /* commit sidecar */
 #include <termios.h>        /* kbhit() */
+#include <signal.h>         /* clean stop on SIGTERM */
 #include <sys/io.h>
 #include <sys/time.h>       /* clock timing */
+#include <math.h>           /* NAN */
+#include <pthread.h>        /* writer thread for output plugins */
+#include <dlfcn.h>          /* loading output plugins */
 #include "gpib/ib.h"
+#include "s7150fmt.h"       /* decoding of readings */
+#include "s7150sink.h"      /* output plugins */
+#include "s7150td.h"        /* quantiles */
 
 #define MAXLEN   90         /* text buffers etc */
 #define ESC      27
@@ -82,6 +116,23 @@
 
 #define GPIB_BOARD_ID 0     /* GPIB card #, default is 0 */
 
+#define MAXSINK   8         /* max. number of output plugins */
+#define QSIZE  4096         /* samples queued for the writer thread */
+#define QBATCH  512         /* wake up writer thread when this many are queued */
+#define QLIM   (QSIZE-QBATCH)   /* max. samples waiting; the rest is for the batch in work */
+#define SINK_MAXERR  10     /* switch a plugin off after this many failed writes in a row */
+
+#define OS_FREQ  10.0       /* -O: rate for s7150_setup(), i.e. I1 (40 ms) */
+
+#define MAINS      50       /* line frequency (Hz), unless -L says otherwise */
+#define MAINS_SEC  2.0      /* -L auto: s of fast readings to look at */
+#define MAINS_SNR 10.0      /* -L auto: power ratio needed to decide */
+#define MAINS_NBG   10      /* -L auto: frequencies for the background */
+
+#define AD_FREQ 100.0       /* -A: fast rate for s7150_setup(), i.e. I0 (6.7 ms) */
+#define AD_TAU   10.0       /* -A: time constant (s) of the running mean */
+#define AD_QUIET 60.0       /* -A: default s without activity before slowing down */
+
 /* --- stuff for reading the command line --- */
 
 char *optarg;               /* global: pointer to argument of current option */
@@ -99,19 +150,236 @@ void    close_keyboard(void);
 int     kbhit(void);
 int     readch(void);
 
+/* --- set by SIGTERM/SIGINT, e.g. from s7150sup ---- */
+
+static volatile sig_atomic_t got_signal = 0;
+
+void    on_signal (int sig);
+
 /* --- miscellaneous function prototypes ---- */
 
 double  timeinfo (void);
 int     strclean (char *buf);
 int     GetOpt (int argc, char *argv[], char *optionS);
+int     verify (const char *fname);
+int     export (const char *fname);
+int     audit_write (FILE *fp, const unsigned long nrec, const uint32_t crc, \
+                     const struct s7150_raw *raw, const unsigned long nraw);
+int     audit_check (const char *fname);
+void    quantiles (FILE *fp, struct s7150_td *td);
+
+/* Serial poll status byte. Only RQS is defined by IEEE-488; what the
+   7150 reports in the other bits is not documented here, so they are
+   reserved: shown as they are, but not interpreted. */
+
+#define ST_RQS      0x40    /* instrument requests service */
+#define ST_RESERVED 0xbf    /* all other bits */
+
+/* --- shadow of the instrument state ---- */
+
+struct s7150_dev
+    {
+    int     ud;             /* unit descriptor as delivered by ibdev() */
+    int     pad;            /* GPIB primary address */
+    int     display;        /* last settings sent to the instrument, */
+    int     fun;            /* -1 = unknown (i.e. must be sent) */
+    int     range;
+    int     integ;
+    int     mains;          /* line frequency in Hz, for oversampling */
+    char    pending[MAXLEN];    /* commands to be merged into next write */
+    unsigned long nwrt;     /* bus transactions: writes */
+    unsigned long nrd;      /* bus transactions: reads */
+    unsigned long nsetup;   /* number of reconfigurations requested */
+    unsigned long nsetwrt;  /* ... and the writes they actually needed */
+    char    raw[S7150_RAWLEN+1];    /* last reading as received, incl. CR */
+    int     rawlen;         /* ... and its length */
+    int     status;         /* last serial poll status byte, -1 = none */
+    unsigned long npoll;    /* serial polls done ... */
+    unsigned long nbad;     /* ... and how many of them had RQS set */
+    double  tpoll;          /* total time spent polling, in s */
+    };
+
+/* --- front panel display ---- */
+
+/* with its display on, the 7150 manages about 10 readings/s, with the
+   display blanked about 24/s (free-running, see README) */
+enum dsp_policy { DSP_ON = 0, DSP_OFF, DSP_AUTO };
+static const char *dsp_names[] = { "on", "off", "auto" };
+
+#define DSP_MAXHZ   10.0    /* highest rate with the display on */
+#define DSP_SHOW     1.0    /* s the display is on when shown now and then */
+
+/* --- output plugins and the writer threads feeding them ---- */
+
+/* what to do with a new sample when a plugin's queue is full */
+enum sink_policy { BP_BLOCK = 0, BP_OLDEST, BP_NEWEST, BP_SPILL };
+static const char *bp_names[] = { "block", "oldest", "newest", "spill" };
+
+struct sink
+    {
+    char    spec[MAXLEN];   /* lib.so[:arg] as given with -P */
+    int     policy;         /* enum sink_policy, from -Q */
+    char    spilldir[MAXLEN];   /* ... and where to spill */
+    void    *lib;           /* as delivered by dlopen() */
+    const struct s7150_sinkops *ops;
+    void    *ctx;           /* the plugin's own data */
+    double  t0;             /* acquisition start, for the lag */
+    pthread_t thread;       /* the writer thread of this plugin */
+
+    /* ring buffer between acquisition loop and writer thread; the
+       counters only ever increase, the slot is counter % QSIZE */
+    pthread_mutex_t lock;
+    pthread_cond_t  more;   /* signalled when samples are added */
+    pthread_cond_t  room;   /* signalled when slots become free */
+    unsigned long head;     /* samples put in so far */
+    unsigned long next;     /* ... taken by the writer thread or dropped */
+    unsigned long tail;     /* ... whose slot can be used again */
+    int     busy;           /* writer thread is at work on [tail, next) */
+    int     flush;          /* flush requested */
+    int     stop;           /* acquisition finished ... */
+    const struct s7150_runinfo *run;    /* ... with this stop time */
+    struct  s7150_sample q[QSIZE];
+
+    /* spill file: once the queue was full, all samples go there
+       until the writer thread has caught up again */
+    int     spillfd;
+    unsigned long nspill;   /* samples in spill file ... */
+    unsigned long nreplay;  /* ... of which handed to the plugin */
+
+    unsigned long ncall;    /* write calls ... */
+    unsigned long nsamp;    /* ... samples passed in these calls */
+    unsigned long nerr;     /* ... and calls that failed */
+    unsigned long nfail;    /* failed write calls in a row ... */
+    int     off;            /* ... too many: plugin switched off */
+    unsigned long ndrop;    /* samples dropped (-Q oldest/newest) */
+    unsigned long maxdepth; /* max. samples waiting */
+    unsigned long long spilled; /* bytes ever written to the spill file */
+    double  twrite;         /* time spent in write(), total ... */
+    double  tmax;           /* ... and the longest call */
+    double  tflush;         /* time spent in flush() */
+    double  tput;           /* time the acquisition loop spent queuing */
+    double  tcpu;           /* CPU time of the writer thread */
+    double  maxlag;         /* max. time a sample had to wait, in s */
+    };
+
+static struct sink sinks[MAXSINK];
+static int nsink = 0;
+
+int     sink_load (struct sink *k, const struct s7150_runinfo *run);
+void    *sink_thread (void *arg);
+void    sink_put (const struct s7150_sample *smp);
+void    sink_flush (void);
+void    sink_status (FILE *fp);
+void    sink_done (const struct s7150_runinfo *run);
+
+/* --- settling detector: stable = no more than 'band' between min and
+   max, and a slope of at most 'slope', over the last 'win' seconds ---- */
+
+struct settle
+    {
+    double  win;            /* window, in s */
+    double  band;           /* max. max-min in the window */
+    double  slope;          /* max. |slope|, per min */
+    double  tfirst;         /* time of the first reading ... */
+    double  vref;           /* ... and its value; sums are relative to these */
+    double  *t, *v;         /* ring of the readings in the window */
+    unsigned long *qmin;    /* reading numbers of rising values: min first */
+    unsigned long *qmax;    /* ... and of falling values: max first */
+    unsigned long size;     /* slots in the rings, a power of 2 */
+    unsigned long head;     /* readings added ... */
+    unsigned long tail;     /* ... and gone out of the window */
+    unsigned long minh, mint, maxh, maxt;   /* the two queues, as counters */
+    double  st, sv, stt, stv;   /* sums for the regression line */
+    double  width, rate;    /* last max-min and slope (per min) */
+    };
+
+int     settle_init (struct settle *s, const double win, const double band, const double slope);
+int     settle_grow (struct settle *s);
+int     settle_add (struct settle *s, const double t, const double v);
+void    settle_free (struct settle *s);
+
+/* --- histogram of the counts, per range (-G) ---- */
+
+#define HG_MAXRANGE  16     /* ranges (unit, AC/DC, exponent) kept apart */
+#define HG_MINSIZE 4096     /* bins of a histogram, at first */
+#define HG_MINEXP   100     /* -G noise: DNL only where this many are expected */
+
+enum hg_ref { HG_RAMP = 0, HG_NOISE };
+static const char *hg_names[] = { "ramp", "noise" };
+
+struct hist
+    {
+    uint8_t unit, acdc;     /* the range: unit, AC/DC ... */
+    int8_t  exp;            /* ... and exponent of the readings */
+    int32_t lo;             /* count of bin[0] ... */
+    uint32_t size;          /* ... and number of bins */
+    uint32_t *bin;          /* readings per count */
+    uint64_t n;             /* readings in total */
+    };
+
+int     hist_add (struct hist *h, int *nh, const struct s7150_reading *r);
+void    hist_write (FILE *fp, const struct hist *h, const int ref);
+
+/* --- online fit of y = c + A*exp(-t/tau) (-x) ---- */
+
+#define XF_P0     1e12      /* initial covariance: knows nothing */
+#define XF_MINN     10      /* readings before there is an estimate */
+#define XF_SPAN    2.0      /* -x stops after this many tau at least, ... */
+#define XF_HOLD     10      /* ... when c was within tol this often in a row */
+
+struct expfit
+    {
+    double  t0, y0;         /* first reading: origin of t and y */
+    double  tp, up;         /* previous reading, relative to these ... */
+    double  area;           /* ... and the integral of y-y0 up to it */
+    double  th[3];          /* u = th0 + th1*area + th2*t, i.e. ... */
+    double  P[3][3];        /* ... -1/tau and c/tau; their covariance / s^2 */
+    double  sse;            /* sum of squared residuals */
+    unsigned long n;        /* readings */
+    double  c, tau;         /* estimate: final value and time constant ... */
+    double  sc, stau;       /* ... and their standard deviations */
+    unsigned long nin;      /* estimates in a row within tol (expfit_known()) */
+    };
+
+void    expfit_init (struct expfit *f);
+int     expfit_add (struct expfit *f, const double t, const double y);
+int     expfit_known (struct expfit *f, const double tol);
+
+/* --- detection of steps (-J) ---- */
+
+#define CP_H       5.0      /* threshold in steps: a step is found after ~10 readings */
+
+struct cpd
+    {
+    double  step;           /* smallest step to detect ... */
+    double  h;              /* ... and threshold of the sums */
+    double  s0;             /* sum of the readings since the last step ... */
+    unsigned long n0;       /* ... and their number */
+    double  g[2];           /* CUSUM of deviations upwards, downwards */
+    double  sx[2];          /* sum of the readings since g was 0 ... */
+    unsigned long nx[2];    /* ... their number ... */
+    double  tx[2];          /* ... and the time of the first */
+    double  t, mag;         /* last step: time (s), size ... */
+    double  before, after;  /* ... and the means on both sides */
+    };
+
+void    cpd_init (struct cpd *c, const double step, const double h);
+int     cpd_add (struct cpd *c, const double t, const double x);
 
 /* --- s7150-related function prototypes ---- */
 
-int     s7150_open (const int adr);
-int     s7150_setup (const int dvm, const int display, \
+int     s7150_open (struct s7150_dev *dev, const int pad);
+int     s7150_setup (struct s7150_dev *dev, const int display, \
                      const int fun, const int range, const float freq);
-int     s7150_read (const int dvm, const int delay, char *result);
-int     s7150_close (const int adr);
+int     s7150_read (struct s7150_dev *dev, const int delay, char *result);
+int     s7150_oversample (struct s7150_dev *dev, const double tend, char *result, \
+                          struct s7150_reading *mean, double *se, unsigned long *k);
+int     s7150_close (struct s7150_dev *dev);
+int     s7150_mains (struct s7150_dev *dev, const int fun, const int range);
+int     s7150_write (struct s7150_dev *dev, const char *cmd);
+void    s7150_stats (const struct s7150_dev *dev);
+int     s7150_poll (struct s7150_dev *dev);
+void    s7150_status (const struct s7150_dev *dev, FILE *fp);
 
 /* --- things to make life easier ---- */
 
@@ -142,18 +410,50 @@ static char *disclaimer =
 "WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A\n"
 "PARTICULAR PURPOSE. See the GNU General Public License for details.\n";
 
-static char *msg = "\nSyntax: s7150 [-h] [-a id] [-m mode] [-t dt]  [-T timeout] [-d] [-w samp] [-f] [-c \"txt\"] [-g /path/to/gnuplot] [-n] datafile"
+static char *msg = "\nSyntax: s7150 [-h] [-a id] [-m mode] [-t dt]  [-T timeout] [-d] [-D policy] [-O] [-A thr[:sec]] [-S win:band[:slope]] [-H] [-E min] [-L Hz] [-G file[:ramp|noise]] [-K file] [-x tol] [-J step[:h[:sec]]] [-w samp] [-p samp] [-f] [-c \"txt\"] [-g /path/to/gnuplot] [-n] [-Q policy] [-P lib[:arg]] [-b] [-R] [-X file] [-C file] [-V file] datafile"
 "\n        -h       this help screen"
 "\n        -a id    use instrument at GPIB address 'id' (default is 16)"
 "\n        -m mod   measurement mode (default is DCV)"
 "\n        -t dt    delay between measurements in 0.1 s (default is 10)"
-"\n        -d       disable instrument display (default is on)"
+"\n        -d       disable instrument display (default is on), same as -D off"
+"\n        -D pol   instrument display on, off, or auto[:sec]: off if the rate"
+"\n                 needs it, and then shown for 1 s every 'sec' seconds"
+"\n        -O       oversample: read as fast as possible, log the mean of each"
+"\n                 interval dt and its standard error (text files only)"
+"\n        -A thr   adaptive: as fast as possible while the signal moves by more"
+"\n                 than thr, back to dt after 'sec' s of quiet (-A thr:sec, default 60)"
+"\n        -S w:b   stable = within a band b and a slope of at most b per w"
+"\n                 (or -S w:b:slope, per min) over the last w seconds"
+"\n        -H       hold off logging until stable (needs -S)"
+"\n        -E min   stop when stable for this time (in minutes; needs -S)"
+"\n        -L Hz    line frequency: 50 (default), 60, or auto (detected from fast"
+"\n                 readings); -O averages over whole cycles, and so does a"
+"\n                 text file at 1.5 to 10 Hz on a 60 Hz line"
+"\n        -G file  histogram of the counts per range, with DNL/INL, to file;"
+"\n                 file:noise for a constant input (default: file:ramp)"
+"\n        -K file  save the distribution of the readings (t-digest) to file,"
+"\n                 to be merged with others by s7150q -M"
+"\n        -x tol   fit an exponential approach, show the final value it leads"
+"\n                 to; stop when that is known within tol (0 = don't stop)"
+"\n        -J s     detect steps of at least s, note them in the data file and"
+"\n                 in file.events; -J s:h:sec sets the threshold (h steps,"
+"\n                 default 5) and reads fast for sec s after a step"
 "\n        -w x     force write to disk every x samples (default is 100)"
+"\n        -p x     serial-poll instrument status every x samples (default 0 = off)"
 "\n        -f       force overwriting of existing file"
 "\n        -T min   stop acquisition after this time (in minutes; default 0 = endless)"
 "\n        -c txt   comment text"
 "\n        -g       specify path/to/gnuplot (if not in your current PATH)"
-"\n        -n       no graphics\n\n";
+"\n        -n       no graphics"
+"\n        -P lib   load output plugin lib.so[:arg] (up to 8 times)"
+"\n        -Q pol   when a plugin falls behind: block, oldest, newest (= drop these)"
+"\n                 or spill[:dir] to disk (default block; for the -P after it)"
+"\n        datafile '-' writes the data to stdout (and the display to stderr)"
+"\n        -b       binary data file (exact digits, 16 bytes per reading)"
+"\n        -X file  convert binary data file to text (on stdout)"
+"\n        -R       binary data file plus audit file with raw readings (implies -b)"
+"\n        -C file  check binary data file against its audit file"
+"\n        -V file  check the decoder against the readings in an existing data file\n\n";
 
 #ifdef PLUS
 static char *ylabels[] = {"V","V","kOhms","mA","mA","mV","deg C","deg F"};
@@ -161,13 +461,38 @@ static char *ylabels[] = {"V","V","kOhms","mA","mA","mV","deg C","deg F"};
 static char *ylabels[] = {"V","V","kOhms","mA","mA","mV"};
 #endif
 
-FILE    *outfile, *gp = NULL;
+FILE    *outfile = NULL, *audfile = NULL, *tdfile = NULL, *hgfile = NULL, *evfile = NULL, *gp = NULL;
 char    buffer[MAXLEN], filename[MAXLEN], comment[MAXLEN] = "", gnuplot[MAXLEN];
-char    do_display = 1, do_graph = 1, do_overwrite = 0;
-int     dvm, pad = 16, key, do_flush = 100, delay = 10, mode = DCV, range = 0;
-unsigned long loop = 0L;
-double  t0, t1;
-float   tstop = 0.0;
+char    do_display = 1, do_graph = 1, do_overwrite = 0, do_binary = 0, do_audit = 0, do_commit = 0, do_over = 0;
+char    hum = 0;            /* 60 Hz and I1: 2 = averaged instead (-O), 1 = not possible */
+char    do_adapt = 0, fast = 0, do_settle = 0, hold = 0, stable = 0, do_fit = 0, do_jump = 0;
+char    dslow = 1;          /* display at the slow rate, as the policy has it */
+char    regen[S7150_RAWLEN+1], audname[MAXLEN+8], commitname[MAXLEN+8], evname[MAXLEN+8], qdir[MAXLEN] = "/var/tmp";
+char    plotcmd[4*MAXLEN], tdname[MAXLEN] = "", hgname[MAXLEN] = "", stamp[32], *p;
+struct  s7150_dev dvm;
+int     i, ok, commitfd = -1, dpolicy = DSP_ON, mains = MAINS, pad = 16, key, qpolicy = BP_BLOCK, do_flush = 100, do_poll = 0, delay = 10, mode = DCV, range = 0;
+unsigned long loop = 0L, nover = 0L, nunpars = 0L, dsp_n[2] = {0L, 0L}, k, nos = 0L, nrate = 0L;
+struct  s7150_reading rd, rs, ro;
+struct  s7150_binhdr hdr;
+struct  s7150_rec rec;
+struct  s7150_sample smp;
+struct  s7150_runinfo run;
+struct  s7150_audhdr audhdr;
+struct  s7150_raw *raws = NULL;
+unsigned long nraw = 0L, nblk = 0L;
+uint32_t crc = 0;
+double  t0, t1, se = 0.0, tprev = 0.0, tdsp = 0.0, dsp_t[2] = {0.0, 0.0};
+double  v, ema = 0.0, tema = 0.0, tact = -HUGE_VAL, vmean = 0.0, vm2 = 0.0;
+float   tstop = 0.0, dperiod = 0.0, athr = 0.0, aquiet = AD_QUIET;
+float   swin = 0.0, sband = 0.0, sslope = -1.0, tsettle = 0.0;
+double  tstable = 0.0, xtol = 0.0, jstep = 0.0, jh = CP_H, jcap = 0.0, tcap = -HUGE_VAL;
+struct  settle stl;
+struct  expfit xf;
+struct  cpd cp;
+static struct s7150_td td;  /* too big for the stack */
+static struct hist hg[HG_MAXRANGE];
+int     nhg = 0, hgref = HG_RAMP;
+unsigned long nhglost = 0L, njump = 0L;
 time_t  t;
 
 
@@ -181,7 +506,7 @@ fprintf (stderr, disclaimer);
 
 /* --- decode and read the command line --- */
 
-while ((key = GetOpt(argc, argv, "hfnda:w:t:T:m:c:g:")) != EOF)
+while ((key = GetOpt(argc, argv, "hfndbROHa:w:p:t:T:m:c:g:x:A:D:E:G:J:K:L:S:P:Q:V:X:C:")) != EOF)
     switch (key)
         {
         case 'h':                    /* help me */
@@ -194,7 +519,19 @@ while ((key = GetOpt(argc, argv, "hfnda:w:t:T:m:c:g:")) != EOF)
             do_graph = 0;
             continue;
         case 'd':                    /* disable display */
-            do_display = 0;
+            dpolicy = DSP_OFF;
+            continue;
+        case 'D':                    /* display policy */
+            for (dpolicy = DSP_AUTO; dpolicy >= 0; dpolicy--)
+                if (!strncmp(optarg, dsp_names[dpolicy], strlen(dsp_names[dpolicy])))
+                    break;
+            if (dpolicy == DSP_AUTO && optarg[4] == ':')
+                sscanf (optarg+5, "%g", &dperiod);
+            if (dpolicy < 0 || dperiod < 0.0 || (dperiod > 0.0 && dperiod <= DSP_SHOW))
+                {
+                puts("Error: display must be on, off or auto[:sec], with sec > 1.");
+                return 1;
+                }
             continue;
         case 'c':
             if (strclean (optarg))    
@@ -206,6 +543,14 @@ while ((key = GetOpt(argc, argv, "hfnda:w:t:T:m:c:g:")) != EOF)
         case 'w':
             sscanf (optarg, "%5d", &do_flush);
             continue;
+        case 'p':
+            sscanf (optarg, "%5d", &do_poll);
+            if (do_poll < 0)
+                {
+                puts("Error: poll interval must be positive.");
+                return 1;
+                }
+            continue;
         case 'a':
             sscanf (optarg, "%5d", &pad);
             if (pad < 0 || pad > 30)
@@ -248,6 +593,112 @@ while ((key = GetOpt(argc, argv, "hfnda:w:t:T:m:c:g:")) != EOF)
                 }
 #endif
             continue;
+        case 'P':                    /* output plugin */
+            if (nsink == MAXSINK)
+                {
+                printf("Error: at most %d output plugins.\n", MAXSINK);
+                return 1;
+                }
+            sinks[nsink].policy = qpolicy;
+            strcpy (sinks[nsink].spilldir, qdir);
+            strncpy (sinks[nsink++].spec, optarg, MAXLEN-1);
+            continue;
+        case 'Q':                    /* back-pressure policy for next plugins */
+            for (qpolicy = BP_SPILL; qpolicy >= 0; qpolicy--)
+                if (!strncmp(optarg, bp_names[qpolicy], strlen(bp_names[qpolicy])))
+                    break;
+            if (qpolicy < 0)
+                {
+                puts("Error: policy must be block, oldest, newest or spill[:dir].");
+                return 1;
+                }
+            if (qpolicy == BP_SPILL && optarg[5] == ':')
+                strncpy (qdir, optarg+6, MAXLEN-1);
+            continue;
+        case 'b':                    /* binary data file */
+            do_binary = 1;
+            continue;
+        case 'R':                    /* binary data file plus audit file */
+            do_binary = do_audit = 1;
+            continue;
+        case 'O':                    /* oversampling */
+            do_over = 1;
+            continue;
+        case 'S':                    /* settling detector */
+            do_settle = 1;
+            if (sscanf (optarg, "%g:%g:%g", &swin, &sband, &sslope) < 2 || swin <= 0.0 || sband < 0.0)
+                {
+                puts("Error: use -S win:band[:slope], with a window > 0.");
+                return 1;
+                }
+            if (sslope < 0.0)       /* default: drift of at most the band per window */
+                sslope = sband * 60.0 / swin;
+            continue;
+        case 'L':                    /* line frequency, 0 = detect */
+            if (strcmp(optarg, "50") && strcmp(optarg, "60") && strcmp(optarg, "auto"))
+                {
+                puts("Error: use -L 50, 60 or auto.");
+                return 1;
+                }
+            mains = strcmp(optarg, "auto") ? atoi(optarg) : 0;
+            continue;
+        case 'G':                    /* histogram of the counts */
+            strncpy (hgname, optarg, MAXLEN-1);
+            if (NULL != (p = strrchr(hgname, ':')))
+                {
+                *p++ = 0;
+                for (hgref = HG_NOISE; hgref >= 0 && strcmp(p, hg_names[hgref]); hgref--)
+                    ;
+                if (hgref < 0)
+                    {
+                    puts("Error: use -G file[:ramp|noise].");
+                    return 1;
+                    }
+                }
+            continue;
+        case 'K':                    /* save quantile digest */
+            strncpy (tdname, optarg, MAXLEN-1);
+            continue;
+        case 'J':                    /* step detection */
+            do_jump = 1;
+            if (sscanf (optarg, "%lf:%lf:%lf", &jstep, &jh, &jcap) < 1 || jstep <= 0.0 || jh <= 0.0 || jcap < 0.0)
+                {
+                puts("Error: use -J step[:h[:sec]], step and h positive.");
+                return 1;
+                }
+            continue;
+        case 'x':                    /* exponential fit */
+            do_fit = 1;
+            if (sscanf (optarg, "%lf", &xtol) != 1 || xtol < 0.0)
+                {
+                puts("Error: use -x tol, a positive tolerance (0 = don't stop).");
+                return 1;
+                }
+            continue;
+        case 'H':                    /* hold off logging until stable */
+            hold = 1;
+            continue;
+        case 'E':                    /* stop when stable */
+            if (sscanf (optarg, "%g", &tsettle) != 1 || tsettle < 0.0)
+                {
+                puts("Error: use -E min, a positive time.");
+                return 1;
+                }
+            continue;
+        case 'A':                    /* adaptive rate */
+            do_adapt = 1;
+            if (sscanf (optarg, "%g:%g", &athr, &aquiet) < 1 || athr <= 0.0 || aquiet <= 0.0)
+                {
+                puts("Error: use -A thr[:sec], both positive.");
+                return 1;
+                }
+            continue;
+        case 'C':                    /* offline: check audit file, then quit */
+            return audit_check (optarg);
+        case 'V':                    /* offline: check decoder, then quit */
+            return verify (optarg);
+        case 'X':                    /* offline: binary to text, then quit */
+            return export (optarg);
         case 'r':
             /* no range check yet, this would require a lot of
                cross-checking against the range capabilities */
@@ -264,10 +715,54 @@ if (argv[optind] == NULL)       /* we need at least one parameter on cmd line */
     return 1;
     }
 
+/* the binary record has no room for the standard error */
+if (do_over && (delay == 0 || do_binary))
+    {
+    puts("Error: oversampling needs an interval (-t) and a text data file.");
+    return 1;
+    }
+if (do_over && hgname[0])
+    {
+    puts("Error: the histogram (-G) needs the codes of the instrument, not the means of -O.");
+    return 1;
+    }
+if (do_adapt && (delay == 0 || do_over))
+    {
+    puts("Error: adaptive rate needs an interval (-t) and no oversampling.");
+    return 1;
+    }
+if (jcap > 0.0 && (delay == 0 || do_over))
+    {
+    puts("Error: capture of steps (-J step:h:sec) needs an interval (-t) and no oversampling.");
+    return 1;
+    }
+if ((hold || tsettle > 0.0) && !do_settle)
+    {
+    puts("Error: -H and -E need a settling detector (-S).");
+    return 1;
+    }
+if (do_settle && 0 == settle_init(&stl, swin, sband, sslope))
+    {
+    puts("Error: out of memory.");
+    return 1;
+    }
+
 /* --- prepare output data file --- */
 
 strcpy (filename, argv[optind]);
-if ((!access(filename, 0)) && (!do_overwrite))
+if (!strcmp(filename, "-"))
+/* data to stdout, e.g. into a pipe: everything else goes to stderr */
+    {
+    if (do_audit)
+        {
+        fprintf(stderr, "Audit file needs a real data file.\n");
+        return 1;
+        }
+    outfile = fdopen(dup(STDOUT_FILENO), do_binary ? "wb" : "wt");
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    do_graph = 0;
+    }
+else if ((!access(filename, 0)) && (!do_overwrite))
 /* If file exists and overwrite is NOT forced */
     {
     fprintf (stderr, "\a\nFile '%s' exists - Overwrite? [Y/*] ", filename);
@@ -282,17 +777,74 @@ if ((!access(filename, 0)) && (!do_overwrite))
         }
     }
 
-if (NULL == (outfile = fopen(filename, "wt")))
+if (NULL == outfile && NULL == (outfile = fopen(filename, do_binary ? "wb" : "wt")))
     {
     fprintf(stderr, "Could not open '%s' for writing.\n", filename);
-    pclose(gp);
+    if (gp)
+        pclose(gp);
+    return ERR_FILE;
+    }
+
+/* tell readers how much of the file is complete: binary files in
+   their header, text files in a sidecar (see s7150fmt.h), which is
+   removed again at a clean stop */
+if (strcmp(filename, "-"))
+    {
+    do_commit = 1;
+    sprintf(commitname, "%s" S7150_COMMIT, filename);
+    if (!do_binary && (commitfd = open(commitname, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+        {
+        fprintf(stderr, "Could not open '%s' for writing.\n", commitname);
+        return ERR_FILE;
+        }
+
+    /* steps, one line each: where to look in a long run */
+    sprintf(evname, "%s.events", filename);
+    if (do_jump && NULL == (evfile = fopen(evname, "wt")))
+        {
+        fprintf(stderr, "Could not open '%s' for writing.\n", evname);
+        return ERR_FILE;
+        }
+    }
+
+/* the audit file goes next to the data file, collecting the raw
+   bytes of one block (= flush interval) at most */
+if (do_audit)
+    {
+    sprintf(audname, "%s.audit", filename);
+    if (NULL == (audfile = fopen(audname, "wb")) ||
+        NULL == (raws = calloc(do_flush, sizeof(*raws))))
+        {
+        fprintf(stderr, "Could not open '%s' for writing.\n", audname);
+        return ERR_FILE;
+        }
+    memset (&audhdr, 0, sizeof(audhdr));
+    memcpy (audhdr.magic, S7150_AUDMAGIC, 8);
+    audhdr.version = S7150_BINVER;
+    audhdr.hdrsize = sizeof(audhdr);
+    fwrite (&audhdr, sizeof(audhdr), 1, audfile);
+    }
+
+/* opened now, so a wrong name does not cost a whole run */
+s7150_td_init(&td);
+expfit_init(&xf);
+cpd_init(&cp, jstep, jh * jstep);
+if (tdname[0] && NULL == (tdfile = fopen(tdname, "wt")))
+    {
+    fprintf(stderr, "Could not open '%s' for writing.\n", tdname);
+    return ERR_FILE;
+    }
+if (hgname[0] && NULL == (hgfile = fopen(hgname, "wt")))
+    {
+    fprintf(stderr, "Could not open '%s' for writing.\n", hgname);
     return ERR_FILE;
     }
 
 /* --- real-time display: prepare gnuplot for action --- */
 
-gp = popen(gnuplot,"w");
-if (NULL == gp)
+if (do_graph)
+    gp = popen(gnuplot,"w");
+if (do_graph && NULL == gp)
     {
     fprintf(stderr, "\nCannot launch gnuplot, will continue \"as is\".\n") ;
     fflush(stderr);
@@ -306,22 +858,80 @@ if (do_graph)       /* set gnuplot display defaults */
     fflush (gp);
     }
 
+/* gnuplot can read the binary records directly: skip the header,
+   then time (us) and value (count * 10^exp) */
+if (do_binary)
+    sprintf(plotcmd, "plot '%s' binary skip=%d format='%%int64%%int32%%int8%%uint8%%uint8%%uint8' "
+            "using ($1/6e7):($2*10**$3) title ''\n", filename, (int) sizeof(hdr));
+else
+    sprintf(plotcmd, "plot '%s' title ''\n", filename);
+
 init_keyboard();    /* for kbhit() functionality */
+signal(SIGTERM, on_signal);
+signal(SIGINT, on_signal);
 
 /* preparations are finished, now let's get it going ... */
 
-dvm = s7150_open(pad);
-if (dvm == 0)
+if (0 == s7150_open(&dvm, pad))
     {
     fprintf(stderr, "Quit.\n");
-    pclose(gp);
+    if (gp)
+        pclose(gp);
     return ERR_INST;
     }
 
-if (0 == s7150_setup(dvm, do_display, mode, range, 10.0/delay))
+/* the line frequency decides on the integration time */
+if (mains == 0)
+    {
+    printf("\nLooking for the line frequency in the signal ...");
+    fflush(stdout);
+    mains = s7150_mains(&dvm, mode, range);
+    if (mains < 0)
+        {
+        fprintf(stderr, "Quit.\n");
+        if (gp)
+            pclose(gp);
+        return ERR_INST;
+        }
+    if (mains == 0)
+        {
+        printf(" not found, assuming %d Hz.", MAINS);
+        mains = MAINS;
+        }
+    else
+        printf(" %d Hz.", mains);
+    }
+dvm.mains = mains;
+
+/* where s7150_setup() takes I1 (40 ms, 2.4 cycles of 60 Hz; the 7150
+   has nothing up to 400 ms), average over whole cycles on the host,
+   as -O does, if the run allows for it; else warn */
+if (mains == 60 && !do_over && delay > 0 && 10.0/delay > 1.5 && 10.0/delay <= 10.0)
+    {
+    if (do_binary || do_adapt || jcap > 0.0 || hgname[0])
+        hum = 1;
+    else
+        {
+        do_over = 1;
+        hum = 2;
+        }
+    }
+
+/* auto: blank the display only if it would hold up the acquisition */
+if (dpolicy == DSP_AUTO)
+    do_display = (!do_over && delay > 0 && 10.0/delay <= DSP_MAXHZ);
+else
+    do_display = (dpolicy == DSP_ON);
+if (do_display)
+    dperiod = 0.0;          /* nothing to show now and then */
+dslow = do_display;
+
+/* oversampling: fast integration, the host does the averaging */
+if (0 == s7150_setup(&dvm, do_display, mode, range, do_over ? OS_FREQ : 10.0/delay))
     {
     fprintf(stderr, "Quit.\n");
-    pclose(gp);
+    if (gp)
+        pclose(gp);
     return ERR_INST;
     }
 
@@ -330,73 +940,528 @@ printf("\n  Output file :  %s", filename);
 if (strlen(comment))
 	printf("\n      Comment :  %s", comment);
 printf("\n     Sampling :  %.1f s", delay/10.0);
+if (do_over)
+    printf(", mean of all readings in that time");
+if (do_adapt)
+    printf(", fast if the signal moves by more than %g, for at least %g s", athr, aquiet);
+if (do_settle)
+    printf("\n       Stable :  within %g, slope %g/min, over %g s%s", sband, sslope, swin,
+           hold ? "; logging starts then" : "");
+if (tsettle > 0.0)
+    printf("\n   Halt after :  %g min stable", tsettle);
+if (do_fit)
+    {
+    printf("\n          Fit :  c + A*exp(-t/tau), 'x' restarts it");
+    if (xtol > 0.0)
+        printf("; halt when c is known within %g", xtol);
+    }
+printf("\n        Mains :  %d Hz", mains);
+if (hum == 2)
+    printf(", averaged over whole cycles (-O) instead of 40 ms integration");
+else if (hum == 1)
+    printf("\n      Warning :  40 ms integration covers 2.4 cycles, hum gets through (see -O)");
 printf("\n      Refresh :  %d", do_flush);
+printf("\n      Display :  %s (%s)", do_display ? "on" : "off", dsp_names[dpolicy]);
+if (dperiod > 0.0)
+    printf(", shown for %g s every %g s", DSP_SHOW, dperiod);
+if (do_poll)
+    printf("\n  Status poll :  every %d samples", do_poll);
 if (tstop > 0.0)
     printf("\n   Halt after :  %g min", tstop);
-printf("\n         Stop :  Press 'q' or ESC.\n");
+printf("\n         Stop :  Press 'q' or ESC, 's' shows instrument status.\n");
 printf("\n     Count           Time      Reading\n");
 fflush(stdout);
 
 /* Get time, write file header */
 time(&t);
-fprintf(outfile, "# s7150 " VERSION "\n");
-fprintf(outfile, "# %s\n", comment);
-fprintf(outfile, "# Acquisition start: %s", ctime(&t));
-fprintf(outfile, "# min\treadout  errflag  unit  mode\n");
 t0 = timeinfo();
+if (do_binary)
+    {
+    memset (&hdr, 0, sizeof(hdr));
+    memcpy (hdr.magic, S7150_MAGIC, 8);
+    hdr.version = S7150_BINVER;
+    hdr.hdrsize = sizeof(hdr);
+    hdr.recsize = sizeof(rec);
+    hdr.nchan = 1;
+    hdr.t0_us = (int64_t) (t0 * 1e6);
+    hdr.pad = pad;
+    hdr.mode = mode;
+    hdr.delay = delay;
+    hdr.hflags = (do_audit ? HF_AUDIT : 0) | (do_commit ? HF_COMMIT : 0);
+    strncpy (hdr.program, "s7150 " VERSION, sizeof(hdr.program)-1);
+    strncpy (hdr.comment, comment, sizeof(hdr.comment)-1);
+    fwrite (&hdr, sizeof(hdr), 1, outfile);
+    }
+else
+    {
+    fprintf(outfile, "# s7150 " VERSION "\n");
+    fprintf(outfile, "# %s\n", comment);
+    fprintf(outfile, "# Acquisition start: %s", ctime(&t));
+    fprintf(outfile, "# pad=%d mode=%d dt=%.1f t0=%.3f\n", pad, mode, delay/10.0, t0);
+    fprintf(outfile, "# min\treadout  errflag  unit  mode%s\n", do_over ? "\tmean\tstderr" : "");
+    }
+fflush (outfile);           /* readers can tell the format at once */
+if (commitfd >= 0)
+    s7150_commit(commitfd, ftell(outfile), 0);
+if (evfile)
+    {
+    fprintf(evfile, "# s7150 " VERSION ": steps of at least %g in %s, t0=%.3f\n", jstep, filename, t0);
+    fprintf(evfile, "# min\tclock\tdetected\tstep\tbefore\tafter\n");
+    fflush (evfile);
+    }
+
+/* output plugins get their samples from a thread of their own */
+memset (&run, 0, sizeof(run));
+run.abi = S7150_SINK_ABI;
+run.program = "s7150 " VERSION;
+run.datafile = filename;
+run.comment = comment;
+run.pad = pad;
+run.mode = mode;
+run.delay = delay;
+run.t0 = t0;
+for (i = 0; i < nsink; i++)
+    if (0 == sink_load(&sinks[i], &run))
+        {
+        fprintf(stderr, "Quit.\n");
+        nsink = i;          /* close those that were loaded */
+        sink_done(&run);
+        s7150_close(&dvm);
+        if (gp)
+            pclose(gp);
+        close_keyboard();
+        return ERR_FILE;
+        }
 
 key = 0;
+tdsp = dperiod;
 do  {
-    /* delay = 0 means free-running acquisition with highest speed */
-    if (0 == (s7150_read(dvm, delay, buffer)))
+    /* cheap health check: one status byte instead of a reading */
+    if (do_poll && !hold && !(loop % do_poll))
+        {
+        if (s7150_poll(&dvm) < 0)
+            {
+            fprintf(stderr, "Quit.\n");
+            if (gp)
+                pclose(gp);
+            close_keyboard();
+            return ERR_INST;
+            }
+        if (dvm.status & ST_RQS)
+            {
+            fprintf(stderr, "\n");
+            s7150_status(&dvm, stderr);
+            fprintf(stderr, "\n");
+            }
+        }
+
+    /* delay = 0 means free-running acquisition with highest speed;
+       when oversampling, a sample is the mean over the interval */
+    if (do_over)
+        {
+        t1 = delay / 10.0;      /* up to the end of the interval we are in */
+        ok = s7150_oversample(&dvm, t0 + (floor((timeinfo() - t0) / t1) + 1.0) * t1, buffer, &ro, &se, &k);
+        nos += k;
+        }
+    else
+        ok = s7150_read(&dvm, fast ? 0 : delay, buffer);
+    if (0 == ok)
         {
         fprintf(stderr, "Quit.\n");
-        pclose(gp);
+        if (gp)
+            pclose(gp);
         close_keyboard();
         return ERR_INST;
         }
 
-    t1 = (timeinfo()-t0)/60.0;
-    printf("%10lu %10.2f min    %s\r", ++loop, t1, buffer);
-    fprintf(outfile, "%.4f\t%s\n", t1, buffer); // write literally to file
+    t1 = timeinfo()-t0;
+
+    /* achieved rate, per state of the display */
+    dsp_n[(int) do_display]++;
+    dsp_t[(int) do_display] += t1 - tprev;
+    tprev = t1;
+
+    /* auto: show a value now and then (not while fast); s7150_setup()
+       only sends the "D" */
+    if (dperiod > 0.0 && !fast && t1 >= tdsp)
+        {
+        do_display = !do_display;
+        tdsp = t1 + (do_display ? DSP_SHOW : dperiod);
+        if (0 == s7150_setup(&dvm, do_display, mode, range, do_over ? OS_FREQ : 10.0/delay))
+            {
+            fprintf(stderr, "Quit.\n");
+            if (gp)
+                pclose(gp);
+            close_keyboard();
+            return ERR_INST;
+            }
+        }
+
+    /* keep track of overloads and anything we don't understand;
+       with -O, the buffer has the mean rounded to the digits shown,
+       all the rest goes by the mean with the digits it really has */
+    ok = s7150_decode(buffer, &rs);
+    rd = (ok && do_over) ? ro : rs;
+    if (!ok)
+        nunpars++;
+    else if (rd.eflag != EF_OK)
+        nover++;
+
+    /* settling: noted in the text file; logging starts when stable
+       (-H), and stops when stable for long enough (-E) */
+    if (do_settle && ok && rd.eflag == EF_OK)
+        {
+        i = settle_add(&stl, t1, s7150_value(&rd));
+        if (i < 0)
+            {
+            fprintf(stderr, "Out of memory (settling detector).\n");
+            key = ESC;
+            }
+        if (i > 0 && !stable)
+            tstable = t1;
+        if (i > 0 && hold)
+            hold = 0;
+        if (i >= 0 && i != stable && !hold && !do_binary)
+            fprintf(outfile, "# %s at %.4f min (within %g, slope %g/min)\n",
+                    i ? "stable" : "not stable", t1 / 60.0, stl.width, stl.rate);
+        if (i >= 0)
+            stable = i;
+        if (stable && tsettle > 0.0 && t1 - tstable >= 60.0 * tsettle)
+            key = ESC;
+        }
+
+    /* not yet stable: just show what we get */
+    if (hold)
+        {
+        printf("   waiting %10.2f min    %s  (within %g, slope %g/min)\r", t1 / 60.0, buffer,
+               stl.width, stl.rate);
+        fflush (stdout);
+        if (got_signal || (tstop > 0.0 && t1 / 60.0 > tstop))
+            key = ESC;
+        else if (kbhit())
+            key = readch();
+        continue;
+        }
+
+    s7150_torec(ok ? &rd : NULL, (int64_t) (t1 * 1e6), 0, &rec);
+    if (fast)
+        rec.flags |= RF_FAST;
+    if (ok && rd.eflag == EF_OK)
+        {
+        v = s7150_value(&rd);
+        s7150_td_add(&td, v, 1.0);
+        vm2 += (v - vmean) * (v - vmean) * (td.n - 1.0) / td.n;
+        vmean += (v - vmean) / td.n;
+        }
+    if (hgfile && ok && rd.eflag == EF_OK)
+        {
+        i = hist_add(hg, &nhg, &rd);
+        if (i < 0)
+            {
+            fprintf(stderr, "Out of memory (histogram).\n");
+            key = ESC;
+            }
+        if (i == 0)
+            nhglost++;
+        }
+
+    /* where the signal is heading, and whether that is known well
+       enough (2 sigma) to stop here */
+    if (do_fit && ok && rd.eflag == EF_OK)
+        {
+        expfit_add(&xf, t1, s7150_value(&rd));
+        if (xtol > 0.0 && expfit_known(&xf, xtol))
+            key = ESC;
+        }
+
+    /* steps: noted in the data and in the events file, and looked
+       at closely (fast rate) for jcap s, if asked for */
+    if (do_jump && ok && rd.eflag == EF_OK && cpd_add(&cp, t1, s7150_value(&rd)))
+        {
+        njump++;
+        rec.flags |= RF_STEP;
+        if (!do_binary)
+            fprintf(outfile, "# step %+.7g at %.4f min (detected at %.4f min)\n",
+                    cp.mag, cp.t / 60.0, t1 / 60.0);
+        if (evfile)
+            {
+            t = (time_t) (t0 + cp.t);
+            strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", localtime(&t));
+            fprintf(evfile, "%.4f\t%s\t%.4f\t%+.7g\t%.7g\t%.7g\n", cp.t / 60.0, stamp,
+                    t1 / 60.0, cp.mag, cp.before, cp.after);
+            fflush (evfile);
+            }
+        if (jcap > 0.0)
+            tcap = t1 + jcap;
+        }
+
+    /* adaptive rate: activity means a reading off the running mean by
+       more than athr (a ramp of athr/AD_TAU per s does that, too); fast
+       from then on, slow again after aquiet s without activity */
+    if (do_adapt && ok && rd.eflag == EF_OK)
+        {
+        v = s7150_value(&rd);
+        if (tema == 0.0)
+            ema = v;
+        if (fabs(v - ema) > athr)
+            tact = t1;
+        ema += (1.0 - exp(-(t1 - tema) / AD_TAU)) * (v - ema);
+        tema = t1;
+        }
+    /* the capture after a step (-J) is fast, too */
+    if ((do_adapt || jcap > 0.0) && fast != (t1 - tact < aquiet || t1 < tcap))
+        {
+        fast = !fast;
+        nrate++;
+        if (dpolicy == DSP_AUTO)    /* blank while fast, then as before */
+            {
+            do_display = fast ? 0 : dslow;
+            tdsp = t1 + dperiod;
+            }
+        if (0 == s7150_setup(&dvm, do_display, mode, range, fast ? AD_FREQ : 10.0/delay))
+            {
+            fprintf(stderr, "Quit.\n");
+            if (gp)
+                pclose(gp);
+            close_keyboard();
+            return ERR_INST;
+            }
+        if (!do_binary)
+            fprintf(outfile, "# rate %s at %.4f min\n", fast ? "fast" : "slow", t1 / 60.0);
+        }
+    if (do_binary)
+        {
+        if (do_audit)
+            {
+            /* keep the raw bytes only if they can't be regenerated */
+            crc = s7150_crc32(crc, dvm.raw, dvm.rawlen);
+            nblk++;
+            if (dvm.rawlen == s7150_regen(&rec, regen) && !memcmp(regen, dvm.raw, dvm.rawlen))
+                rec.flags |= RF_CANON;
+            else
+                {
+                memset (&raws[nraw], 0, sizeof(*raws));
+                raws[nraw].rec = loop;
+                raws[nraw].len = dvm.rawlen;
+                memcpy (raws[nraw++].raw, dvm.raw, dvm.rawlen);
+                }
+            }
+        fwrite (&rec, sizeof(rec), 1, outfile);
+        }
+
+    /* the line is formatted once, for the data file and all plugins;
+       the reading goes in as received (s7150_read() takes at most
+       S7150_LEN chars), also if it is shorter, e.g. an error message */
+    t1 /= 60.0;
+    if (do_over)
+        smp.linelen = snprintf(smp.line, S7150_LINELEN, "%.4f\t%s\t%.*f\t%.3g\n", t1, buffer,
+                               ok ? -rd.exp : 0, ok ? s7150_value(&rd) : NAN, se);
+    else if (!do_binary || nsink)
+        smp.linelen = snprintf(smp.line, S7150_LINELEN, "%.4f\t%s\n", t1, buffer);
+    if (smp.linelen < 0)
+        smp.linelen = 0;
+    if (smp.linelen >= S7150_LINELEN)   /* cut, but still a line */
+        {
+        smp.linelen = S7150_LINELEN - 1;
+        smp.line[smp.linelen - 1] = '\n';
+        }
+    if (nsink)
+        {
+        smp.rec = rec;
+        smp.value = ok ? s7150_value(&rd) : NAN;
+        memcpy (smp.text, buffer, S7150_LEN);
+        smp.text[S7150_LEN] = 0;
+        sink_put(&smp);
+        }
+
+    printf("%10lu %10.2f min    %s", ++loop, t1, buffer);
+    if (do_fit && xf.tau > 0.0)
+        printf("  -> %.7g +-%.2g, tau %.4g +-%.2g s ", xf.c, 2.0 * xf.sc, xf.tau, 2.0 * xf.stau);
+    else if (do_fit)
+        printf("%44s", "");
+    printf("\r");
+    if (!do_binary)
+        fwrite (smp.line, 1, smp.linelen, outfile);    // write literally to file
     fflush (stdout);
 
-    /* handle timeout */
+    /* handle timeout, and stop requests from outside */
     if ((t1 > tstop) && (tstop > 0.0))
         key = ESC;
+    if (got_signal)
+        key = ESC;
 
     /* ensure write & display at least every x data points */
     if (!(loop % do_flush))
         {
+        if (do_audit)
+            {
+            audit_write(audfile, nblk, crc, raws, nraw);
+            nblk = nraw = 0L;
+            crc = 0;
+            }
+        if (nsink)
+            sink_flush();
+        if (do_fit && !do_binary && xf.tau > 0.0)
+            fprintf(outfile, "# fit at %.4f min: final %.7g +- %.2g, tau %.4g +- %.2g s\n",
+                    t1, xf.c, 2.0 * xf.sc, xf.tau, 2.0 * xf.stau);
         fflush (outfile);
+        if (do_commit && do_binary)
+            s7150_commitrec(fileno(outfile), loop);
+        else if (do_commit)
+            s7150_commit(commitfd, ftell(outfile), 0);
         if (do_graph)
             {
-            fprintf(gp, "plot '%s' title ''\n", filename);
+            fputs(plotcmd, gp);
             fflush (gp);
             }
         }
 
-    /* look up keyboard for keypress */
+    /* look up keyboard for keypress; 's' polls on demand */
     if(kbhit())
+        {
         key = readch();
+        if (key == 's' && s7150_poll(&dvm) >= 0)
+            {
+            printf("\n");
+            s7150_status(&dvm, stdout);
+            printf("\n");
+            }
+        if (key == 's' && td.n > 0.0)
+            {
+            quantiles(stdout, &td);
+            printf("\n");
+            }
+        if (key == 's' && nsink)
+            sink_status(stdout);
+        if (key == 'x' && do_fit)
+            expfit_init(&xf);
+        }
     }
     while ((key != 'q') && (key != ESC));
 
-/* close data file */
+/* close data file and plugins */
 time(&t);
-fprintf(outfile, "# Acquisition stop: %s\n", ctime(&t));
+if (nsink)
+    {
+    run.t1 = timeinfo();
+    sink_done(&run);
+    }
+if (do_binary)      /* complete the header */
+    {
+    hdr.t1_us = (int64_t) (timeinfo() * 1e6);
+    hdr.nrec = loop;
+    hdr.nval = (uint64_t) td.n;
+    if (td.n > 0.0)
+        {
+        hdr.vmean = vmean;
+        hdr.vstd = td.n > 1.0 ? sqrt(vm2 / (td.n - 1.0)) : 0.0;
+        hdr.vmin = td.min;
+        hdr.vmax = td.max;
+        }
+    fseek (outfile, 0L, SEEK_SET);
+    fwrite (&hdr, sizeof(hdr), 1, outfile);
+    }
+else
+    {
+    if (nover || nunpars)
+        fprintf(outfile, "# %lu readings with error flag, %lu not decodable\n", nover, nunpars);
+    if (td.n > 0.0)
+        fprintf(outfile, "# Summary: n=%.0f mean=%.7g std=%.3g min=%.7g max=%.7g\n", td.n, vmean,
+                td.n > 1.0 ? sqrt(vm2 / (td.n - 1.0)) : 0.0, td.min, td.max);
+    fprintf(outfile, "# Acquisition stop: %s\n", ctime(&t));
+    fflush (outfile);
+    if (do_commit)      /* closed: no sidecar means all of it is valid */
+        {
+        s7150_commit(commitfd, ftell(outfile), 1);
+        close(commitfd);
+        unlink(commitname);
+        }
+    }
 fclose (outfile);
+if (evfile)
+    fclose (evfile);
+if (do_audit)
+    {
+    if (nblk)
+        audit_write(audfile, nblk, crc, raws, nraw);
+    fclose (audfile);
+    free (raws);
+    }
 
 /* send reset to instrument */
-if (! s7150_close(dvm))
+if (! s7150_close(&dvm))
     {
     fprintf(stderr, "Quit.\n");
     return ERR_INST;
     }
+s7150_stats(&dvm);
+if (do_adapt)
+    printf("\n Adaptive rate: %lu changes.", nrate);
+if (do_settle)
+    {
+    printf("\n Settling: %s", stable ? "stable" : "not stable");
+    if (stable)
+        printf(" since %.2f min", tstable / 60.0);
+    printf(", now within %g, slope %g/min.", stl.width, stl.rate);
+    settle_free(&stl);
+    }
+if (do_jump)
+    printf("\n Steps: %lu detected%s%s.", njump, evfile ? ", see " : "", evfile ? evname : "");
+if (do_fit && xf.tau > 0.0)
+    printf("\n Fit: final value %.7g +- %.2g, tau %.4g +- %.2g s (2 sigma, %lu readings).",
+           xf.c, 2.0 * xf.sc, xf.tau, 2.0 * xf.stau, xf.n);
+else if (do_fit)
+    printf("\n Fit: no exponential approach found in %lu readings.", xf.n);
+if (do_over && loop)
+    printf("\n Oversampling: %lu readings for %lu samples, %.1f per sample.", nos, loop,
+           (double) nos / loop);
+for (i = 1; i >= 0; i--)
+    if (dsp_n[i])
+        printf("\n Display %-3s (%s): %lu readings in %.1f s, %.1f/s.", i ? "on" : "off",
+               dsp_names[dpolicy], dsp_n[i], dsp_t[i], dsp_t[i] > 0.0 ? dsp_n[i] / dsp_t[i] : 0.0);
+if (nover || nunpars)
+    printf("\n %lu readings with error flag, %lu not decodable.", nover, nunpars);
+if (td.n > 0.0)
+    {
+    printf("\n");
+    quantiles(stdout, &td);
+    }
+if (tdfile && (0 == s7150_td_save(tdfile, &td) || fclose(tdfile)))
+    fprintf(stderr, "Could not write '%s'.\n", tdname);
+if (hgfile)
+    {
+    fprintf(hgfile, "# s7150 " VERSION ": histogram of %s\n", filename);
+    for (i = 0; i < nhg; i++)
+        {
+        hist_write(hgfile, &hg[i], hgref);
+        free (hg[i].bin);
+        }
+    if (nhglost)
+        printf("\n Histogram: %lu readings in more than %d ranges not counted.", nhglost, HG_MAXRANGE);
+    if (ferror(hgfile) | fclose(hgfile))
+        fprintf(stderr, "Could not write '%s'.\n", hgname);
+    }
+for (i = 0; i < nsink; i++)
+    if (sinks[i].ops)
+        {
+        printf("\n Plugin %s: %lu samples in %lu calls (%lu failed%s), %.1f us/call, max. %.1f ms; flush %.1f ms.",
+               sinks[i].ops->name, sinks[i].nsamp, sinks[i].ncall, sinks[i].nerr,
+               sinks[i].off ? ", switched off" : "",
+               sinks[i].ncall ? 1e6 * sinks[i].twrite / sinks[i].ncall : 0.0,
+               1e3 * sinks[i].tmax, 1e3 * sinks[i].tflush);
+        printf("\n   CPU %.3f s in writer thread (%.2f us/sample), %.2f us/sample to queue.",
+               sinks[i].tcpu, sinks[i].nsamp ? 1e6 * sinks[i].tcpu / sinks[i].nsamp : 0.0,
+               loop ? 1e6 * sinks[i].tput / loop : 0.0);
+        }
+if (nsink)
+    {
+    printf("\n");
+    sink_status(stdout);
+    }
     
 if (do_graph)   /* if graphic display was used, replot data and wait for keypress */
     {
-	fprintf(gp, "plot '%s' title ''\n", filename);
+	fputs(plotcmd, gp);
 	fflush (gp);
 	printf("\nAcquisition finished. Press any key to terminate graphic display and exit.\n");
     while (!kbhit())
@@ -412,16 +1477,20 @@ return 0;
 
 /********************************************************
 * s7150_open: Connect and initialise the Solartron 7150 *
-* Input:      GPIB address                              *
-* Return:     0 if error, file descriptior if OK        *
+* Input:    - ptr to device struct (filled in here)     *
+*           - GPIB address                              *
+* Return:     0 if error, 1 if OK                       *
 ********************************************************/
-int s7150_open (const int pad)
+int s7150_open (struct s7150_dev *dev, const int pad)
 {
-int dvm;
-static char buf[MAXLEN];
-
-dvm = ibdev(GPIB_BOARD_ID, pad, 0, T1s, 1, 0);
-if(dvm < 0)
+memset (dev, 0, sizeof(*dev));
+dev->pad = pad;
+dev->display = dev->fun = dev->range = dev->integ = -1;
+dev->status = -1;
+dev->mains = MAINS;
+
+dev->ud = ibdev(GPIB_BOARD_ID, pad, 0, T1s, 1, 0);
+if(dev->ud < 0)
     {
     fprintf(stderr, "Error trying to open GPIB address %i\n", pad);
     return 0;
@@ -432,37 +1501,37 @@ if(dvm < 0)
     N0 = verbose output
     T1 = tracking on (T0 = single-shot)
     I3 = integration 400 ms
-    */
 
-strcpy (buf, "A\n");
-if (ibwrt(dvm, buf, strlen(buf)) & ERR )
+    The clear needs its own write since the instrument needs some
+    time to recover; the rest is kept pending and goes out together
+    with the first s7150_setup(), saving one bus transaction. */
+
+if (0 == s7150_write(dev, "A\n"))
     {
     fprintf(stderr, "Error during init step 1 of GPIB address %i!\n", pad);
     return 0;
     }
 sleep (2);
-strcpy (buf, "U7N0T1\n");
-if (ibwrt(dvm, buf, strlen(buf)) & ERR )
-    {
-    fprintf(stderr, "Error during init step 2 of GPIB address %i!\n", pad);
-    return 0;
-    }
+strcpy (dev->pending, "U7N0T1");
 
 /* arrive here if OK */
-return dvm;
+return 1;
 }
 
 
 /********************************************************
 * s7150_setup: Sets operating mode of the S7150.        *
-* Input:    - file pointer as delivered by s7150_open() *
+*           Only the settings that differ from what was *
+*           sent before are transmitted, all in 1 write.*
+* Input:    - ptr as delivered by s7150_open()          *
 *           - display, function, range, acq freq in Hz  *
 * Return:   1 if OK, 0 if error                         *
 ********************************************************/
-int s7150_setup (const int dvm, const int display, const int fun, \
+int s7150_setup (struct s7150_dev *dev, const int display, const int fun, \
                  const int range, const float freq)
 {
 int d = 0, i = 3;
+char *p;
 static char buf[MAXLEN];
 
 /* note: the 7150 uses "D1" to switch the display OFF */
@@ -488,35 +1557,65 @@ if (freq > 1.5)    /* more than 1.5 Hz */
 if (freq > 10.0)   /* more than 10 Hz */
     i = 0;
 
+/*  I1 covers 2 cycles of a 50 Hz line, but 2.4 of a 60 Hz one, so
+    some hum gets through there. Still, it is the choice up to 10 Hz
+    on both: I3 (24 cycles of 60 Hz) leaves no time for the reading
+    above 1.5 Hz, and I0 rejects the line even less. */
+
 #ifdef DEBUG
     fprintf(stderr, "%.2f Hz -> using I%d.\n", freq, i);
 #endif
 
-sprintf (buf, "D%dM%dR%dI%d\n", d, fun, range, i);
-if (ibwrt(dvm, buf, strlen(buf)) & ERR )
+dev->nsetup++;
+
+/* build the command from whatever has changed. The range depends
+   on the function, so a new function always gets its range, too. */
+p = buf;
+p += sprintf (p, "%s", dev->pending);
+if (d != dev->display)
+    p += sprintf (p, "D%d", d);
+if (fun != dev->fun)
+    p += sprintf (p, "M%d", fun);
+if (range != dev->range || fun != dev->fun)
+    p += sprintf (p, "R%d", range);
+if (i != dev->integ)
+    p += sprintf (p, "I%d", i);
+
+if (p == buf)       /* nothing to do, instrument is already set */
+    return 1;
+
+strcpy (p, "\n");
+if (0 == s7150_write(dev, buf))
     {
     fprintf(stderr, "Error during mode setting!\n");
+    dev->display = dev->fun = dev->range = dev->integ = -1;
     return 0;
     }
+dev->nsetwrt++;
+dev->pending[0] = 0;
+dev->display = d;
+dev->fun = fun;
+dev->range = range;
+dev->integ = i;
 return 1;
 }
 
 
 /********************************************************
 * s7150_read: Reads value from the Solartron 7150.      *
-* Input:    - file ptr as delivered by s7150_open()     *
+* Input:    - ptr as delivered by s7150_open()          *
 *           - delay between measurements (in 0.1 s)     *
 *           - ptr to char for result                    *
 * Return:   1 if OK, 0 if error                         *
 ********************************************************/
-int s7150_read (const int dvm, const int delay, char *result)
+int s7150_read (struct s7150_dev *dev, const int delay, char *result)
 {
 //static char buf[2];
 
 if (delay > 0)	/* delay == 0 is free-running */
     {
 /*  strcpy (buf, "G");
-    if (ibwrt(dvm, buf, strlen(buf)) & ERR )
+    if (ibwrt(dev->ud, buf, strlen(buf)) & ERR )
         {
         fprintf(stderr, "Error trying to initiate measurement!\n");
         return 0;
@@ -526,12 +1625,17 @@ if (delay > 0)	/* delay == 0 is free-running */
     }
 
 /* Solartron 7150 puts out 15 chars plus LF */
-if(ibrd(dvm, result, 16) & ERR)
+dev->nrd++;
+if(ibrd(dev->ud, result, 16) & ERR)
     {
     fprintf(stderr, "Error trying to read from instrument!\n");
     return 0;
     }
 
+/* keep the raw bytes for the audit file */
+dev->rawlen = (ibcnt < S7150_RAWLEN) ? ibcnt : S7150_RAWLEN;
+memcpy (dev->raw, result, dev->rawlen);
+
 /* make sure string is null-terminated; 
    at the same time, cut off CR  */
 result[ibcnt-1] = 0x0;        
@@ -545,24 +1649,1439 @@ return 1;
 
 
 /********************************************************
-* s7150_close: Reset and disconnect Solartron 7150      *
-* Input:    file pointer as delivered by s7150_open()   *
-* Return:   0 if error, 1 if OK                         *
+* s7150_oversample: Reads as fast as the instrument     *
+*           goes until a given time (at least once),    *
+*           and gives the mean of the readings: a       *
+*           longer integration time, made on the host.  *
+*           It covers as many whole line cycles as fit, *
+*           up to the end; readings before are dropped, *
+*           so the next interval starts after this one. *
+*           The mean gets one more digit than the       *
+*           readings per factor of 100 in their number; *
+*           the result is the mean rounded to the       *
+*           digits of the last reading, in the format   *
+*           of the instrument. Overloads are left out;  *
+*           if all readings are overloads, the last one *
+*           is given. A mean that can't be shown like   *
+*           the readings gives a result that doesn't    *
+*           decode, i.e. a bad sample.                  *
+* Input:    - ptr as delivered by s7150_open()          *
+*           - end of the interval (timeinfo())          *
+*           - ptr to char for result                    *
+*           - ptr to the mean with all its digits,      *
+*             standard error of the mean (0 if less     *
+*             than 2 readings), number of readings      *
+* Return:   1 if OK, 0 if error                         *
 ********************************************************/
-int s7150_close (const int dvm)
+int s7150_oversample (struct s7150_dev *dev, const double tend, char *result, \
+                      struct s7150_reading *mean, double *se, unsigned long *k)
 {
-static char buf[10];
+struct  s7150_reading r, last;
+unsigned long n = 0;
+double  v, d, m = 0.0, m2 = 0.0, tstart = timeinfo();
+int     extra;
+
+if ((d = floor((tend - tstart) * dev->mains)) >= 1.0)
+    tstart = tend - d / dev->mains;
+*k = 0;
+memset (&last, 0, sizeof(last));
+do  {
+    if (0 == s7150_read(dev, 0, result))
+        return 0;
+    if (timeinfo() < tstart)
+        continue;
+    (*k)++;
+    if (!s7150_decode(result, &r) || r.eflag != EF_OK)
+        continue;
+    /* Welford: the range (exponent) may change underway */
+    last = r;
+    v = s7150_value(&r);
+    n++;
+    d = v - m;
+    m += d / n;
+    m2 += d * (v - m);
+    }
+    while (timeinfo() < tend);
 
-strcpy (buf, "DC1\nA\n");
-if (ibwrt(dvm, buf, strlen(buf)) & ERR )
-    {
-    fprintf(stderr, "Error during reset of instrument!\n");
+*se = (n > 1) ? sqrt(m2 / (n - 1) / n) : 0.0;
+*mean = r;
+if (n == 0)
+    return 1;
+
+/* the digits of the last reading, plus those the averaging gives,
+   as many as the count and the exponent can take */
+extra = (int) floor(log10((double) n) / 2.0 + 0.5);
+if (extra > 15 + last.exp)
+    extra = 15 + last.exp;
+while (extra > 0 && fabs(m) * pow(10.0, extra - last.exp) >= INT32_MAX)
+    extra--;
+*mean = last;
+mean->exp = last.exp - extra;
+mean->count = (int32_t) llround(m * pow(10.0, -mean->exp));
+mean->neg = (m < 0.0);
+
+r = *mean;
+s7150_round(&r);
+if (!s7150_encode(&r, result))
+    strcpy (result, "# not encodable");
+return 1;
+}
+
+
+/********************************************************
+* s7150_mains: Finds the line frequency in the signal.  *
+*           Reads as fast as possible for MAINS_SEC s,  *
+*           and compares the power at 50 and 60 Hz with *
+*           each other and with the background (41, 45, *
+*           ... 77 Hz): by Fourier sums at the times of *
+*           the readings, so these needn't be evenly    *
+*           spaced. With too little pickup from the     *
+*           line (or a reading rate that aliases both   *
+*           to the same), it can't tell.                *
+* Input:    - ptr as delivered by s7150_open()          *
+*           - function, range                           *
+* Return:   50 or 60, 0 if not found, -1 if error       *
+********************************************************/
+int s7150_mains (struct s7150_dev *dev, const int fun, const int range)
+{
+char    buf[MAXLEN];
+struct  s7150_reading r;
+double  t, t0, v, w, bg = 0.0, sv = 0.0;
+double  f[2+MAINS_NBG], p[2+MAINS_NBG];
+double  c[2+MAINS_NBG], sn[2+MAINS_NBG];    /* sums of cos and sin, ... */
+double  vc[2+MAINS_NBG], vs[2+MAINS_NBG];   /* ... and of value times these */
+unsigned long n = 0;
+int     j;
+
+f[0] = 50.0;
+f[1] = 60.0;
+for (j = 0; j < MAINS_NBG; j++)
+    f[2+j] = 41.0 + 4.0 * j;
+
+memset (c, 0, sizeof(c));
+memset (sn, 0, sizeof(sn));
+memset (vc, 0, sizeof(vc));
+memset (vs, 0, sizeof(vs));
+if (0 == s7150_setup(dev, 0, fun, range, 100.0))    /* I0, display off */
+    return -1;
+t0 = timeinfo();
+do  {
+    if (0 == s7150_read(dev, 0, buf))
+        return -1;
+    t = timeinfo() - t0;
+    if (!s7150_decode(buf, &r) || r.eflag != EF_OK)
+        continue;
+    v = s7150_value(&r);
+    sv += v;
+    n++;
+    for (j = 0; j < 2+MAINS_NBG; j++)
+        {
+        w = 2.0 * M_PI * f[j] * t;
+        c[j] += cos(w);
+        sn[j] += sin(w);
+        vc[j] += v * cos(w);
+        vs[j] += v * sin(w);
+        }
+    }
+    while (t < MAINS_SEC);
+
+if (n < 10)
+    return 0;
+
+/* power, with the mean taken out */
+sv /= n;
+for (j = 0; j < 2+MAINS_NBG; j++)
+    p[j] = pow(vc[j] - sv * c[j], 2) + pow(vs[j] - sv * sn[j], 2);
+for (j = 2; j < 2+MAINS_NBG; j++)
+    bg += p[j] / MAINS_NBG;
+if (p[0] > MAINS_SNR * p[1] && p[0] > MAINS_SNR * bg)
+    return 50;
+if (p[1] > MAINS_SNR * p[0] && p[1] > MAINS_SNR * bg)
+    return 60;
+return 0;
+}
+
+
+/********************************************************
+* s7150_close: Reset and disconnect Solartron 7150      *
+* Input:    ptr as delivered by s7150_open()            *
+* Return:   0 if error, 1 if OK                         *
+********************************************************/
+int s7150_close (struct s7150_dev *dev)
+{
+/* both commands in one go; afterwards, the settings are unknown */
+dev->display = dev->fun = dev->range = dev->integ = -1;
+if (0 == s7150_write(dev, "DC1\nA\n"))
+    {
+    fprintf(stderr, "Error during reset of instrument!\n");
+    return 0;
+    }
+return 1;
+}
+
+
+/********************************************************
+* s7150_write: Sends a command string to the S7150 and  *
+*           counts the bus transaction.                 *
+* Input:    - ptr as delivered by s7150_open()          *
+*           - command string (incl. delimiter)          *
+* Return:   0 if error, 1 if OK                         *
+********************************************************/
+int s7150_write (struct s7150_dev *dev, const char *cmd)
+{
+#ifdef DEBUG
+    fprintf(stderr, "GPIB %d <- '%s'\n", dev->pad, cmd);
+#endif
+
+dev->nwrt++;
+if (ibwrt(dev->ud, cmd, strlen(cmd)) & ERR )
+    return 0;
+return 1;
+}
+
+
+/********************************************************
+* s7150_stats: Shows the bus transactions of one DMM.   *
+* Input:    ptr as delivered by s7150_open()            *
+* Return:   nothing                                     *
+********************************************************/
+void s7150_stats (const struct s7150_dev *dev)
+{
+printf("\n GPIB address %d: %lu writes, %lu reads; %lu setups needed %lu writes.",
+       dev->pad, dev->nwrt, dev->nrd, dev->nsetup, dev->nsetwrt);
+if (dev->npoll)
+    printf("\n                 %lu serial polls (%lu with RQS), %.0f us/poll.",
+           dev->npoll, dev->nbad, 1e6 * dev->tpoll / dev->npoll);
+}
+
+
+/********************************************************
+* s7150_poll: Serial-polls the S7150. This costs only   *
+*           one status byte on the bus, much less than  *
+*           a complete reading.                         *
+* Input:    ptr as delivered by s7150_open()            *
+* Return:   status byte, -1 if error                    *
+********************************************************/
+int s7150_poll (struct s7150_dev *dev)
+{
+char st;
+double t;
+
+t = timeinfo();
+if (ibrsp(dev->ud, &st) & ERR)
+    {
+    fprintf(stderr, "Error during serial poll of GPIB address %d!\n", dev->pad);
+    return -1;
+    }
+dev->tpoll += timeinfo() - t;
+dev->npoll++;
+dev->status = (unsigned char) st;
+if (dev->status & ST_RQS)
+    dev->nbad++;
+return dev->status;
+}
+
+
+/********************************************************
+* s7150_status: Shows the decoded status of the S7150.  *
+* Input:    - ptr as delivered by s7150_open()          *
+*           - where to print it                         *
+* Return:   nothing                                     *
+********************************************************/
+void s7150_status (const struct s7150_dev *dev, FILE *fp)
+{
+if (dev->status < 0)
+    {
+    fprintf(fp, "GPIB %d: not polled yet", dev->pad);
+    return;
+    }
+fprintf(fp, "GPIB %d: status 0x%02x%s", dev->pad, dev->status,
+        (dev->status & ST_RQS) ? " (requests service)" : "");
+if (dev->status & ST_RESERVED)
+    fprintf(fp, ", other bits 0x%02x", dev->status & ST_RESERVED);
+}
+
+
+/********************************************************
+* verify:   Checks the reading decoder against a file   *
+*           recorded earlier: every reading must give   *
+*           back exactly the same 15 chars after being  *
+*           decoded, stored in a binary record and      *
+*           encoded again. Also measures decoding speed.*
+* Input:    name of data file (s7150 or s7150duo)       *
+* Return:   0 if all readings are reproduced, else      *
+*           error code                                  *
+********************************************************/
+int verify (const char *fname)
+{
+FILE    *fp;
+char    line[4*MAXLEN], out[S7150_LEN+1], *p, (*corpus)[S7150_LEN+1] = NULL;
+struct  s7150_reading r;
+struct  s7150_rec rec;
+unsigned long i, j, n = 0, nmax = 0, nok = 0, nbad = 0, nrep = 0, sum = 0;
+double  t;
+
+if (NULL == (fp = fopen(fname, "rt")))
+    {
+    fprintf(stderr, "Could not open '%s' for reading.\n", fname);
+    return ERR_FILE;
+    }
+
+/* collect all readings; the first column is the time */
+while (fgets(line, sizeof(line), fp))
+    {
+    if (line[0] == '#' || NULL == (p = strchr(line, '\t')))
+        continue;
+    while (p)
+        {
+        p++;
+        if (n == nmax)
+            {
+            nmax = nmax ? 2*nmax : 4096;
+            if (NULL == (corpus = realloc(corpus, nmax * sizeof(*corpus))))
+                {
+                fprintf(stderr, "Out of memory.\n");
+                fclose(fp);
+                return ERR_FILE;
+                }
+            }
+        memset (corpus[n], 0, S7150_LEN+1);
+        strncpy (corpus[n], p, S7150_LEN);
+        corpus[n][strcspn(corpus[n], "\t\r\n")] = 0;
+        n++;
+        p = strchr(p, '\t');
+        }
+    }
+fclose(fp);
+if (n == 0)
+    {
+    fprintf(stderr, "No readings found in '%s'.\n", fname);
+    free(corpus);
+    return ERR_FILE;
+    }
+
+/* byte-for-byte round trip, also through the binary record */
+for (i = 0; i < n; i++)
+    {
+    if (!s7150_decode(corpus[i], &r))
+        {
+        if (nbad++ < 5)
+            printf("  not decodable: '%s'\n", corpus[i]);
+        continue;
+        }
+    s7150_torec(&r, 0, 0, &rec);
+    if (s7150_fromrec(&rec, &r) && s7150_encode(&r, out) && \
+        !memcmp(out, corpus[i], S7150_LEN))
+        nok++;
+    else if (nrep++ < 5)
+        printf("  not reproduced: '%s'\n", corpus[i]);
+    }
+
+/* speed: repeat until we have some 0.2 s worth of decoding */
+t = timeinfo();
+for (i = 0; timeinfo() - t < 0.2; )
+    for (j = 0; j < n; j++, i++)
+        {
+        s7150_decode(corpus[j], &r);
+        sum += r.count;
+        }
+t = timeinfo() - t;
+
+printf("%s: %lu readings, %lu reproduced exactly, %lu not reproduced, %lu not decodable.\n",
+       fname, n, nok, nrep, nbad);
+printf("Decoding: %.1f ns/reading (checksum %lu).\n", 1e9 * t / i, sum);
+free(corpus);
+return (nok == n) ? 0 : ERR_FILE;
+}
+
+
+/********************************************************
+* export:   Writes a binary data file as text, in the   *
+*           same format as s7150 would have written it. *
+* Input:    name of binary data file                    *
+* Return:   0 if OK, else error code                    *
+********************************************************/
+int export (const char *fname)
+{
+FILE    *fp;
+char    out[S7150_LEN+1];
+struct  s7150_binhdr h;
+struct  s7150_rec rec;
+struct  s7150_reading r;
+time_t  t;
+int     fast = 0;
+
+if (NULL == (fp = fopen(fname, "rb")))
+    {
+    fprintf(stderr, "Could not open '%s' for reading.\n", fname);
+    return ERR_FILE;
+    }
+if (1 != fread(&h, sizeof(h), 1, fp) || !s7150_checkhdr(&h))
+    {
+    fprintf(stderr, "'%s' is not a binary s7150 data file.\n", fname);
+    fclose(fp);
+    return ERR_FILE;
+    }
+fseek (fp, h.hdrsize, SEEK_SET);
+
+t = h.t0_us / 1000000;
+printf("# %.*s\n", (int) sizeof(h.program), h.program);
+printf("# %.*s\n", (int) sizeof(h.comment), h.comment);
+printf("# Acquisition start: %s", ctime(&t));
+printf("# min\treadout  errflag  unit  mode\n");
+while (1 == fread(&rec, sizeof(rec), 1, fp))
+    {
+    /* rate changes (-A), as s7150 notes them in text files */
+    if (fast != !!(rec.flags & RF_FAST))
+        {
+        fast = !fast;
+        printf("# rate %s at %.4f min\n", fast ? "fast" : "slow", rec.t_us / 6e7);
+        }
+    if (rec.flags & RF_STEP)    /* -J; size and time are in the events file */
+        printf("# step detected at %.4f min\n", rec.t_us / 6e7);
+    /* a mean (-O, from a plugin) has more digits than the readout */
+    if (s7150_fromrec(&rec, &r))
+        s7150_round(&r);
+    if (!(rec.flags & RF_BAD) && s7150_encode(&r, out))
+        printf("%.4f\t%s\n", rec.t_us / 6e7, out);
+    else
+        printf("%.4f\t# not decodable\n", rec.t_us / 6e7);
+    }
+if (h.t1_us)
+    {
+    t = h.t1_us / 1000000;
+    printf("# Acquisition stop: %s\n", ctime(&t));
+    }
+fclose(fp);
+return 0;
+}
+
+
+/********************************************************
+* audit_write: Appends one block to the audit file.     *
+* Input:    - audit file                                *
+*           - number of readings in block, their CRC    *
+*           - raw readings that can't be regenerated    *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+int audit_write (FILE *fp, const unsigned long nrec, const uint32_t crc, \
+                 const struct s7150_raw *raw, const unsigned long nraw)
+{
+struct s7150_audblk blk;
+
+memset (&blk, 0, sizeof(blk));
+strcpy (blk.magic, "BLK");
+blk.nrec = nrec;
+blk.nraw = nraw;
+blk.crc = crc;
+if (1 != fwrite(&blk, sizeof(blk), 1, fp) || \
+    nraw != fwrite(raw, sizeof(*raw), nraw, fp))
+    {
+    fprintf(stderr, "Error writing to audit file!\n");
     return 0;
     }
+fflush (fp);
 return 1;
 }
 
 
+/********************************************************
+* audit_check: Rebuilds the raw data stream from a      *
+*           binary data file and its audit file, then   *
+*           checks it against the CRC of each block.    *
+* Input:    name of binary data file                    *
+* Return:   0 if OK, else error code                    *
+********************************************************/
+int audit_check (const char *fname)
+{
+FILE    *fp, *ap;
+char    audname[MAXLEN+8], regen[S7150_RAWLEN+1];
+struct  s7150_binhdr h;
+struct  s7150_audhdr ah;
+struct  s7150_audblk blk;
+struct  s7150_raw raw;
+struct  s7150_rec rec;
+unsigned long i, n = 0, nblk = 0, nbad = 0, nraw = 0, nerr = 0;
+uint32_t crc;
+int     len;
+
+if (NULL == (fp = fopen(fname, "rb")))
+    {
+    fprintf(stderr, "Could not open '%s' for reading.\n", fname);
+    return ERR_FILE;
+    }
+if (1 != fread(&h, sizeof(h), 1, fp) || !s7150_checkhdr(&h) || !(h.hflags & HF_AUDIT))
+    {
+    fprintf(stderr, "'%s' is not a binary s7150 data file with audit.\n", fname);
+    fclose(fp);
+    return ERR_FILE;
+    }
+snprintf(audname, sizeof(audname), "%s.audit", fname);
+if (NULL == (ap = fopen(audname, "rb")) || 1 != fread(&ah, sizeof(ah), 1, ap) || \
+    memcmp(ah.magic, S7150_AUDMAGIC, 8))
+    {
+    fprintf(stderr, "Could not read audit file '%s'.\n", audname);
+    fclose(fp);
+    if (ap)
+        fclose(ap);
+    return ERR_FILE;
+    }
+fseek (fp, h.hdrsize, SEEK_SET);
+fseek (ap, ah.hdrsize, SEEK_SET);
+
+while (1 == fread(&blk, sizeof(blk), 1, ap))
+    {
+    if (memcmp(blk.magic, "BLK", 4))
+        {
+        fprintf(stderr, "Audit file '%s' is corrupt after %lu blocks.\n", audname, nblk);
+        nerr++;
+        break;
+        }
+    crc = 0;
+    nraw = blk.nraw;
+    for (i = 0; i < blk.nrec; i++, n++)
+        {
+        if (1 != fread(&rec, sizeof(rec), 1, fp))
+            {
+            fprintf(stderr, "'%s' ends before its audit file.\n", fname);
+            nerr++;
+            break;
+            }
+        if (rec.flags & RF_CANON)
+            len = s7150_regen(&rec, regen);
+        else if (nraw > 0 && 1 == fread(&raw, sizeof(raw), 1, ap) && raw.rec == n)
+            {
+            nraw--;
+            len = (raw.len <= S7150_RAWLEN) ? raw.len : 0;
+            memcpy (regen, raw.raw, len);
+            }
+        else
+            len = -1;
+        if (len < 0 || ((rec.flags & RF_CANON) && len == 0))
+            {
+            fprintf(stderr, "Record %lu can't be rebuilt.\n", n);
+            nerr++;
+            continue;
+            }
+        crc = s7150_crc32(crc, regen, len);
+        }
+    fseek (ap, nraw * sizeof(raw), SEEK_CUR);     /* skip what's left */
+    if (crc != blk.crc)
+        {
+        fprintf(stderr, "Block %lu (records %lu...%lu): CRC mismatch.\n",
+                nblk, n - blk.nrec, n - 1);
+        nbad++;
+        }
+    nblk++;
+    }
+if (1 == fread(&rec, sizeof(rec), 1, fp))
+    {
+    fprintf(stderr, "'%s' has records not covered by the audit file.\n", fname);
+    nerr++;
+    }
+fclose(fp);
+fclose(ap);
+
+printf("%s: %lu readings in %lu blocks, %lu blocks with CRC mismatch, %lu other errors.\n",
+       fname, n, nblk, nbad, nerr);
+return (nbad || nerr) ? ERR_FILE : 0;
+}
+
+
+/********************************************************
+* sink_load: Loads an output plugin, initialises it and *
+*           starts its writer thread.                   *
+* Input:    - plugin, with spec "lib.so[:arg]" filled in *
+*           - acquisition info for the plugin           *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+int sink_load (struct sink *k, const struct s7150_runinfo *run)
+{
+char    path[MAXLEN], spill[MAXLEN+24], *arg;
+
+strcpy (path, k->spec);
+arg = strchr(path, ':');
+if (arg)
+    *arg++ = 0;
+else
+    arg = "";
+
+if (NULL == (k->lib = dlopen(path, RTLD_NOW)))
+    {
+    fprintf(stderr, "Could not load plugin '%s': %s\n", path, dlerror());
+    return 0;
+    }
+k->ops = dlsym(k->lib, S7150_SINK_SYMBOL);
+if (k->ops == NULL || k->ops->abi != S7150_SINK_ABI || \
+    k->ops->init == NULL || k->ops->write == NULL || k->ops->close == NULL)
+    {
+    fprintf(stderr, "'%s' is not an s7150 plugin (or a wrong version).\n", path);
+    k->ops = NULL;
+    return 0;
+    }
+if (0 == k->ops->init(arg, run, &k->ctx))
+    {
+    fprintf(stderr, "Plugin '%s' could not be initialised.\n", k->ops->name);
+    k->ops = NULL;
+    return 0;
+    }
+
+/* the spill file is only a buffer for this run; without a name,
+   it does not stay behind whatever happens */
+k->spillfd = -1;
+if (k->policy == BP_SPILL)
+    {
+    sprintf(spill, "%s/s7150-spill-XXXXXX", k->spilldir);
+    if ((k->spillfd = mkstemp(spill)) < 0)
+        {
+        fprintf(stderr, "Could not create spill file in '%s'.\n", k->spilldir);
+        k->ops->close(k->ctx, run);
+        k->ops = NULL;
+        return 0;
+        }
+    unlink(spill);
+    }
+
+k->t0 = run->t0;
+pthread_mutex_init(&k->lock, NULL);
+pthread_cond_init(&k->more, NULL);
+pthread_cond_init(&k->room, NULL);
+if (pthread_create(&k->thread, NULL, sink_thread, k))
+    {
+    fprintf(stderr, "Could not start writer thread for '%s'.\n", k->ops->name);
+    k->ops->close(k->ctx, run);
+    k->ops = NULL;
+    return 0;
+    }
+return 1;
+}
+
+
+/********************************************************
+* sink_thread: Writer thread of one plugin. Hands the   *
+*           queued samples over in batches (QBATCH, or  *
+*           what is there when a flush is due), then    *
+*           those spilled to disk, and keeps the        *
+*           statistics. A plugin whose write fails      *
+*           SINK_MAXERR times in a row is switched off; *
+*           the other plugins are not affected.         *
+* Input:    the plugin                                  *
+* Return:   NULL                                        *
+********************************************************/
+void *sink_thread (void *arg)
+{
+struct  sink *k = arg;
+struct  s7150_sample rbuf[QBATCH], *s = rbuf;
+unsigned long n, i, off = 0, left;
+ssize_t got;
+int     flush, stop, replay;
+double  t, lag = 0.0;
+struct  timespec ts;
+
+do  {
+    pthread_mutex_lock(&k->lock);
+    while ((k->head - k->next) + (k->nspill - k->nreplay) < QBATCH && !k->flush && !k->stop)
+        pthread_cond_wait(&k->more, &k->lock);
+
+    /* the queue first, it holds the older samples; a batch
+       must be contiguous in the ring buffer */
+    replay = 0;
+    n = k->head - k->next;
+    i = k->next % QSIZE;
+    if (n > QSIZE - i)
+        n = QSIZE - i;
+    if (n > QBATCH)
+        n = QBATCH;
+    if (n)
+        {
+        s = &k->q[i];
+        k->next += n;
+        k->busy = 1;
+        pthread_cond_signal(&k->room);
+        }
+    else if (k->nspill > k->nreplay)
+        {
+        replay = 1;
+        off = k->nreplay;
+        n = k->nspill - off;
+        if (n > QBATCH)
+            n = QBATCH;
+        s = rbuf;
+        }
+    left = (k->head - k->next) + (k->nspill - k->nreplay) - (replay ? n : 0);
+    flush = k->flush && !left;
+    if (flush)
+        k->flush = 0;
+    stop = k->stop && !left;
+    pthread_mutex_unlock(&k->lock);
+
+    /* spilled samples are not overwritten before nreplay has moved;
+       queued ones are not touched before we have moved the tail */
+    if (replay)
+        {
+        got = pread(k->spillfd, rbuf, n * sizeof(*rbuf), off * sizeof(*rbuf));
+        n = (got > 0) ? got / sizeof(*rbuf) : 0;
+        }
+    if (n && k->off)        /* switched off: the samples only pass by */
+        {
+        pthread_mutex_lock(&k->lock);
+        k->ndrop += n;
+        pthread_mutex_unlock(&k->lock);
+        n = 0;
+        }
+    if (n)
+        {
+        t = timeinfo();
+        if (0 == k->ops->write(k->ctx, s, n))
+            {
+            k->nerr++;
+            if (++k->nfail == SINK_MAXERR)
+                {
+                fprintf(stderr, "\nPlugin %s failed %d times in a row, switched off.\n",
+                        k->ops->name, SINK_MAXERR);
+                pthread_mutex_lock(&k->lock);
+                k->off = 1;
+                pthread_mutex_unlock(&k->lock);
+                }
+            }
+        else
+            k->nfail = 0;
+        lag = timeinfo() - k->t0 - s[0].rec.t_us / 1e6;
+        t = timeinfo() - t;
+        k->twrite += t;
+        if (t > k->tmax)
+            k->tmax = t;
+        k->ncall++;
+        k->nsamp += n;
+        }
+    if (flush && k->ops->flush && !k->off)
+        {
+        t = timeinfo();
+        if (0 == k->ops->flush(k->ctx))
+            k->nerr++;
+        k->tflush += timeinfo() - t;
+        }
+
+    pthread_mutex_lock(&k->lock);
+    if (n && lag > k->maxlag)
+        k->maxlag = lag;
+    if (!replay)
+        {
+        k->tail = k->next;
+        k->busy = 0;
+        }
+    else if (n == 0)        /* spill file unreadable: give up on it */
+        {
+        k->nerr++;
+        k->ndrop += k->nspill - k->nreplay;
+        k->nreplay = k->nspill;
+        }
+    else
+        k->nreplay += n;
+    if (k->nspill && k->nreplay == k->nspill)
+        {
+        /* caught up: back to the queue, and start the file afresh */
+        k->nspill = k->nreplay = 0;
+        if (ftruncate(k->spillfd, 0))
+            k->nerr++;
+        }
+    pthread_mutex_unlock(&k->lock);
+    }
+    while (!stop);
+
+/* closed here, too: what the plugin has started (e.g. with io_uring)
+   may belong to this thread and end with it */
+if (0 == k->ops->close(k->ctx, k->run))
+    k->nerr++;
+if (0 == clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts))
+    k->tcpu = ts.tv_sec + ts.tv_nsec / 1e9;
+return NULL;
+}
+
+
+/********************************************************
+* sink_put: Queues one sample for the writer thread of  *
+*           each plugin. If a queue is full (QLIM       *
+*           samples waiting), its policy                *
+*           decides: wait, drop the oldest sample still *
+*           waiting (or the new one, while the batch in *
+*           work leaves no slot), drop the new one, or  *
+*           spill the new one (and all after it, to     *
+*           keep the order) to disk until the writer    *
+*           has caught up.                              *
+*           Plugins that are switched off get nothing.  *
+* Input:    sample                                      *
+* Return:   nothing                                     *
+********************************************************/
+void sink_put (const struct s7150_sample *smp)
+{
+struct  sink *k;
+int     full;
+double  t;
+
+for (k = sinks; k < sinks + nsink; k++)
+    {
+    t = timeinfo();
+    pthread_mutex_lock(&k->lock);
+    if (k->off)
+        {
+        k->ndrop++;
+        pthread_mutex_unlock(&k->lock);
+        continue;
+        }
+    full = (k->head - k->next == QLIM);
+    if (full && k->policy == BP_BLOCK)
+        {
+        while (k->head - k->next == QLIM)
+            pthread_cond_wait(&k->room, &k->lock);
+        full = 0;
+        }
+    /* the batch in work keeps its slots, the one after it goes;
+       if that frees no slot (the ring is full up to the batch in
+       work), the new one goes instead, see below */
+    if (full && k->policy == BP_OLDEST && (!k->busy || k->head - k->tail < QSIZE))
+        {
+        k->next++;
+        if (!k->busy)
+            k->tail = k->next;
+        k->ndrop++;
+        full = 0;
+        }
+
+    if (k->nspill || (full && k->policy == BP_SPILL))
+        {
+        if (sizeof(*smp) == pwrite(k->spillfd, smp, sizeof(*smp), k->nspill * sizeof(*smp)))
+            {
+            k->nspill++;
+            k->spilled += sizeof(*smp);
+            }
+        else
+            k->ndrop++;
+        }
+    else if (!full)
+        {
+        k->q[k->head % QSIZE] = *smp;
+        k->head++;
+        if (k->head - k->next > k->maxdepth)
+            k->maxdepth = k->head - k->next;
+        }
+    else
+        k->ndrop++;
+
+    if ((k->head - k->next) + (k->nspill - k->nreplay) >= QBATCH)
+        pthread_cond_signal(&k->more);
+    pthread_mutex_unlock(&k->lock);
+    k->tput += timeinfo() - t;
+    }
+}
+
+
+/********************************************************
+* sink_flush: Asks the writer threads to flush their    *
+*           plugins once the queue (and spill file) is  *
+*           written.                                    *
+* Input:    nothing                                     *
+* Return:   nothing                                     *
+********************************************************/
+void sink_flush (void)
+{
+struct sink *k;
+
+for (k = sinks; k < sinks + nsink; k++)
+    {
+    pthread_mutex_lock(&k->lock);
+    k->flush = 1;
+    pthread_cond_signal(&k->more);
+    pthread_mutex_unlock(&k->lock);
+    }
+}
+
+
+/********************************************************
+* sink_status: Shows how far each plugin is behind. The *
+*           lag is the age of the oldest sample not yet *
+*           handed over, 0 if there is none.            *
+* Input:    output stream                               *
+* Return:   nothing                                     *
+********************************************************/
+void sink_status (FILE *fp)
+{
+struct  sink *k;
+struct  s7150_sample old;
+double  lag;
+
+for (k = sinks; k < sinks + nsink; k++)
+    {
+    if (k->ops == NULL)
+        continue;
+    pthread_mutex_lock(&k->lock);
+    lag = 0.0;
+    if (k->head != k->tail)
+        old = k->q[(k->busy ? k->tail : k->next) % QSIZE];
+    if (k->head != k->tail || (k->nspill > k->nreplay &&
+        sizeof(old) == pread(k->spillfd, &old, sizeof(old), k->nreplay * sizeof(old))))
+        lag = timeinfo() - k->t0 - old.rec.t_us / 1e6;
+    fprintf(fp, " Plugin %s (%s): queue %lu/%d (max. %lu), %lu dropped, %.1f MB spilled, "
+            "%lu to replay, lag %.1f s (max. %.1f s)\n", k->ops->name, bp_names[k->policy],
+            k->head - k->next, QLIM, k->maxdepth, k->ndrop, k->spilled / 1e6,
+            k->nspill - k->nreplay, lag, k->maxlag);
+    pthread_mutex_unlock(&k->lock);
+    }
+}
+
+
+/********************************************************
+* sink_done: Lets the writer threads finish their queue *
+*           and spill file, and close their plugins.    *
+* Input:    acquisition info, with stop time            *
+* Return:   nothing                                     *
+********************************************************/
+void sink_done (const struct s7150_runinfo *run)
+{
+struct sink *k;
+
+for (k = sinks; k < sinks + nsink; k++)
+    {
+    pthread_mutex_lock(&k->lock);
+    k->run = run;
+    k->stop = k->flush = 1;
+    pthread_cond_signal(&k->more);
+    pthread_mutex_unlock(&k->lock);
+    }
+
+for (k = sinks; k < sinks + nsink; k++)
+    {
+    pthread_join(k->thread, NULL);
+    if (k->spillfd >= 0)
+        close(k->spillfd);
+    }
+}
+
+
+/********************************************************
+* quantiles: Shows where the readings lie, from the     *
+*           digest: p0.1, p1, p50, p99, p99.9.          *
+* Input:    - where to                                  *
+*           - digest                                    *
+* Return:   nothing                                     *
+********************************************************/
+void quantiles (FILE *fp, struct s7150_td *td)
+{
+int i;
+
+fprintf(fp, " Quantiles of %.0f readings:", td->n);
+for (i = 0; i < S7150_TD_NQ; i++)
+    fprintf(fp, " %s %.7g%s", s7150_td_qname[i], s7150_td_quantile(td, s7150_td_q[i]),
+            i < S7150_TD_NQ - 1 ? "," : ".");
+}
+
+
+/********************************************************
+* on_signal: Signal handler, lets the main loop finish  *
+*           properly (close file, reset instrument).    *
+* Input:    signal number                               *
+* Return:   nothing                                     *
+********************************************************/
+void on_signal (int sig)
+{
+got_signal = sig;
+}
+
+
+/********************************************************
+* settle_init: Prepares the settling detector.          *
+* Input:    - ptr to detector                           *
+*           - window (s), band, max. slope (per min)    *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+int settle_init (struct settle *s, const double win, const double band, const double slope)
+{
+memset (s, 0, sizeof(*s));
+s->win = win;
+s->band = band;
+s->slope = slope;
+s->size = 1024;
+s->t = malloc(s->size * sizeof(*s->t));
+s->v = malloc(s->size * sizeof(*s->v));
+s->qmin = malloc(s->size * sizeof(*s->qmin));
+s->qmax = malloc(s->size * sizeof(*s->qmax));
+if (s->t && s->v && s->qmin && s->qmax)
+    return 1;
+settle_free(s);
+return 0;
+}
+
+
+void settle_free (struct settle *s)
+{
+free (s->t);
+free (s->v);
+free (s->qmin);
+free (s->qmax);
+memset (s, 0, sizeof(*s));
+}
+
+
+/********************************************************
+* settle_grow: Doubles the rings, when the window holds *
+*           more readings than they have slots.         *
+* Input:    ptr to detector                             *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+int settle_grow (struct settle *s)
+{
+unsigned long n = 2 * s->size, i, om = s->size - 1, nm = n - 1;
+double  *t, *v;
+unsigned long *qmin, *qmax;
+
+t = malloc(n * sizeof(*t));
+v = malloc(n * sizeof(*v));
+qmin = malloc(n * sizeof(*qmin));
+qmax = malloc(n * sizeof(*qmax));
+if (!t || !v || !qmin || !qmax)
+    {
+    free (t);
+    free (v);
+    free (qmin);
+    free (qmax);
+    return 0;
+    }
+for (i = s->tail; i != s->head; i++)
+    {
+    t[i & nm] = s->t[i & om];
+    v[i & nm] = s->v[i & om];
+    }
+for (i = s->minh; i != s->mint; i++)
+    qmin[i & nm] = s->qmin[i & om];
+for (i = s->maxh; i != s->maxt; i++)
+    qmax[i & nm] = s->qmax[i & om];
+free (s->t);
+free (s->v);
+free (s->qmin);
+free (s->qmax);
+s->t = t;
+s->v = v;
+s->qmin = qmin;
+s->qmax = qmax;
+s->size = n;
+return 1;
+}
+
+
+/********************************************************
+* settle_add: Adds a reading to the window, drops the   *
+*           ones that are too old, and tells whether    *
+*           the signal is stable. O(1) per reading: the *
+*           regression uses running sums, min and max   *
+*           come from two monotonic queues.             *
+* Input:    - ptr to detector                           *
+*           - time (s), value                           *
+* Return:   1 if stable, 0 if not, -1 if out of memory  *
+********************************************************/
+int settle_add (struct settle *s, const double t, const double v)
+{
+unsigned long i, m;
+double  x, y, n, den;
+
+if (s->head == 0)
+    {
+    s->tfirst = t;
+    s->vref = v;
+    }
+if (s->head - s->tail == s->size && 0 == settle_grow(s))
+    return -1;
+m = s->size - 1;
+x = t - s->tfirst;
+y = v - s->vref;
+
+/* drop what has left the window */
+while (s->tail != s->head && x - s->t[s->tail & m] > s->win)
+    {
+    s->st -= s->t[s->tail & m];
+    s->sv -= s->v[s->tail & m];
+    s->stt -= s->t[s->tail & m] * s->t[s->tail & m];
+    s->stv -= s->t[s->tail & m] * s->v[s->tail & m];
+    if (s->minh != s->mint && s->qmin[s->minh & m] == s->tail)
+        s->minh++;
+    if (s->maxh != s->maxt && s->qmax[s->maxh & m] == s->tail)
+        s->maxh++;
+    s->tail++;
+    }
+
+/* add the new one; a queue loses all entries it can never top */
+s->t[s->head & m] = x;
+s->v[s->head & m] = y;
+while (s->mint != s->minh && s->v[s->qmin[(s->mint - 1) & m] & m] >= y)
+    s->mint--;
+s->qmin[s->mint++ & m] = s->head;
+while (s->maxt != s->maxh && s->v[s->qmax[(s->maxt - 1) & m] & m] <= y)
+    s->maxt--;
+s->qmax[s->maxt++ & m] = s->head;
+s->head++;
+
+/* the sums drift with all these additions and subtractions: start
+   them afresh now and then, which still makes O(1) per reading */
+if (!(s->head & m))
+    {
+    s->st = s->sv = s->stt = s->stv = 0.0;
+    for (i = s->tail; i != s->head; i++)
+        {
+        s->st += s->t[i & m];
+        s->sv += s->v[i & m];
+        s->stt += s->t[i & m] * s->t[i & m];
+        s->stv += s->t[i & m] * s->v[i & m];
+        }
+    }
+else
+    {
+    s->st += x;
+    s->sv += y;
+    s->stt += x * x;
+    s->stv += x * y;
+    }
+
+n = s->head - s->tail;
+den = n * s->stt - s->st * s->st;
+s->width = s->v[s->qmax[s->maxh & m] & m] - s->v[s->qmin[s->minh & m] & m];
+s->rate = (n > 2 && den > 0.0) ? 60.0 * (n * s->stv - s->st * s->sv) / den : 0.0;
+
+/* judge only a full window */
+return x >= s->win && s->width <= s->band && fabs(s->rate) <= s->slope;
+}
+
+
+/********************************************************
+* expfit_init: (Re)starts the exponential fit.          *
+* Input:    ptr to fit                                  *
+* Return:   nothing                                     *
+********************************************************/
+void expfit_init (struct expfit *f)
+{
+memset (f, 0, sizeof(*f));
+f->P[0][0] = f->P[1][1] = f->P[2][2] = XF_P0;
+}
+
+
+/********************************************************
+* expfit_add: Adds a reading to the fit of              *
+*           y = c + A*exp(-t/tau). Integrated, the      *
+*           model is linear in its parameters:          *
+*           y - y0 = -1/tau * Int(y-y0)dt + (c-y0)/tau * t  *
+*           (with a constant for the start), so a       *
+*           recursive least-squares step does it, in    *
+*           constant time, for any spacing of the       *
+*           readings. Integrating also averages the     *
+*           noise, where a derivative would amplify it. *
+* Input:    - ptr to fit                                *
+*           - time (s), reading                         *
+* Return:   1 if there is an estimate (decay found,     *
+*           and significant), 0 if not (tau is 0 then)  *
+********************************************************/
+int expfit_add (struct expfit *f, const double t, const double y)
+{
+double  v[3], pv[3], k[3], x, u, den, e, s2, p1, p2, a, b, var;
+int     i, j;
+
+if (f->n == 0)
+    {
+    f->t0 = t;
+    f->y0 = y;
+    }
+x = t - f->t0;
+u = y - f->y0;
+f->area += 0.5 * (u + f->up) * (x - f->tp);    /* trapezoids */
+f->tp = x;
+f->up = u;
+f->n++;
+
+/* recursive least squares */
+v[0] = 1.0;
+v[1] = f->area;
+v[2] = x;
+den = 1.0;
+e = u;
+for (i = 0; i < 3; i++)
+    {
+    pv[i] = f->P[i][0] * v[0] + f->P[i][1] * v[1] + f->P[i][2] * v[2];
+    den += v[i] * pv[i];
+    e -= f->th[i] * v[i];
+    }
+for (i = 0; i < 3; i++)
+    {
+    k[i] = pv[i] / den;
+    f->th[i] += k[i] * e;
+    }
+for (i = 0; i < 3; i++)
+    for (j = 0; j < 3; j++)
+        f->P[i][j] -= k[i] * pv[j];
+f->sse += e * e / den;
+
+/* the estimate, and its uncertainty from the covariance */
+f->tau = f->c = f->sc = f->stau = 0.0;
+if (f->n < XF_MINN)
+    return 0;
+s2 = f->sse / (f->n - 3);
+p1 = f->th[1];
+p2 = f->th[2];
+if (p1 >= 0.0 || p1 * p1 <= 4.0 * s2 * f->P[1][1])
+    return 0;
+f->tau = -1.0 / p1;
+f->c = f->y0 - p2 / p1;
+a = p2 / (p1 * p1);         /* d c / d p1 */
+b = -1.0 / p1;              /* d c / d p2 */
+var = s2 * (a * a * f->P[1][1] + b * b * f->P[2][2] + 2.0 * a * b * f->P[1][2]);
+f->sc = sqrt(var > 0.0 ? var : 0.0);
+f->stau = sqrt(s2 * f->P[1][1]) / (p1 * p1);
+return 1;
+}
+
+
+/********************************************************
+* expfit_known: Tells whether the final value is known  *
+*           well enough to stop. Early on, the fit is   *
+*           surer of c than it should be: the residuals *
+*           are few, and the noise in the integral is   *
+*           not in its error model. So c must be within *
+*           tol (2 sigma) for XF_HOLD estimates in a    *
+*           row, and the readings must span XF_SPAN     *
+*           time constants.                             *
+* Input:    - ptr to fit, after expfit_add()            *
+*           - tolerance                                 *
+* Return:   1 if known, 0 if not                        *
+********************************************************/
+int expfit_known (struct expfit *f, const double tol)
+{
+if (f->tau > 0.0 && 2.0 * f->sc <= tol && f->tp >= XF_SPAN * f->tau)
+    f->nin++;
+else
+    f->nin = 0;
+return f->nin >= XF_HOLD;
+}
+
+
+/********************************************************
+* cpd_init: Prepares the step detector.                 *
+* Input:    - ptr to detector                           *
+*           - smallest step, threshold                  *
+* Return:   nothing                                     *
+********************************************************/
+void cpd_init (struct cpd *c, const double step, const double h)
+{
+memset (c, 0, sizeof(*c));
+c->step = step;
+c->h = h;
+}
+
+
+/********************************************************
+* cpd_add:  Looks for a step, two-sided CUSUM: the      *
+*           deviations from the mean since the last     *
+*           step, less half a step, are summed up (and  *
+*           the sum kept >= 0); a sum over h is a step. *
+*           It happened when that sum was last 0, and   *
+*           its size is the mean since then against the *
+*           mean before. The readings since the step    *
+*           are the reference for the next one. A slow  *
+*           drift by more than half a step is found as  *
+*           well, once. Constant time per reading.      *
+* Input:    - ptr to detector                           *
+*           - time (s), reading                         *
+* Return:   1 if a step was found (c->t, c->mag etc.),  *
+*           0 if not                                    *
+********************************************************/
+int cpd_add (struct cpd *c, const double t, const double x)
+{
+double  m;
+int     i;
+
+if (c->n0 == 0)
+    {
+    c->s0 = x;
+    c->n0 = 1;
+    return 0;
+    }
+m = c->s0 / c->n0;
+c->s0 += x;
+c->n0++;
+
+for (i = 0; i < 2; i++)
+    {
+    if (c->g[i] == 0.0)     /* a new excursion would start here */
+        {
+        c->sx[i] = 0.0;
+        c->nx[i] = 0;
+        c->tx[i] = t;
+        }
+    c->g[i] += (i ? m - x : x - m) - c->step / 2.0;
+    if (c->g[i] <= 0.0)
+        {
+        c->g[i] = 0.0;
+        continue;
+        }
+    c->sx[i] += x;
+    c->nx[i]++;
+    if (c->g[i] > c->h)
+        break;
+    }
+if (i == 2)
+    return 0;
+
+c->t = c->tx[i];
+c->after = c->sx[i] / c->nx[i];
+c->before = (c->n0 > c->nx[i]) ? (c->s0 - c->sx[i]) / (c->n0 - c->nx[i]) : m;
+c->mag = c->after - c->before;
+c->s0 = c->sx[i];
+c->n0 = c->nx[i];
+c->g[0] = c->g[1] = 0.0;
+return 1;
+}
+
+
+/********************************************************
+* hist_add: Counts a reading in the histogram of its    *
+*           range; integers only, one increment in the  *
+*           common case. A histogram is grown (at least *
+*           doubled) when a count is outside.           *
+* Input:    - histograms, and how many there are        *
+*           - reading (decoded, without error flag)     *
+* Return:   1 if OK, 0 if there are too many ranges,    *
+*           -1 if out of memory                         *
+********************************************************/
+int hist_add (struct hist *h, int *nh, const struct s7150_reading *r)
+{
+static int last = 0;        /* the range does not change often */
+struct  hist *k = h + last;
+int64_t lo, hi, size;
+uint32_t *b;
+int     i;
+
+if (last >= *nh || k->unit != r->unit || k->acdc != r->acdc || k->exp != r->exp)
+    {
+    for (i = 0; i < *nh; i++)
+        if (h[i].unit == r->unit && h[i].acdc == r->acdc && h[i].exp == r->exp)
+            break;
+    if (i == HG_MAXRANGE)
+        return 0;
+    if (i == *nh)
+        {
+        memset (&h[i], 0, sizeof(*h));
+        h[i].unit = r->unit;
+        h[i].acdc = r->acdc;
+        h[i].exp = r->exp;
+        (*nh)++;
+        }
+    last = i;
+    k = h + i;
+    }
+
+if ((uint64_t) ((int64_t) r->count - k->lo) >= k->size)
+    {
+    lo = hi = r->count;
+    if (k->size && k->lo < lo)
+        lo = k->lo;
+    if (k->size && k->lo + (int64_t) k->size - 1 > hi)
+        hi = k->lo + (int64_t) k->size - 1;
+    size = 2 * k->size;
+    if (size < hi - lo + 1)
+        size = hi - lo + 1;
+    if (size < HG_MINSIZE)
+        size = HG_MINSIZE;
+    lo -= (size - (hi - lo + 1)) / 2;       /* room on both sides */
+    if (NULL == (b = calloc(size, sizeof(*b))))
+        return -1;
+    if (k->size)
+        memcpy (b + (k->lo - lo), k->bin, k->size * sizeof(*b));
+    free (k->bin);
+    k->bin = b;
+    k->lo = lo;
+    k->size = size;
+    }
+k->bin[r->count - k->lo]++;
+k->n++;
+return 1;
+}
+
+
+/********************************************************
+* hist_write: Writes the histogram of one range, with   *
+*           DNL and INL (in LSB), and sums it up on     *
+*           stdout. The reference is a uniform          *
+*           distribution (input ramped over the codes;  *
+*           the end codes are left out, they collect    *
+*           what is beyond) or a Gaussian with mean and *
+*           standard deviation of the readings (input   *
+*           constant, with noise; codes expected less   *
+*           than HG_MINEXP times are left out).         *
+*           A missing code is one that has no reading,  *
+*           between two that have.                      *
+* Input:    - file                                      *
+*           - histogram                                 *
+*           - reference, enum hg_ref                    *
+* Return:   nothing                                     *
+********************************************************/
+void hist_write (FILE *fp, const struct hist *h, const int ref)
+{
+long    i, a, z, nmiss = 0, nd = 0;
+double  m = 0.0, sd = 0.0, e = 0.0, dnl, inl = 0.0;
+double  dmin = 0.0, dmax = 0.0, imin = 0.0, imax = 0.0;
+char    label[32];
+
+for (a = 0; a < h->size && h->bin[a] == 0; a++)
+    ;
+for (z = h->size - 1; z > a && h->bin[z] == 0; z--)
+    ;
+sprintf(label, "%.2s %.2s 1e%d", s7150_units[h->unit < U_NUNITS ? h->unit : U_UNKNOWN],
+        h->acdc < AD_UNKNOWN ? s7150_acdcs[h->acdc] : "??", h->exp);
+
+/* the reference: counts per code (ramp), or mean and std (noise) */
+for (i = a; i <= z; i++)
+    {
+    nmiss += (h->bin[i] == 0);
+    m += (double) i * h->bin[i];
+    }
+m /= h->n;
+for (i = a; i <= z; i++)
+    sd += (i - m) * (i - m) * h->bin[i];
+sd = sqrt(sd / h->n);
+if (ref == HG_RAMP && z - a > 1)
+    for (i = a + 1; i < z; i++)
+        e += h->bin[i];
+e = (ref == HG_RAMP && z - a > 1) ? e / (z - a - 1) : 0.0;
+
+fprintf(fp, "# %s: %llu readings, codes %ld...%ld, %ld missing, std %.3f LSB, reference %s\n",
+        label, (unsigned long long) h->n, h->lo + a, h->lo + z, nmiss, sd, hg_names[ref]);
+fprintf(fp, "# count\tn\tdnl\tinl\n");
+for (i = a; i <= z; i++)
+    {
+    if (ref == HG_NOISE && sd > 0.0)
+        e = h->n * 0.5 * (erfc((i - 0.5 - m) / (sd * M_SQRT2)) - erfc((i + 0.5 - m) / (sd * M_SQRT2)));
+    if ((ref == HG_RAMP && (i == a || i == z)) || (ref == HG_NOISE && e < HG_MINEXP) || e <= 0.0)
+        {
+        fprintf(fp, "%ld\t%lu\n", h->lo + i, (unsigned long) h->bin[i]);
+        continue;
+        }
+    dnl = h->bin[i] / e - 1.0;
+    inl += dnl;
+    fprintf(fp, "%ld\t%lu\t%.4f\t%.4f\n", h->lo + i, (unsigned long) h->bin[i], dnl, inl);
+    if (nd++ == 0)
+        dmin = dmax = imin = imax = dnl;
+    dmin = (dnl < dmin) ? dnl : dmin;
+    dmax = (dnl > dmax) ? dnl : dmax;
+    imin = (inl < imin) ? inl : imin;
+    imax = (inl > imax) ? inl : imax;
+    }
+fprintf(fp, "\n");
+
+printf("\n Histogram %s: %llu readings, codes %ld...%ld, %ld missing, std %.3f LSB", label,
+       (unsigned long long) h->n, h->lo + a, h->lo + z, nmiss, sd);
+if (nd)
+    printf("; DNL %+.3f/%+.3f LSB, INL %+.3f/%+.3f LSB over %ld codes (%s).",
+           dmin, dmax, imin, imax, nd, hg_names[ref]);
+else
+    printf("; too few readings per code for DNL/INL.");
+}
+
+
 /********************************************************
 * TIMEINFO: Returns actual time elapsed since The Epoch *
 * Input:    Nothing.                                    *
@@ -689,7 +3208,8 @@ return( ch );
 *  arguments (arguments not introduced by SW).  Opt/arg letters may
 *  be repeated: it is up to the caller to decide if that is an error.
 *
-*  The character SW appearing alone as the last argument is an error.
+*  The character SW appearing alone is not an option but an argument
+*  (as in "-" for stdout), and terminates getOpt.
 *  The lead-in sequence SWSW ("--") causes itself and all the rest
 *  of the line to be ignored (allowing non-options which begin
 *  with the switch char).
@@ -741,7 +3261,7 @@ int GetOpt (int argc, char *argv[], char *optionS)
    {
       if (letP == NULL)
       {
-     if ((letP = argv[optind]) == NULL || *(letP++) != SW)
+     if ((letP = argv[optind]) == NULL || *(letP++) != SW || *letP == 0)
         goto gopEOF;
 
      if (*letP == SW)
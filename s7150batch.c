@@ -0,0 +1,1483 @@
+/* vi:set syntax=c expandtab tabstop=4 shiftwidth=4:
+
+ S 7 1 5 0 B A T C H . C
+
+ Batch analysis of recorded data: statistics, quantiles, Allan deviation
+ and spectrum of many files (or directories of them) at once, on all
+ cores.
+
+ Copyright (c) 2004...2025 by Joerg Hau.
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2 as
+ published by the Free Software Foundation, provided that the copyright
+ notice remains intact even in future versions. See the file LICENSE
+ for details.
+
+ If you use this program (or any part of it) in another application,
+ note that the resulting application becomes also GPL. In other
+ words, GPL is a "contaminating" license.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ --------------------------------------------------------------------
+
+ Modification/history (adapt VERSION below when changing!):
+
+ 2026-10-18     creation
+
+ This should compile with any C compiler, something like:
+
+ gcc -Wall -O2 -o s7150batch s7150batch.c -lm -lpthread
+
+ Works on text files of s7150, s7150duo and s7150sup, and on binary
+ files of s7150 (-b). The files are mapped (see s7150map.h) and cut
+ into chunks of about -s MB, which are the tasks of a pool of threads,
+ one per core. Each thread starts on its own share of the tasks, in
+ file order; when it has done them, it steals from the far end of the
+ share of another, so a few large files keep all cores busy as well as
+ many small ones. The results of the chunks are made to be merged, in
+ file order: moments (Chan et al.), t-digests (see s7150td.h), Allan
+ variance sums per octave of tau, and sums of periodograms (Welch).
+ Blocks of the Allan variance and segments of the spectrum that a
+ chunk end cuts are completed in the merge. These need the number of
+ each sample in the file, so a first, quick pass over the chunks
+ counts their samples.
+
+ The Allan deviation is the non-overlapping one, at tau = 2^k tau0,
+ where tau0 is the mean interval of the samples; like the spectrum, it
+ takes the samples as evenly spaced. Samples without a valid reading
+ leave their block shorter, and the spectrum segment they are in is
+ not used.
+
+*/
+
+#define VERSION "V20261018"     /* String! */
+
+#define _FILE_OFFSET_BITS 64    /* data files > 2 GB */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <errno.h>          /* command line reading */
+#include <unistd.h>
+#include <fcntl.h>
+#include <math.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/time.h>       /* clock timing */
+#include "s7150fmt.h"       /* decoding of readings */
+#include "s7150map.h"       /* binary files, in place */
+#include "s7150td.h"        /* quantiles */
+
+#define MAXLEN   90         /* text buffers etc */
+#define MAXNAME 4096        /* file names found in directories */
+#define CHUNK    16         /* default MB per chunk (-s) */
+#define NFFT   1024         /* default samples per spectrum segment (-n) */
+#define MAXFFT 65536
+#define NOCT     48         /* octaves of tau, at most */
+#define MAXTHREAD 256
+
+#define ERR_FILE  4         /* error code */
+
+/* --- stuff for reading the command line --- */
+
+char *optarg;               /* global: pointer to argument of current option */
+int optind = 1;             /* global: index of which argument is next. Is used
+                            as a global variable for collection of further
+                            arguments (= not options) via argv pointers */
+
+/* --- miscellaneous function prototypes ---- */
+
+double  timeinfo (void);
+int     GetOpt (int argc, char *argv[], char *optionS);
+
+/* --- what to do, the same for all files ---- */
+
+struct opts
+    {
+    int     col;            /* which reading in a line (s7150duo) ... */
+    int     pad;            /* ... and which instrument (s7150sup), -1 = all */
+    int     nfft;           /* samples per spectrum segment, 0 = no spectrum */
+    double  *win;           /* Hann window ... */
+    double  *cs, *sn;       /* ... and the twiddle factors, nfft/2 each */
+    double  wsum;           /* sum of the squared window */
+    const char *outdir;     /* for the result files, NULL = next to the data */
+    };
+
+static struct opts op;      /* set up in main(), only read by the threads */
+
+/* --- Allan variance: the blocks of one octave, as far as a chunk (or
+   the chunks merged so far) sees them. The first and the last block
+   may go on in the neighbours, so they are kept open; of the others
+   (closed), only the first and the last are needed for merging ---- */
+
+struct blk
+    {
+    int64_t j;              /* block number: sample number >> octave */
+    double  s, n;           /* sum and number of the valid readings, n = 0: none */
+    };
+
+struct oct
+    {
+    struct  blk h, t;       /* first and last block, open; t.n = 0 if only one */
+    struct  blk c1, c2;     /* first and last closed block, c1.n = 0 if none */
+    double  ss;             /* sum of squared differences of the means ... */
+    int64_t nd;             /* ... of neighbouring closed blocks */
+    };
+
+/* --- one file, and its chunks ---- */
+
+struct chunk
+    {
+    struct  file *f;
+    size_t  off, end;       /* bytes (text: at line starts) or records */
+    int64_t i0, n;          /* number of the first sample, and samples (pass 1) */
+    double  nv, mean, m2;   /* valid readings, their mean and squared deviations */
+    double  min, max;
+    int64_t nbad;           /* samples without a valid reading */
+    double  tfirst, tlast;  /* time of the first and last sample, in min */
+    int     nc;             /* t-digest clusters ... */
+    struct  s7150_td_c *c;  /* ... once compressed */
+    struct  oct oct[NOCT];
+    double  *psd;           /* sums of periodograms, nfft/2+1 */
+    int64_t nseg, nskip;    /* segments used, and skipped (no valid reading) */
+    double  *head, *tail;   /* samples of the segments cut by the chunk ends */
+    int64_t nhead, ntail, itail;    /* ... how many, number of tail[0] */
+    };
+
+struct file
+    {
+    const char *name;
+    int     bin, sup;       /* binary file, s7150sup file (pad in col. 2) */
+    struct  s7150_map m;    /* binary file ... */
+    const char *text;       /* ... or mapped text file */
+    size_t  size;           /* bytes of the text file that are complete */
+    int     nchunk, noct;
+    struct  chunk *ch;
+    int64_t n;              /* samples */
+    double  nv, mean, std, min, max, q[S7150_TD_NQ];
+    int64_t nbad;
+    double  tau0;           /* mean interval of the samples, in s */
+    int     ok;             /* result files written */
+    };
+
+/* --- the pool: one worker per thread, each with its share of the
+   tasks of a pass (task[head] ... task[tail-1]); the owner takes them
+   from the head, thieves from the tail ---- */
+
+struct pool;
+
+struct worker
+    {
+    pthread_t thread;
+    struct  pool *pool;
+    pthread_mutex_t lock;   /* for head and tail */
+    long    head, tail;
+    unsigned int seed;      /* for picking a victim */
+    unsigned long ntask, nsteal;
+    double  bytes, nsamp;   /* analysed by this thread */
+    double  tcpu;           /* CPU time of this thread, in s */
+    struct  s7150_td *td;   /* scratch */
+    double  *seg, *re, *im; /* scratch for the spectrum */
+    };
+
+struct pool
+    {
+    int     n;
+    struct  worker *w;
+    void    **task;
+    void    (*fn) (void *task, struct worker *w);
+    };
+
+int     addfile (const char *name, struct file **f, int *nf, int *max, int quiet);
+int     scan_dir (const char *dir, struct file **f, int *nf, int *max);
+int     openfile (struct file *f, size_t chunk);
+void    pool_run (struct pool *p, void **task, long ntask, void (*fn) (void *, struct worker *));
+void    *worker_main (void *arg);
+void    count_chunk (void *task, struct worker *w);
+void    analyse_chunk (void *task, struct worker *w);
+void    merge_file (void *task, struct worker *w);
+int     write_results (struct file *f, const struct oct *oct, const double *psd, int64_t nseg, int64_t nskip);
+void    periodogram (const double *x, double *psd, int64_t *nseg, int64_t *nskip, struct worker *w);
+void    fft (double *re, double *im, int n);
+void    oct_push (struct oct *o, int64_t j, double s, double n);
+void    oct_close (struct oct *o, const struct blk *b);
+void    oct_merge (struct oct *a, const struct oct *b);
+void    oct_final (const struct oct *o, int k, int64_t n, double *ss, int64_t *nd);
+
+
+/********************************************************
+* main:       main program.                             *
+* Input:      see below.                                *
+* Return:     0 if OK, else error code                  *
+********************************************************/
+int main (int argc, char *argv[])
+{
+static char *disclaimer =
+"\ns7150batch - Batch analysis of data recorded by s7150. " VERSION ".\n"
+"Copyright (C) 2004...2025 by Joerg Hau.\n\n"
+"This program is free software; you can redistribute it and/or modify it under\n"
+"the terms of the GNU General Public License, version 2, as published by the\n"
+"Free Software Foundation.\n\n"
+"This program is distributed in the hope that it will be useful, but WITHOUT ANY\n"
+"WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A\n"
+"PARTICULAR PURPOSE. See the GNU General Public License for details.\n";
+
+static char *msg = "\nSyntax: s7150batch [-h] [-j threads] [-s MB] [-n nfft] [-k col] [-a id] [-o dir] file|dir [file|dir ...]"
+"\n        -h       this help screen"
+"\n        -j n     threads (default: one per core)"
+"\n        -s MB    size of the chunks the files are cut into (default is 16)"
+"\n        -n nfft  samples per segment of the spectrum, a power of 2"
+"\n                 (default is 1024; 0 = no spectrum)"
+"\n        -k col   which reading of s7150duo files, 1 or 2 (default is 1)"
+"\n        -a id    only instrument at GPIB address 'id' (s7150sup files)"
+"\n        -o dir   write the Allan deviation (file.adev) and the spectrum"
+"\n                 (file.psd) there (default: next to the data file)"
+"\n        dir      all data files in it, and below"
+"\n\nOutput is tab-separated, one line per file: samples, valid readings, mean,"
+"\nstandard deviation, minimum, maximum, samples without valid reading, the"
+"\nquantiles p0.1, p1, p50, p99 and p99.9, and the mean interval (tau0). The"
+"\nthroughput per thread goes to stderr.\n\n";
+
+int     key, i, k, nf = 0, maxf = 0, nthread, ok = 1;
+long    j, nchunk = 0;
+double  t, mb = CHUNK, bytes = 0.0, nsamp = 0.0, tcpu = 0.0;
+struct  stat st;
+struct  file *f = NULL;
+struct  pool pool;
+struct  worker *w;
+void    **task;
+
+memset (&op, 0, sizeof(op));
+op.col = 1;
+op.pad = -1;
+op.nfft = NFFT;
+nthread = sysconf(_SC_NPROCESSORS_ONLN);
+
+/* --- decode and read the command line --- */
+
+while ((key = GetOpt(argc, argv, "hj:s:n:k:a:o:")) != EOF)
+    switch (key)
+        {
+        case 'h':                    /* help me */
+            fprintf (stderr, disclaimer);
+            fprintf (stderr, msg);
+            return 0;
+        case 'j':
+            sscanf (optarg, "%d", &nthread);
+            if (nthread < 1 || nthread > MAXTHREAD)
+                {
+                fprintf(stderr, "Error: threads must be 1 ... %d.\n", MAXTHREAD);
+                return 1;
+                }
+            continue;
+        case 's':
+            sscanf (optarg, "%lf", &mb);
+            if (mb < 0.01)
+                {
+                fprintf(stderr, "Error: chunks must be at least 0.01 MB.\n");
+                return 1;
+                }
+            continue;
+        case 'n':
+            sscanf (optarg, "%d", &op.nfft);
+            if (op.nfft != 0 && (op.nfft < 16 || op.nfft > MAXFFT || (op.nfft & (op.nfft - 1))))
+                {
+                fprintf(stderr, "Error: nfft must be a power of 2, 16 ... %d, or 0.\n", MAXFFT);
+                return 1;
+                }
+            continue;
+        case 'k':
+            sscanf (optarg, "%d", &op.col);
+            if (op.col < 1 || op.col > 2)
+                {
+                fprintf(stderr, "Error: column must be 1 or 2.\n");
+                return 1;
+                }
+            continue;
+        case 'a':
+            sscanf (optarg, "%d", &op.pad);
+            continue;
+        case 'o':
+            op.outdir = optarg;
+            if (stat(optarg, &st) || !S_ISDIR(st.st_mode))
+                {
+                fprintf(stderr, "Error: '%s' is not a directory.\n", optarg);
+                return 1;
+                }
+            continue;
+        case '~':                    /* invalid arg */
+        default:
+        fprintf (stderr, "'%s -h' for help.\n\n", argv[0]);
+            return 1;
+        }
+
+if (argv[optind] == NULL)
+    {
+    fprintf (stderr, msg);
+    fprintf (stderr, "Please specify data files or directories.\n");
+    return 1;
+    }
+
+/* window and twiddle factors, once for all */
+if (op.nfft)
+    {
+    op.win = malloc(op.nfft * sizeof(double));
+    op.cs = malloc(op.nfft / 2 * sizeof(double));
+    op.sn = malloc(op.nfft / 2 * sizeof(double));
+    if (!op.win || !op.cs || !op.sn)
+        {
+        fprintf(stderr, "Out of memory.\n");
+        return ERR_FILE;
+        }
+    for (i = 0; i < op.nfft; i++)
+        {
+        op.win[i] = 0.5 - 0.5 * cos(2.0 * M_PI * i / op.nfft);
+        op.wsum += op.win[i] * op.win[i];
+        }
+    for (i = 0; i < op.nfft / 2; i++)
+        {
+        op.cs[i] = cos(2.0 * M_PI * i / op.nfft);
+        op.sn[i] = sin(2.0 * M_PI * i / op.nfft);
+        }
+    }
+
+/* --- the files, cut into chunks --- */
+
+t = timeinfo();
+for (i = optind; i < argc; i++)
+    {
+    if (stat(argv[i], &st))
+        {
+        fprintf(stderr, "Could not open '%s'.\n", argv[i]);
+        ok = 0;
+        }
+    else if (S_ISDIR(st.st_mode))
+        ok &= scan_dir(argv[i], &f, &nf, &maxf);
+    else
+        ok &= addfile(argv[i], &f, &nf, &maxf, 0);
+    }
+for (i = 0; i < nf; i++)
+    {
+    if (0 == openfile(&f[i], (size_t) (mb * 1048576.0)))
+        {
+        fprintf(stderr, "Out of memory.\n");
+        return ERR_FILE;
+        }
+    nchunk += f[i].nchunk;
+    }
+if (nchunk == 0)
+    {
+    fprintf(stderr, "No data.\n");
+    return ERR_FILE;
+    }
+
+/* --- the pool --- */
+
+if (nthread > nchunk)
+    nthread = nchunk;
+pool.n = nthread;
+pool.w = calloc(nthread, sizeof(*pool.w));
+task = malloc((nchunk > nf ? nchunk : nf) * sizeof(*task));
+if (!pool.w || !task)
+    {
+    fprintf(stderr, "Out of memory.\n");
+    return ERR_FILE;
+    }
+for (i = 0; i < nthread; i++)
+    {
+    w = &pool.w[i];
+    w->pool = &pool;
+    w->seed = i + 1;
+    pthread_mutex_init(&w->lock, NULL);
+    w->td = malloc(sizeof(*w->td));
+    if (op.nfft)
+        {
+        w->seg = malloc(op.nfft * sizeof(double));
+        w->re = malloc(op.nfft * sizeof(double));
+        w->im = malloc(op.nfft * sizeof(double));
+        }
+    if (!w->td || (op.nfft && (!w->seg || !w->re || !w->im)))
+        {
+        fprintf(stderr, "Out of memory.\n");
+        return ERR_FILE;
+        }
+    }
+
+/* pass 1: samples per chunk, so every sample gets its number */
+for (i = 0, j = 0; i < nf; i++)
+    for (k = 0; k < f[i].nchunk; k++)
+        task[j++] = &f[i].ch[k];
+pool_run(&pool, task, nchunk, count_chunk);
+for (i = 0; i < nf; i++)
+    {
+    f[i].n = 0;
+    for (k = 0; k < f[i].nchunk; k++)
+        {
+        f[i].ch[k].i0 = f[i].n;
+        f[i].n += f[i].ch[k].n;
+        }
+    /* octaves with at least two blocks */
+    for (f[i].noct = 0; f[i].noct < NOCT && (2LL << f[i].noct) <= f[i].n; f[i].noct++)
+        ;
+    }
+
+/* pass 2: the chunks; pass 3: merged per file */
+pool_run(&pool, task, nchunk, analyse_chunk);
+for (i = 0; i < nf; i++)
+    task[i] = &f[i];
+pool_run(&pool, task, nf, merge_file);
+t = timeinfo() - t;
+
+printf("# s7150batch " VERSION ": %d files\n", nf);
+printf("# file\tsamples\tn\tmean\tstd\tmin\tmax\tbad");
+for (i = 0; i < S7150_TD_NQ; i++)
+    printf("\t%s", s7150_td_qname[i]);
+printf("\ttau0/s\n");
+for (i = 0; i < nf; i++)
+    {
+    printf("%s\t%lld\t%.0f", f[i].name, (long long) f[i].n, f[i].nv);
+    if (f[i].nv > 0.0)
+        printf("\t%.7g\t%.7g\t%.7g\t%.7g", f[i].mean, f[i].std, f[i].min, f[i].max);
+    else
+        printf("\t\t\t\t");
+    printf("\t%lld", (long long) f[i].nbad);
+    for (k = 0; k < S7150_TD_NQ; k++)
+        if (f[i].nv > 0.0)
+            printf("\t%.7g", f[i].q[k]);
+        else
+            printf("\t");
+    printf("\t%.6g\n", f[i].tau0);
+    ok &= f[i].ok;
+    if (f[i].bin)
+        s7150_map_close(&f[i].m);
+    else if (f[i].text)
+        munmap((void *) f[i].text, f[i].size);
+    }
+
+/* throughput: of all, and per thread and its CPU time */
+for (i = 0; i < nthread; i++)
+    {
+    bytes += pool.w[i].bytes;
+    nsamp += pool.w[i].nsamp;
+    tcpu += pool.w[i].tcpu;
+    }
+fprintf(stderr, "# %d threads: %.1f MB, %.3f Msamples in %.2f s: %.1f MB/s, %.2f Msamples/s;"
+        " CPU %.2f s (%.1f cores busy)\n", nthread, bytes / 1e6, nsamp / 1e6, t,
+        bytes / 1e6 / t, nsamp / 1e6 / t, tcpu, tcpu / t);
+fprintf(stderr, "# thread  tasks  stolen        MB  Msamples   CPU s   MB/s   Msamples/s (per CPU s)\n");
+for (i = 0; i < nthread; i++)
+    {
+    w = &pool.w[i];
+    fprintf(stderr, "# %6d %6lu %7lu %9.1f %9.3f %7.2f %6.1f %12.2f\n", i, w->ntask, w->nsteal,
+            w->bytes / 1e6, w->nsamp / 1e6, w->tcpu, w->tcpu > 0.0 ? w->bytes / 1e6 / w->tcpu : 0.0,
+            w->tcpu > 0.0 ? w->nsamp / 1e6 / w->tcpu : 0.0);
+    }
+return ok ? 0 : ERR_FILE;
+}
+
+
+/********************************************************
+* addfile:  Takes a file into the list if it is a data  *
+*           file of s7150, s7150duo or s7150sup.        *
+* Input:    - name                                      *
+*           - list, its length and allocated length     *
+*           - 1 if other files are skipped quietly      *
+* Return:   1 if OK (or skipped quietly), 0 if error    *
+********************************************************/
+int addfile (const char *name, struct file **f, int *nf, int *max, int quiet)
+{
+char    head[16];
+struct  file *p;
+FILE    *fp;
+size_t  n;
+int     bin, text;
+
+if (NULL == (fp = fopen(name, "rb")))
+    {
+    fprintf(stderr, "Could not open '%s'.\n", name);
+    return 0;
+    }
+n = fread(head, 1, sizeof(head), fp);
+fclose(fp);
+bin = (n >= 8 && !memcmp(head, S7150_MAGIC, 8));
+text = (n >= 11 && (!strncmp(head, "# s7150 ", 8) || !strncmp(head, "# s7150duo ", 11) || \
+                    !strncmp(head, "# s7150sup ", 11)));
+if (!bin && !text)
+    {
+    if (!quiet)
+        fprintf(stderr, "'%s' is not a data file.\n", name);
+    return quiet;
+    }
+
+if (*nf == *max)
+    {
+    if (NULL == (p = realloc(*f, (*max ? 2 * *max : 64) * sizeof(*p))))
+        return 0;
+    *f = p;
+    *max = *max ? 2 * *max : 64;
+    }
+p = &(*f)[(*nf)++];
+memset (p, 0, sizeof(*p));
+p->name = strdup(name);
+p->bin = bin;
+p->sup = !strncmp(head, "# s7150sup", 10);
+return p->name != NULL;
+}
+
+
+/********************************************************
+* scan_dir: Takes the data files in a directory, and in *
+*           those below, into the list.                 *
+* Input:    - directory                                 *
+*           - list, its length and allocated length     *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+int scan_dir (const char *dir, struct file **f, int *nf, int *max)
+{
+DIR     *d;
+struct  dirent *de;
+struct  stat st;
+char    path[MAXNAME];
+int     ok = 1;
+
+if (NULL == (d = opendir(dir)))
+    {
+    fprintf(stderr, "Could not read directory '%s'.\n", dir);
+    return 0;
+    }
+while (NULL != (de = readdir(d)))
+    {
+    if (de->d_name[0] == '.')
+        continue;
+    if (snprintf(path, sizeof(path), "%s/%s", dir, de->d_name) >= (int) sizeof(path) || lstat(path, &st))
+        continue;
+    if (S_ISDIR(st.st_mode))
+        ok &= scan_dir(path, f, nf, max);
+    else if (S_ISREG(st.st_mode))
+        ok &= addfile(path, f, nf, max, 1);
+    }
+closedir(d);
+return ok;
+}
+
+
+/********************************************************
+* openfile: Maps a file and cuts it into chunks; those  *
+*           of text files start at the start of a line. *
+*           Only what the writer has committed is used  *
+*           (see s7150fmt.h).                           *
+* Input:    - file                                      *
+*           - bytes per chunk                           *
+* Return:   1 if OK (also if the file can't be read:    *
+*           it has no chunks then), 0 if out of memory  *
+********************************************************/
+int openfile (struct file *f, size_t chunk)
+{
+struct  stat st;
+size_t  n, i, off, end;
+int64_t len;
+const char *p;
+int     fd;
+
+if (f->bin)
+    {
+    if (0 == s7150_map_open(f->name, &f->m))
+        {
+        fprintf(stderr, "Could not open '%s'.\n", f->name);
+        return 1;
+        }
+    chunk /= sizeof(struct s7150_rec);
+    n = f->m.nrec;
+    }
+else
+    {
+    if ((fd = open(f->name, O_RDONLY)) < 0 || fstat(fd, &st))
+        {
+        fprintf(stderr, "Could not open '%s'.\n", f->name);
+        if (fd >= 0)
+            close(fd);
+        return 1;
+        }
+    f->size = n = st.st_size;
+    if (s7150_committed(f->name, &len) >= 0 && (size_t) len < n)
+        n = len;
+    f->text = mmap(NULL, f->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (f->text == MAP_FAILED)
+        {
+        fprintf(stderr, "Could not map '%s'.\n", f->name);
+        f->text = NULL;
+        return 1;
+        }
+    posix_madvise((void *) f->text, f->size, POSIX_MADV_SEQUENTIAL);
+    }
+
+if (chunk < 1)
+    chunk = 1;
+f->nchunk = (n + chunk - 1) / chunk;
+if (f->nchunk == 0)
+    return 1;
+if (NULL == (f->ch = calloc(f->nchunk, sizeof(*f->ch))))
+    return 0;
+for (i = 0, off = 0; i < (size_t) f->nchunk; i++, off = end)
+    {
+    end = (i + 1) * chunk;
+    if (end > n)
+        end = n;
+    /* text: a line belongs to the chunk it starts in */
+    if (!f->bin && end < n)
+        end = (p = memchr(f->text + end - 1, '\n', n - end + 1)) ? (size_t) (p - f->text) + 1 : n;
+    f->ch[i].f = f;
+    f->ch[i].off = off;
+    f->ch[i].end = (end > off) ? end : off;
+    }
+return 1;
+}
+
+
+/********************************************************
+* pool_run: Does the tasks of one pass on all threads,  *
+*           and returns when all are done. Each thread  *
+*           gets an equal share of consecutive tasks to *
+*           start with.                                 *
+* Input:    - pool                                      *
+*           - the tasks, and how many                   *
+*           - function that does one                    *
+* Return:   nothing                                     *
+********************************************************/
+void pool_run (struct pool *p, void **task, long ntask, void (*fn) (void *, struct worker *))
+{
+int i;
+
+p->task = task;
+p->fn = fn;
+for (i = 0; i < p->n; i++)
+    {
+    p->w[i].head = ntask * i / p->n;
+    p->w[i].tail = ntask * (i + 1) / p->n;
+    }
+for (i = 1; i < p->n; i++)
+    if (pthread_create(&p->w[i].thread, NULL, worker_main, &p->w[i]))
+        {
+        fprintf(stderr, "Could not start thread %d, its share goes to the others.\n", i);
+        p->w[i].thread = 0;
+        }
+worker_main(&p->w[0]);      /* this thread is one of them */
+for (i = 1; i < p->n; i++)
+    if (p->w[i].thread)
+        pthread_join(p->w[i].thread, NULL);
+}
+
+
+/********************************************************
+* worker_main: One thread of the pool: its own tasks    *
+*           first, then those of the others. No task    *
+*           makes new ones, so when no thread has any   *
+*           left, the pass is done.                     *
+* Input:    the worker                                  *
+* Return:   NULL                                        *
+********************************************************/
+void *worker_main (void *arg)
+{
+struct  worker *w = arg, *v;
+struct  pool *p = w->pool;
+struct  timespec t0, t1;
+void    *task;
+int     i, first;
+
+clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t0);
+do  {
+    task = NULL;
+    pthread_mutex_lock(&w->lock);
+    if (w->head < w->tail)
+        task = p->task[w->head++];
+    pthread_mutex_unlock(&w->lock);
+
+    /* steal from the far end of another share */
+    first = rand_r(&w->seed) % p->n;
+    for (i = 0; task == NULL && i < p->n; i++)
+        {
+        v = &p->w[(first + i) % p->n];
+        if (v == w)
+            continue;
+        pthread_mutex_lock(&v->lock);
+        if (v->head < v->tail)
+            task = p->task[--v->tail];
+        pthread_mutex_unlock(&v->lock);
+        if (task)
+            w->nsteal++;
+        }
+
+    if (task)
+        {
+        p->fn(task, w);
+        w->ntask++;
+        }
+    }
+    while (task);
+clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t1);
+w->tcpu += (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+return NULL;
+}
+
+
+/********************************************************
+* text_line: Checks a line of a text file: is it a      *
+*           sample (of the instrument asked for), and   *
+*           where is its reading.                       *
+* Input:    - the line, without '\n'                    *
+*           - 1 if written by s7150sup (pad in col. 2)  *
+*           - where to put the reading, or NULL         *
+* Return:   1 if a sample (the reading is NULL if it is *
+*           missing), 0 if not                          *
+********************************************************/
+static inline int text_line (const char *p, const char *q, int sup, const char **rd)
+{
+const char *t;
+int i;
+
+if (p == q || *p == '#')
+    return 0;
+t = memchr(p, '\t', q - p);
+if (sup && op.pad >= 0 && (t == NULL || atoi(t + 1) != op.pad))
+    return 0;
+if (rd)
+    {
+    for (i = sup ? 0 : 1; t && i < op.col; i++)
+        t = memchr(t + 1, '\t', q - t - 1);
+    *rd = (t && q - t - 1 >= S7150_LEN) ? t + 1 : NULL;
+    }
+return 1;
+}
+
+
+/********************************************************
+* count_chunk: Pass 1, the number of samples in a chunk.*
+* Input:    - the chunk                                 *
+*           - the worker doing it                       *
+* Return:   nothing                                     *
+********************************************************/
+void count_chunk (void *task, struct worker *w)
+{
+struct  chunk *c = task;
+struct  file *f = c->f;
+const struct s7150_rec *r;
+const char *p, *q, *end;
+size_t  i;
+
+(void) w;                   /* a task like the others, but needs no worker */
+c->n = 0;
+if (f->bin)
+    {
+    r = f->m.rec;
+    for (i = c->off; i < c->end; i++)
+        c->n += (r[i].chan == op.col - 1);
+    return;
+    }
+end = f->text + c->end;
+for (p = f->text + c->off; p < end && NULL != (q = memchr(p, '\n', end - p)); p = q + 1)
+    c->n += text_line(p, q, f->sup, NULL);
+}
+
+
+/********************************************************
+* oct_add:  Adds a block of octave k to the results of  *
+*           a chunk. The octave above gets the blocks   *
+*           of this one when they are complete, that is *
+*           when the next one begins (or at the end of  *
+*           the chunk: see analyse_chunk()), so most    *
+*           readings are added once or twice, not once  *
+*           per octave.                                 *
+* Input:    - chunk                                     *
+*           - octave, and the block                     *
+* Return:   nothing                                     *
+********************************************************/
+static inline void oct_add (struct chunk *c, int k, struct blk b)
+{
+struct  oct *o;
+struct  blk *l, up;
+
+for (; k < c->f->noct; k++, b = up)
+    {
+    o = &c->oct[k];
+    l = (o->t.n > 0.0) ? &o->t : &o->h;
+    if (o->h.n > 0.0 && l->j == b.j)
+        {
+        l->s += b.s;
+        l->n += b.n;
+        return;
+        }
+    if (o->h.n == 0.0)
+        {
+        oct_push(o, b.j, b.s, b.n);
+        return;
+        }
+    up = *l;                /* complete now */
+    up.j >>= 1;
+    oct_push(o, b.j, b.s, b.n);
+    }
+}
+
+
+/********************************************************
+* sample:   Adds one sample to the results of a chunk.  *
+* Input:    - chunk, worker                             *
+*           - number of the sample in the file          *
+*           - 1 if it has a valid reading, and its value*
+* Return:   nothing                                     *
+********************************************************/
+static inline void sample (struct chunk *c, struct worker *w, int64_t idx, int ok, double v)
+{
+struct  blk b;
+double  d, x = ok ? v : NAN;
+
+if (ok)
+    {
+    /* Welford: stable in one pass */
+    if (c->nv == 0.0 || v < c->min)
+        c->min = v;
+    if (c->nv == 0.0 || v > c->max)
+        c->max = v;
+    c->nv += 1.0;
+    d = v - c->mean;
+    c->mean += d / c->nv;
+    c->m2 += d * (v - c->mean);
+    s7150_td_add(w->td, v, 1.0);
+    b.j = idx;
+    b.s = v;
+    b.n = 1.0;
+    oct_add(c, 0, b);
+    }
+else
+    c->nbad++;
+
+/* spectrum: the segments cut by the chunk ends are kept */
+if (op.nfft == 0)
+    return;
+if (idx < c->i0 + c->nhead)
+    c->head[idx - c->i0] = x;
+else if (idx >= c->itail)
+    c->tail[idx - c->itail] = x;
+else
+    {
+    w->seg[idx & (op.nfft - 1)] = x;
+    if ((idx & (op.nfft - 1)) == op.nfft - 1)
+        periodogram(w->seg, c->psd, &c->nseg, &c->nskip, w);
+    }
+}
+
+
+/********************************************************
+* analyse_chunk: Pass 2, the results of a chunk.        *
+* Input:    - the chunk                                 *
+*           - the worker doing it                       *
+* Return:   nothing                                     *
+********************************************************/
+void analyse_chunk (void *task, struct worker *w)
+{
+struct  chunk *c = task;
+struct  file *f = c->f;
+struct  s7150_iter it;
+struct  s7150_span s;
+struct  s7150_reading r;
+const char *p, *q, *end, *rd, *last = NULL;
+struct  blk b;
+int64_t idx = c->i0, nfft = op.nfft;
+size_t  i;
+int     ok, k;
+
+if (c->n == 0)
+    return;
+s7150_td_init(w->td);
+
+/* the segments cut by the chunk ends */
+if (nfft)
+    {
+    c->nhead = (c->i0 % nfft) ? nfft - c->i0 % nfft : 0;
+    if (c->nhead > c->n)
+        c->nhead = c->n;
+    c->itail = (c->i0 + c->n) / nfft * nfft;
+    if (c->itail < c->i0 + c->nhead)
+        c->itail = c->i0 + c->nhead;
+    c->ntail = c->i0 + c->n - c->itail;
+    c->psd = calloc(nfft / 2 + 1, sizeof(double));
+    c->head = c->nhead ? malloc(c->nhead * sizeof(double)) : NULL;
+    c->tail = c->ntail ? malloc(c->ntail * sizeof(double)) : NULL;
+    if (!c->psd || (c->nhead && !c->head) || (c->ntail && !c->tail))
+        {
+        fprintf(stderr, "Out of memory.\n");
+        exit(ERR_FILE);
+        }
+    }
+
+if (f->bin)
+    {
+    s7150_iter_init(&it, s7150_map_span(&f->m, c->off, c->end));
+    while (s7150_iter_chunk(&it, &s))
+        for (i = 0; i < s.n; i++)
+            {
+            if (s.rec[i].chan != op.col - 1)
+                continue;
+            if (idx == c->i0)
+                c->tfirst = s.rec[i].t_us / 6e7;
+            c->tlast = s.rec[i].t_us / 6e7;
+            ok = s7150_fromrec(&s.rec[i], &r) && r.eflag == EF_OK;
+            sample(c, w, idx++, ok, ok ? s7150_value(&r) : 0.0);
+            }
+    w->bytes += (c->end - c->off) * sizeof(struct s7150_rec);
+    }
+else
+    {
+    end = f->text + c->end;
+    for (p = f->text + c->off; p < end && NULL != (q = memchr(p, '\n', end - p)); p = q + 1)
+        {
+        if (!text_line(p, q, f->sup, &rd))
+            continue;
+        if (idx == c->i0)
+            c->tfirst = strtod(p, NULL);
+        last = p;
+        ok = rd && s7150_decode(rd, &r) && r.eflag == EF_OK;
+        sample(c, w, idx++, ok, ok ? s7150_value(&r) : 0.0);
+        }
+    if (last)
+        c->tlast = strtod(last, NULL);
+    w->bytes += c->end - c->off;
+    }
+w->nsamp += c->n;
+
+/* the last blocks are complete as far as this chunk goes */
+for (k = 0; k + 1 < f->noct; k++)
+    if (c->oct[k].h.n > 0.0)
+        {
+        b = (c->oct[k].t.n > 0.0) ? c->oct[k].t : c->oct[k].h;
+        b.j >>= 1;
+        oct_add(c, k + 1, b);
+        }
+
+/* the digest, compressed, is all that is kept of it */
+s7150_td_compress(w->td);
+c->nc = w->td->nc;
+if (NULL == (c->c = malloc((c->nc ? c->nc : 1) * sizeof(*c->c))))
+    {
+    fprintf(stderr, "Out of memory.\n");
+    exit(ERR_FILE);
+    }
+memcpy (c->c, w->td->c, c->nc * sizeof(*c->c));
+}
+
+
+/********************************************************
+* merge_file: Pass 3, the results of a file from those  *
+*           of its chunks, in order; writes them.       *
+* Input:    - the file                                  *
+*           - the worker doing it                       *
+* Return:   nothing                                     *
+********************************************************/
+void merge_file (void *task, struct worker *w)
+{
+struct  file *f = task;
+struct  chunk *c;
+struct  oct oct[NOCT];
+double  d, n, m2 = 0.0, tfirst = 0.0, tlast = 0.0, *psd = NULL;
+int64_t nseg = 0, nskip = 0, npend = 0, nfft = op.nfft;
+int     i, k;
+
+memset (oct, 0, sizeof(oct));
+s7150_td_init(w->td);
+if (nfft && NULL == (psd = calloc(nfft / 2 + 1, sizeof(double))))
+    {
+    fprintf(stderr, "Out of memory.\n");
+    exit(ERR_FILE);
+    }
+
+for (i = 0; i < f->nchunk; i++)
+    {
+    c = &f->ch[i];
+    if (c->n == 0)
+        continue;
+    if (c->i0 == 0)
+        tfirst = c->tfirst;
+    tlast = c->tlast;
+    f->nbad += c->nbad;
+
+    /* moments (Chan et al.) */
+    if (c->nv > 0.0)
+        {
+        if (f->nv == 0.0 || c->min < f->min)
+            f->min = c->min;
+        if (f->nv == 0.0 || c->max > f->max)
+            f->max = c->max;
+        n = f->nv + c->nv;
+        d = c->mean - f->mean;
+        f->mean += d * c->nv / n;
+        m2 += c->m2 + d * d * f->nv * c->nv / n;
+        f->nv = n;
+        }
+    for (k = 0; k < c->nc; k++)
+        s7150_td_add(w->td, c->c[k].mean, c->c[k].w);
+    for (k = 0; k < f->noct; k++)
+        oct_merge(&oct[k], &c->oct[k]);
+
+    /* spectrum: the head completes the segment the last tail began */
+    if (nfft)
+        {
+        memcpy (w->seg + npend, c->head, c->nhead * sizeof(double));
+        npend += c->nhead;
+        if (npend == nfft)
+            {
+            periodogram(w->seg, psd, &nseg, &nskip, w);
+            npend = 0;
+            }
+        for (k = 0; k <= nfft / 2; k++)
+            psd[k] += c->psd[k];
+        nseg += c->nseg;
+        nskip += c->nskip;
+        if (c->ntail)
+            {
+            memcpy (w->seg, c->tail, c->ntail * sizeof(double));
+            npend = c->ntail;
+            }
+        }
+    free (c->c);
+    free (c->psd);
+    free (c->head);
+    free (c->tail);
+    }
+
+f->std = f->nv > 1.0 ? sqrt(m2 / (f->nv - 1.0)) : 0.0;
+f->tau0 = f->n > 1 ? 60.0 * (tlast - tfirst) / (f->n - 1) : 0.0;
+if (f->nv > 0.0)
+    {
+    w->td->min = f->min;        /* exact, the clusters are not */
+    w->td->max = f->max;
+    for (k = 0; k < S7150_TD_NQ; k++)
+        f->q[k] = s7150_td_quantile(w->td, s7150_td_q[k]);
+    }
+f->ok = write_results(f, oct, psd, nseg, nskip);
+free (psd);
+free (f->ch);
+}
+
+
+/********************************************************
+* write_results: Writes Allan deviation (file.adev) and *
+*           spectrum (file.psd) of a file.              *
+* Input:    - the file                                  *
+*           - Allan variance sums per octave            *
+*           - sums of periodograms, segments used and   *
+*             skipped                                   *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+int write_results (struct file *f, const struct oct *oct, const double *psd, int64_t nseg, int64_t nskip)
+{
+char    name[MAXNAME+8];
+const char *base;
+FILE    *fp;
+double  ss, scale;
+int64_t nd;
+int     k, ok = 1;
+
+if (f->tau0 <= 0.0)
+    return 1;           /* too few samples */
+base = op.outdir ? ((base = strrchr(f->name, '/')) ? base + 1 : f->name) : f->name;
+
+snprintf(name, sizeof(name), "%s%s%s.adev", op.outdir ? op.outdir : "", op.outdir ? "/" : "", base);
+if (NULL == (fp = fopen(name, "wt")))
+    {
+    fprintf(stderr, "Could not open '%s' for writing.\n", name);
+    return 0;
+    }
+fprintf(fp, "# s7150batch " VERSION ": Allan deviation of %s\n", f->name);
+fprintf(fp, "# tau0 %.6g s (mean interval), %lld samples, %.0f valid\n", f->tau0,
+        (long long) f->n, f->nv);
+fprintf(fp, "# tau/s\tadev\tpairs\n");
+for (k = 0; k < f->noct; k++)
+    {
+    oct_final(&oct[k], k, f->n, &ss, &nd);
+    if (nd > 0)
+        fprintf(fp, "%.6g\t%.4g\t%lld\n", f->tau0 * ((int64_t) 1 << k), sqrt(ss / (2.0 * nd)), (long long) nd);
+    }
+ok &= !(ferror(fp) | fclose(fp));
+
+if (op.nfft && nseg > 0)
+    {
+    snprintf(name, sizeof(name), "%s%s%s.psd", op.outdir ? op.outdir : "", op.outdir ? "/" : "", base);
+    if (NULL == (fp = fopen(name, "wt")))
+        {
+        fprintf(stderr, "Could not open '%s' for writing.\n", name);
+        return 0;
+        }
+    fprintf(fp, "# s7150batch " VERSION ": spectrum of %s\n", f->name);
+    fprintf(fp, "# Welch, Hann window, %d samples per segment, %lld segments (%lld skipped)\n",
+            op.nfft, (long long) nseg, (long long) nskip);
+    fprintf(fp, "# f/Hz\tPSD (unit^2/Hz)\n");
+    /* one-sided: twice the power, but at 0 and nfft/2 */
+    scale = f->tau0 / (op.wsum * nseg);
+    for (k = 1; k <= op.nfft / 2; k++)
+        fprintf(fp, "%.6g\t%.4g\n", k / (op.nfft * f->tau0), psd[k] * scale * (k < op.nfft / 2 ? 2.0 : 1.0));
+    ok &= !(ferror(fp) | fclose(fp));
+    }
+if (!ok)
+    fprintf(stderr, "Could not write the results of '%s'.\n", f->name);
+return ok;
+}
+
+
+/********************************************************
+* periodogram: Adds the periodogram of one segment, if  *
+*           all of its samples have a valid reading.    *
+* Input:    - nfft samples, NaN where not valid         *
+*           - sums of periodograms, segments used and   *
+*             skipped                                   *
+*           - the worker (scratch)                      *
+* Return:   nothing                                     *
+********************************************************/
+void periodogram (const double *x, double *psd, int64_t *nseg, int64_t *nskip, struct worker *w)
+{
+double  mean = 0.0;
+int     i;
+
+for (i = 0; i < op.nfft; i++)
+    mean += x[i];
+if (isnan(mean))
+    {
+    (*nskip)++;
+    return;
+    }
+mean /= op.nfft;
+for (i = 0; i < op.nfft; i++)
+    {
+    w->re[i] = (x[i] - mean) * op.win[i];
+    w->im[i] = 0.0;
+    }
+fft(w->re, w->im, op.nfft);
+for (i = 0; i <= op.nfft / 2; i++)
+    psd[i] += w->re[i] * w->re[i] + w->im[i] * w->im[i];
+(*nseg)++;
+}
+
+
+/********************************************************
+* fft:      Fourier transform in place, radix 2, with   *
+*           the twiddle factors of op.                  *
+* Input:    - real and imaginary parts                  *
+*           - length, a power of 2 (op.nfft)            *
+* Return:   nothing                                     *
+********************************************************/
+void fft (double *re, double *im, int n)
+{
+int     i, j, k, len, step;
+double  tr, ti, wr, wi;
+
+for (i = 1, j = 0; i < n; i++)
+    {
+    for (k = n >> 1; j & k; k >>= 1)
+        j ^= k;
+    j |= k;
+    if (i < j)
+        {
+        tr = re[i]; re[i] = re[j]; re[j] = tr;
+        ti = im[i]; im[i] = im[j]; im[j] = ti;
+        }
+    }
+for (len = 2; len <= n; len <<= 1)
+    {
+    step = n / len;
+    for (i = 0; i < n; i += len)
+        for (k = 0; k < len / 2; k++)
+            {
+            wr = op.cs[k * step];
+            wi = -op.sn[k * step];
+            j = i + k + len / 2;
+            tr = re[j] * wr - im[j] * wi;
+            ti = re[j] * wi + im[j] * wr;
+            re[j] = re[i+k] - tr;
+            im[j] = im[i+k] - ti;
+            re[i+k] += tr;
+            im[i+k] += ti;
+            }
+    }
+}
+
+
+/********************************************************
+* oct_close: Appends a closed block, with the squared   *
+*           difference to the one before (if that one   *
+*           is its neighbour).                          *
+* Input:    - the octave                                *
+*           - the block                                 *
+* Return:   nothing                                     *
+********************************************************/
+void oct_close (struct oct *o, const struct blk *b)
+{
+double d;
+
+if (o->c2.n > 0.0 && b->j == o->c2.j + 1)
+    {
+    d = b->s / b->n - o->c2.s / o->c2.n;
+    o->ss += d * d;
+    o->nd++;
+    }
+if (o->c1.n == 0.0)
+    o->c1 = *b;
+o->c2 = *b;
+}
+
+
+/********************************************************
+* oct_push: Adds readings to block j; a new block       *
+*           closes the last one (never the first).      *
+* Input:    - the octave                                *
+*           - block number (not before the last one)    *
+*           - sum and number of the readings            *
+* Return:   nothing                                     *
+********************************************************/
+void oct_push (struct oct *o, int64_t j, double s, double n)
+{
+struct blk *l = (o->t.n > 0.0) ? &o->t : &o->h;
+
+if (o->h.n == 0.0)
+    l = NULL;
+if (l && l->j == j)
+    {
+    l->s += s;
+    l->n += n;
+    return;
+    }
+if (l == NULL)
+    l = &o->h;
+else
+    {
+    if (o->t.n > 0.0)
+        oct_close(o, &o->t);
+    l = &o->t;
+    }
+l->j = j;
+l->s = s;
+l->n = n;
+}
+
+
+/********************************************************
+* oct_merge: Appends what a chunk found to what those   *
+*           before it found: where they meet, the open  *
+*           blocks are joined or closed.                *
+* Input:    - the octave so far                         *
+*           - the octave of the next chunk              *
+* Return:   nothing                                     *
+********************************************************/
+void oct_merge (struct oct *a, const struct oct *b)
+{
+if (b->h.n == 0.0)
+    return;
+if (a->h.n == 0.0)
+    {
+    *a = *b;
+    return;
+    }
+oct_push(a, b->h.j, b->h.s, b->h.n);
+if (b->t.n == 0.0)
+    return;                 /* b was one block */
+
+/* more follows: what is last in a now is closed (unless it is the first) */
+if (a->t.n > 0.0)
+    oct_close(a, &a->t);
+if (b->c1.n > 0.0)
+    {
+    oct_close(a, &b->c1);
+    a->ss += b->ss;
+    a->nd += b->nd;
+    a->c2 = b->c2;
+    }
+a->t = b->t;
+}
+
+
+/********************************************************
+* oct_final: Allan variance sums of a whole file: the   *
+*           first and the last block count if they are  *
+*           complete.                                   *
+* Input:    - the octave, and its number k              *
+*           - samples in the file                       *
+*           - ptrs to sum of squared differences, and   *
+*             their number                              *
+* Return:   nothing                                     *
+********************************************************/
+void oct_final (const struct oct *o, int k, int64_t n, double *ss, int64_t *nd)
+{
+struct oct f;
+
+memset (&f, 0, sizeof(f));
+if (o->h.n > 0.0 && ((o->h.j + 1) << k) <= n)
+    oct_close(&f, &o->h);
+if (o->c1.n > 0.0)
+    {
+    oct_close(&f, &o->c1);
+    f.ss += o->ss;
+    f.nd += o->nd;
+    f.c2 = o->c2;
+    }
+if (o->t.n > 0.0 && ((o->t.j + 1) << k) <= n)
+    oct_close(&f, &o->t);
+*ss = f.ss;
+*nd = f.nd;
+}
+
+
+/********************************************************
+* TIMEINFO: Returns actual time elapsed since The Epoch *
+* Input:    Nothing.                                    *
+* Return:   time in microseconds                        *
+* Note:     #include <time.h>                           *
+*           #include <sys/time.h>                       *
+********************************************************/
+double timeinfo (void)
+{
+struct timeval t;
+
+gettimeofday(&t, NULL);
+return (double)t.tv_sec + (double)t.tv_usec/1000000.0;
+}
+
+
+/***************************************************************************
+* GETOPT: Command line parser, system V style.
+*
+*  Widely (and wildly) adapted from code published by Borland Intl. Inc.
+*
+*  Note that libc has a function getopt(), however this is not guaranteed
+*  to be available for other compilers. Therefore we provide *this* function
+*  (which does the same).
+*
+*  Standard option syntax is:
+*
+*    option ::= SW [optLetter]* [argLetter space* argument]
+*
+*  where
+*    - SW is '-'
+*    - there is no space before any optLetter or argLetter.
+*    - opt/arg letters are alphabetic, not punctuation characters.
+*    - optLetters, if present, must be matched in optionS.
+*    - argLetters, if present, are found in optionS followed by ':'.
+*    - argument is any white-space delimited string.  Note that it
+*      can include the SW character.
+*    - upper and lower case letters are distinct.
+*
+*  There may be multiple option clusters on a command line, each
+*  beginning with a SW, but all must appear before any non-option
+*  arguments (arguments not introduced by SW).  Opt/arg letters may
+*  be repeated: it is up to the caller to decide if that is an error.
+*
+*  The character SW appearing alone is not an option but an argument
+*  (as in "-" for stdout), and terminates getOpt.
+*  The lead-in sequence SWSW ("--") causes itself and all the rest
+*  of the line to be ignored (allowing non-options which begin
+*  with the switch char).
+*
+*  The string *optionS allows valid opt/arg letters to be recognized.
+*  argLetters are followed with ':'.  Getopt () returns the value of
+*  the option character found, or EOF if no more options are in the
+*  command line. If option is an argLetter then the global optarg is
+*  set to point to the argument string (having skipped any white-space).
+*
+*  The global optind is initially 1 and is always left as the index
+*  of the next argument of argv[] which getopt has not taken.  Note
+*  that if "--" or "//" are used then optind is stepped to the next
+*  argument before getopt() returns EOF.
+*
+*  If an error occurs, that is an SW char precedes an unknown letter,
+*  then getopt() will return a '~' character and normally prints an
+*  error message via perror().  If the global variable opterr is set
+*  to false (zero) before calling getopt() then the error message is
+*  not printed.
+*
+*  For example, if
+*
+*    *optionS == "A:F:PuU:wXZ:"
+*
+*  then 'P', 'u', 'w', and 'X' are option letters and 'A', 'F',
+*  'U', 'Z' are followed by arguments. A valid command line may be:
+*
+*    aCommand  -uPFPi -X -A L someFile
+*
+*  where:
+*    - 'u' and 'P' will be returned as isolated option letters.
+*    - 'F' will return with "Pi" as its argument string.
+*    - 'X' is an isolated option.
+*    - 'A' will return with "L" as its argument.
+*    - "someFile" is not an option, and terminates getOpt.  The
+*      caller may collect remaining arguments using argv pointers.
+***************************************************************************/
+int GetOpt (int argc, char *argv[], char *optionS)
+{
+   static char *letP = NULL;    /* remember next option char's location */
+   static char SW = '-';    /* switch character */
+
+   int opterr = 1;      /* allow error message        */
+   unsigned char ch;
+   char *optP;
+
+   if (argc > optind)
+   {
+      if (letP == NULL)
+      {
+     if ((letP = argv[optind]) == NULL || *(letP++) != SW || *letP == 0)
+        goto gopEOF;
+
+     if (*letP == SW)
+     {
+        optind++;
+        goto gopEOF;
+     }
+      }
+      if (0 == (ch = *(letP++)))
+      {
+     optind++;
+     goto gopEOF;
+      }
+      if (':' == ch || (optP = strchr (optionS, ch)) == NULL)
+     goto gopError;
+      if (':' == *(++optP))
+      {
+     optind++;
+     if (0 == *letP)
+     {
+        if (argc <= optind)
+           goto gopError;
+        letP = argv[optind++];
+     }
+     optarg = letP;
+     letP = NULL;
+      }
+      else
+      {
+     if (0 == *letP)
+     {
+        optind++;
+        letP = NULL;
+     }
+     optarg = NULL;
+      }
+      return ch;
+   }
+
+ gopEOF:
+   optarg = letP = NULL;
+   return EOF;
+
+ gopError:
+   optarg = NULL;
+   errno = EINVAL;
+   if (opterr)
+      perror ("\nCommand line option");
+   return ('~');
+}
+
@@ -0,0 +1,977 @@
+/* vi:set syntax=c expandtab tabstop=4 shiftwidth=4:
+
+ S 7 1 5 0 C A T . C
+
+ Catalog of recorded runs: finds the data files of s7150, s7150duo and
+ s7150sup in directory trees, and lists those that match a query (GPIB
+ address, mode, comment, start, duration) without opening them again.
+
+ Copyright (c) 2004...2025 by Joerg Hau.
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2 as
+ published by the Free Software Foundation, provided that the copyright
+ notice remains intact even in future versions. See the file LICENSE
+ for details.
+
+ If you use this program (or any part of it) in another application,
+ note that the resulting application becomes also GPL. In other
+ words, GPL is a "contaminating" license.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ --------------------------------------------------------------------
+
+ Modification/history (adapt VERSION below when changing!):
+
+ 2026-10-18     creation
+
+ This should compile with any C compiler, something like:
+
+ gcc -Wall -O2 -o s7150cat s7150cat.c
+
+ Of each data file, only the first HEADLEN and the last TAILLEN bytes
+ are read: the header (program, comment, start, address and mode) and
+ the footer (stop, and the summary of the readings that s7150 writes
+ there; binary files have all of it in their header, see s7150fmt.h).
+ What was found goes into the catalog, one fixed-size entry per file,
+ sorted by path. A scan reads again only the files whose size or time
+ of modification has changed; the others, and files that are no data
+ file at all, are taken from the catalog as they are. A query reads
+ the catalog only.
+
+*/
+
+#define VERSION "V20261018"     /* String! */
+
+#define _FILE_OFFSET_BITS 64    /* data files > 2 GB */
+#define _GNU_SOURCE             /* strptime(), strcasestr() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <errno.h>          /* command line reading */
+#include <unistd.h>
+#include <math.h>           /* HUGE_VAL */
+#include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>         /* PATH_MAX */
+#include <sys/stat.h>
+#include <sys/time.h>       /* clock timing */
+#include "s7150fmt.h"       /* decoding of readings, binary header */
+
+#define MAXLEN   90         /* text buffers etc */
+#define CATMAGIC "S7150CAT"
+#define CATVER    1
+#define CATNAME  "s7150.cat"    /* default catalog, in the current directory */
+#define CATPATH  256        /* longest path in the catalog */
+#define HEADLEN 4096        /* bytes read at the start of a text file ... */
+#define TAILLEN 4096        /* ... and at its end */
+
+#define ERR_FILE  4         /* error code */
+
+#define MTIME(st) ((int64_t) (st).st_mtim.tv_sec * 1000000000 + (st).st_mtim.tv_nsec)
+
+/* --- stuff for reading the command line --- */
+
+char *optarg;               /* global: pointer to argument of current option */
+int optind = 1;             /* global: index of which argument is next. Is used
+                            as a global variable for collection of further
+                            arguments (= not options) via argv pointers */
+
+/* --- miscellaneous function prototypes ---- */
+
+double  timeinfo (void);
+int     GetOpt (int argc, char *argv[], char *optionS);
+
+/* --- the catalog ---- */
+
+enum catkind { K_OTHER = 0, K_TEXT, K_BIN };
+
+/* the modes of s7150 -m, by number */
+static const char *modes[] = { "DCV", "ACV", "Ohm", "DCA", "ACA", "Diode", "DEGC", "DEGF" };
+#define NMODE ((int) (sizeof(modes) / sizeof(*modes)))
+
+struct cathdr
+    {
+    char    magic[8];       /* CATMAGIC, not terminated */
+    int32_t version;        /* CATVER */
+    int32_t entsize;        /* sizeof(struct catent) */
+    int64_t nent;           /* number of entries following */
+    };
+
+struct catent
+    {
+    char    path[CATPATH];  /* absolute */
+    int64_t size;           /* file size ... */
+    int64_t mtime;          /* ... and time of modification (ns), when read */
+    int32_t kind;           /* K_..., K_OTHER for files that are no data file */
+    int32_t done;           /* acquisition stop found */
+    int32_t pad;            /* GPIB address, -1 if unknown or several */
+    int32_t mode;           /* measurement mode (-m), -1 if unknown */
+    double  dt;             /* sampling interval in s, 0 if unknown */
+    double  t0, t1;         /* acquisition start and stop (Epoch), 0 if unknown */
+    double  dur;            /* min from start to the last sample */
+    int64_t n;              /* samples, -1 if unknown */
+    int64_t nval;           /* readings without error flag, 0 if unknown ... */
+    double  mean, std;      /* ... and their summary */
+    double  min, max;
+    char    program[24];    /* program name and version */
+    char    comment[96];    /* comment text (-c) */
+    };
+
+struct cat
+    {
+    struct  catent *e;      /* entries, sorted by path */
+    long    n, max;         /* in use, allocated */
+    };
+
+struct scan
+    {
+    struct  cat *old;       /* catalog as loaded ... */
+    char    *seen;          /* ... and which of its files were found */
+    struct  cat *cat;       /* the new one */
+    int     rebuild;        /* read all files again */
+    unsigned long nfile, nread;
+    };
+
+/* --- what to look for ---- */
+
+struct filter
+    {
+    int     pad, mode;      /* -1 = any */
+    const char *text;       /* part of the comment, NULL = any */
+    double  minlen;         /* min, at least */
+    double  from, to;       /* start in [from, to), Epoch */
+    };
+
+int     cat_load (const char *fname, struct cat *c);
+int     cat_save (const char *fname, const struct cat *c);
+int     cat_add (struct cat *c, const struct catent *e);
+int     cat_cmp (const void *a, const void *b);
+int     scan_dir (const char *dir, struct scan *s);
+int     readfile (const char *path, const struct stat *st, struct catent *e);
+void    read_text (int fd, char *head, struct catent *e);
+void    read_bin (int fd, const struct s7150_binhdr *h, struct catent *e);
+int     match (const struct catent *e, const struct filter *f);
+void    print_ent (const struct catent *e);
+double  parseclock (const char *s, int end);
+double  ctimetoepoch (const char *s);
+
+
+/********************************************************
+* main:       main program.                             *
+* Input:      see below.                                *
+* Return:     0 if OK, else error code                  *
+********************************************************/
+int main (int argc, char *argv[])
+{
+static char *disclaimer =
+"\ns7150cat - Catalog of data recorded by s7150. " VERSION ".\n"
+"Copyright (C) 2004...2025 by Joerg Hau.\n\n"
+"This program is free software; you can redistribute it and/or modify it under\n"
+"the terms of the GNU General Public License, version 2, as published by the\n"
+"Free Software Foundation.\n\n"
+"This program is distributed in the hope that it will be useful, but WITHOUT ANY\n"
+"WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A\n"
+"PARTICULAR PURPOSE. See the GNU General Public License for details.\n";
+
+static char *msg = "\nSyntax: s7150cat [-h] [-i catalog] [-a id] [-m mode] [-c txt] [-l len] [-f date] [-t date] [-s] [-r] [-v] [dir ...]"
+"\n        -h       this help screen"
+"\n        -i file  the catalog (default is " CATNAME ")"
+"\n        -a id    only runs with the instrument at GPIB address 'id'"
+"\n        -m mode  only runs in this mode: 0 ... 7 or DCV, ACV, Ohm, DCA, ACA,"
+"\n                 Diode, DEGC, DEGF"
+"\n        -c txt   only runs with 'txt' in the comment (any case)"
+"\n        -l len   only runs of at least 'len' minutes (or 2h, 1d, 30s)"
+"\n        -f date  only runs started at or after 'date' (2026-10-18 [02:00])"
+"\n        -t date  only runs started before 'date' (a day alone: its end)"
+"\n        -s       scan only, don't list"
+"\n        -r       read all files again, not only new or changed ones"
+"\n        -v       report scan and query statistics on stderr"
+"\n        dir      scan these directories (and all below) into the catalog"
+"\n                 first; files gone from them are removed from it"
+"\n\nOutput is tab-separated: file, start, stop, minutes to the last sample,"
+"\nsamples, GPIB address, mode, mean, standard deviation, minimum and maximum"
+"\nof the readings, comment. Empty fields are not known (see README.md).\n\n";
+
+char    catname[MAXLEN] = CATNAME, root[PATH_MAX], unit, do_list = 1, do_rebuild = 0, do_verbose = 0;
+int     key, i, j, ok = 1;
+long    k, nlist = 0, ngone = 0;
+double  t, len;
+struct  cat old, cat;
+struct  scan s;
+struct  filter f;
+
+memset (&old, 0, sizeof(old));
+memset (&cat, 0, sizeof(cat));
+f.pad = f.mode = -1;
+f.text = NULL;
+f.minlen = 0.0;
+f.from = -HUGE_VAL;
+f.to = HUGE_VAL;
+
+/* --- decode and read the command line --- */
+
+while ((key = GetOpt(argc, argv, "hsrvi:a:m:c:l:f:t:")) != EOF)
+    switch (key)
+        {
+        case 'h':                    /* help me */
+            fprintf (stderr, disclaimer);
+            fprintf (stderr, msg);
+            return 0;
+        case 's':
+            do_list = 0;
+            continue;
+        case 'r':
+            do_rebuild = 1;
+            continue;
+        case 'v':
+            do_verbose = 1;
+            continue;
+        case 'i':
+            strncpy (catname, optarg, MAXLEN-1);
+            continue;
+        case 'a':
+            sscanf (optarg, "%d", &f.pad);
+            continue;
+        case 'm':
+            for (f.mode = NMODE - 1; f.mode >= 0 && strcasecmp(optarg, modes[f.mode]); f.mode--)
+                ;
+            if (f.mode < 0 && (1 != sscanf(optarg, "%d", &f.mode) || f.mode < 0 || f.mode >= NMODE))
+                {
+                fprintf(stderr, "Error: mode must be 0 ... 7 or one of DCV, ACV, Ohm, DCA, ACA, Diode, DEGC, DEGF.\n");
+                return 1;
+                }
+            continue;
+        case 'c':
+            f.text = optarg;
+            continue;
+        case 'l':
+            unit = 'm';
+            if (sscanf(optarg, "%lf%c", &len, &unit) < 1 || len < 0.0 || !strchr("smhd", unit))
+                {
+                fprintf(stderr, "Error: length is minutes, or a number with s, m, h or d.\n");
+                return 1;
+                }
+            f.minlen = len * (unit == 's' ? 1.0/60.0 : unit == 'h' ? 60.0 : unit == 'd' ? 1440.0 : 1.0);
+            continue;
+        case 'f':
+            if (0.0 > (f.from = parseclock(optarg, 0)))
+                {
+                fprintf(stderr, "Error: can't make sense of '%s' (YYYY-MM-DD [HH:MM[:SS]]).\n", optarg);
+                return 1;
+                }
+            continue;
+        case 't':
+            if (0.0 > (f.to = parseclock(optarg, 1)))
+                {
+                fprintf(stderr, "Error: can't make sense of '%s' (YYYY-MM-DD [HH:MM[:SS]]).\n", optarg);
+                return 1;
+                }
+            continue;
+        case '~':                    /* invalid arg */
+        default:
+        fprintf (stderr, "'%s -h' for help.\n\n", argv[0]);
+            return 1;
+        }
+
+t = timeinfo();
+if (0 == cat_load(catname, &old) && (errno != ENOENT || argv[optind] == NULL))
+    {
+    fprintf(stderr, "Could not read catalog '%s'%s.\n", catname,
+            errno == ENOENT ? "; give directories to scan" : "");
+    return ERR_FILE;
+    }
+
+/* --- scan: the files found, and those of the catalog elsewhere --- */
+
+if (argv[optind])
+    {
+    memset (&s, 0, sizeof(s));
+    s.old = &old;
+    s.cat = &cat;
+    s.rebuild = do_rebuild;
+    if (old.n && NULL == (s.seen = calloc(old.n, 1)))
+        {
+        fprintf(stderr, "Out of memory.\n");
+        return ERR_FILE;
+        }
+    for (i = optind; i < argc; i++)
+        {
+        if (NULL == realpath(argv[i], root))
+            {
+            fprintf(stderr, "Could not find directory '%s'.\n", argv[i]);
+            return ERR_FILE;
+            }
+        if (!strcmp(root, "/"))
+            root[0] = '\0';     /* paths are root + '/' + name */
+        if (NULL == (argv[i] = strdup(root)))   /* kept for below */
+            {
+            fprintf(stderr, "Out of memory.\n");
+            return ERR_FILE;
+            }
+        ok &= scan_dir(root, &s);
+        }
+    for (k = 0; k < old.n; k++)
+        {
+        if (s.seen && s.seen[k])
+            continue;
+        for (i = optind; i < argc; i++)
+            {
+            j = strlen(argv[i]);
+            if (!strncmp(old.e[k].path, argv[i], j) && old.e[k].path[j] == '/')
+                break;
+            }
+        if (i < argc)
+            ngone++;
+        else if (0 == cat_add(&cat, &old.e[k]))
+            {
+            fprintf(stderr, "Out of memory.\n");
+            return ERR_FILE;
+            }
+        }
+
+    /* sorted, and each file once (directories may overlap) */
+    qsort(cat.e, cat.n, sizeof(*cat.e), cat_cmp);
+    for (k = j = 0; k < cat.n; k++)
+        if (j == 0 || strcmp(cat.e[k].path, cat.e[j-1].path))
+            cat.e[j++] = cat.e[k];
+    cat.n = j;
+    if (do_verbose)
+        fprintf(stderr, "# scan: %lu files, %lu read, %ld gone; %ld in the catalog; %.1f ms\n",
+                s.nfile, s.nread, ngone, cat.n, 1e3 * (timeinfo() - t));
+    if (0 == cat_save(catname, &cat))
+        {
+        fprintf(stderr, "Could not write catalog '%s'.\n", catname);
+        return ERR_FILE;
+        }
+    free (s.seen);
+    free (old.e);
+    old = cat;
+    }
+
+/* --- query --- */
+
+if (do_list)
+    {
+    t = timeinfo();
+    printf("# s7150cat " VERSION ": %s\n", catname);
+    printf("# file\tstart\tstop\tminutes\tn\tpad\tmode\tmean\tstd\tmin\tmax\tcomment\n");
+    for (k = 0; k < old.n; k++)
+        if (match(&old.e[k], &f))
+            {
+            print_ent(&old.e[k]);
+            nlist++;
+            }
+    if (do_verbose)
+        fprintf(stderr, "# query: %ld of %ld files listed; %.1f ms\n", nlist, old.n,
+                1e3 * (timeinfo() - t));
+    }
+free (old.e);
+return ok ? 0 : ERR_FILE;
+}
+
+
+/********************************************************
+* cat_load: Reads the catalog.                          *
+* Input:    - name of catalog file                      *
+*           - ptr to catalog, filled in here            *
+* Return:   1 if OK, 0 if error (errno is ENOENT if     *
+*           there is no catalog yet)                    *
+********************************************************/
+int cat_load (const char *fname, struct cat *c)
+{
+FILE    *fp;
+struct  cathdr h;
+int     ok = 0;
+
+if (NULL == (fp = fopen(fname, "rb")))
+    return 0;
+if (1 == fread(&h, sizeof(h), 1, fp) && !memcmp(h.magic, CATMAGIC, 8) && \
+    h.version == CATVER && h.entsize == sizeof(struct catent) && h.nent >= 0 && \
+    NULL != (c->e = malloc((h.nent ? h.nent : 1) * sizeof(*c->e))))
+    {
+    c->n = c->max = h.nent;
+    ok = (h.nent == fread(c->e, sizeof(*c->e), h.nent, fp));
+    }
+fclose(fp);
+errno = 0;
+return ok;
+}
+
+
+/********************************************************
+* cat_save: Writes the catalog (via a temporary file,   *
+*           so a concurrent query never sees half of    *
+*           it).                                        *
+* Input:    - name of catalog file                      *
+*           - the catalog                               *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+int cat_save (const char *fname, const struct cat *c)
+{
+char    tmp[MAXLEN+16];
+FILE    *fp;
+struct  cathdr h;
+int     ok;
+
+memset (&h, 0, sizeof(h));
+memcpy (h.magic, CATMAGIC, 8);
+h.version = CATVER;
+h.entsize = sizeof(struct catent);
+h.nent = c->n;
+sprintf(tmp, "%s.%d", fname, (int) getpid());
+if (NULL == (fp = fopen(tmp, "wb")))
+    return 0;
+ok = (1 == fwrite(&h, sizeof(h), 1, fp)) && \
+     (h.nent == fwrite(c->e, sizeof(*c->e), h.nent, fp));
+ok &= (0 == fclose(fp));
+if (ok)
+    ok = (0 == rename(tmp, fname));
+if (!ok)
+    unlink(tmp);
+return ok;
+}
+
+
+/********************************************************
+* cat_add:  Appends an entry to a catalog.              *
+* Input:    - ptr to catalog                            *
+*           - the entry                                 *
+* Return:   1 if OK, 0 if out of memory                 *
+********************************************************/
+int cat_add (struct cat *c, const struct catent *e)
+{
+struct  catent *p;
+
+if (c->n == c->max)
+    {
+    if (NULL == (p = realloc(c->e, (c->max ? 2 * c->max : 1024) * sizeof(*p))))
+        return 0;
+    c->e = p;
+    c->max = c->max ? 2 * c->max : 1024;
+    }
+c->e[c->n++] = *e;
+return 1;
+}
+
+
+/* catalog entries by path; a path alone works as key, too */
+int cat_cmp (const void *a, const void *b)
+{
+return strcmp(((const struct catent *) a)->path, ((const struct catent *) b)->path);
+}
+
+
+/********************************************************
+* scan_dir: Adds the files in a directory, and those    *
+*           below, to the catalog: from the old one if  *
+*           size and time are the same, else read.      *
+* Input:    - directory, "" for /                       *
+*           - scan data                                 *
+* Return:   1 if OK, 0 if a directory was not readable  *
+*           (its files stay in the catalog as they are) *
+********************************************************/
+int scan_dir (const char *dir, struct scan *s)
+{
+DIR     *d;
+struct  dirent *de;
+struct  stat st;
+struct  catent e, *old;
+char    path[CATPATH];
+long    k, len = strlen(dir);
+int     ok = 1;
+
+if (NULL == (d = opendir(*dir ? dir : "/")))
+    {
+    fprintf(stderr, "Could not read directory '%s', its files are not checked.\n", dir);
+    for (k = 0; k < s->old->n; k++)
+        if (!strncmp(s->old->e[k].path, dir, len) && s->old->e[k].path[len] == '/')
+            s->seen[k] = (0 != cat_add(s->cat, &s->old->e[k]));
+    return 0;
+    }
+
+while (NULL != (de = readdir(d)))
+    {
+    if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, ".."))
+        continue;
+    if (snprintf(path, sizeof(path), "%s/%s", dir, de->d_name) >= (int) sizeof(path))
+        {
+        fprintf(stderr, "Path too long, not in the catalog: %s/%s\n", dir, de->d_name);
+        continue;
+        }
+    if (lstat(path, &st))
+        continue;
+    if (S_ISDIR(st.st_mode))
+        {
+        ok &= scan_dir(path, s);
+        continue;
+        }
+    if (!S_ISREG(st.st_mode))
+        continue;
+
+    s->nfile++;
+    old = s->old->n ? bsearch(path, s->old->e, s->old->n, sizeof(*old), cat_cmp) : NULL;
+    if (old)
+        s->seen[old - s->old->e] = 1;
+    if (old && !s->rebuild && old->size == st.st_size && old->mtime == MTIME(st))
+        e = *old;
+    else if (readfile(path, &st, &e))
+        s->nread++;
+    else
+        continue;
+    if (0 == cat_add(s->cat, &e))
+        {
+        fprintf(stderr, "Out of memory.\n");
+        exit(ERR_FILE);
+        }
+    }
+closedir(d);
+return ok;
+}
+
+
+/********************************************************
+* readfile: Makes the catalog entry of a file, from its *
+*           first and last bytes.                       *
+* Input:    - path and status of the file               *
+*           - ptr to entry, filled in here              *
+* Return:   1 if OK (also for files that are no data    *
+*           files), 0 if the file can't be read         *
+********************************************************/
+int readfile (const char *path, const struct stat *st, struct catent *e)
+{
+char    head[HEADLEN+1];
+struct  s7150_binhdr h;
+ssize_t n;
+int     fd;
+
+memset (e, 0, sizeof(*e));
+strcpy (e->path, path);
+e->size = st->st_size;
+e->mtime = MTIME(*st);
+e->kind = K_OTHER;
+e->pad = e->mode = -1;
+e->n = -1;
+
+if ((fd = open(path, O_RDONLY)) < 0)
+    return 0;
+n = pread(fd, head, HEADLEN, 0);
+if (n >= (ssize_t) sizeof(h) && (memcpy(&h, head, sizeof(h)), s7150_checkhdr(&h)))
+    read_bin(fd, &h, e);
+else if (n > 0 && (!strncmp(head, "# s7150 ", 8) || !strncmp(head, "# s7150duo ", 11) || \
+                   !strncmp(head, "# s7150sup ", 11)))
+    {
+    head[n] = '\0';
+    read_text(fd, head, e);
+    }
+close(fd);
+return 1;
+}
+
+
+/********************************************************
+* read_text: Entry of a text file. The header has the   *
+*           program, the comment and the start (and for *
+*           s7150, address, mode and interval); older   *
+*           files get the mode from the first reading.  *
+*           The footer has the stop, the summary of the *
+*           readings (s7150), and the last sample.      *
+* Input:    - open file                                 *
+*           - its first bytes, terminated               *
+*           - ptr to entry                              *
+* Return:   nothing                                     *
+********************************************************/
+void read_text (int fd, char *head, struct catent *e)
+{
+char    tail[TAILLEN+1], *line, *q, *p;
+int     i, sup = !strncmp(head, "# s7150sup", 10), pad, mode;
+unsigned long nover = 0L, nunpars = 0L;
+double  n, mean, std, min, max, dt, t0, t;
+off_t   off;
+ssize_t len;
+struct  s7150_reading r;
+
+e->kind = K_TEXT;
+for (i = 0, line = head; NULL != (q = strchr(line, '\n')); i++, line = q + 1)
+    {
+    *q = '\0';
+    if (i == 0)
+        strncpy (e->program, line + 2, sizeof(e->program)-1);
+    else if (line[0] != '#')
+        {
+        /* the first sample: time, [pad,] reading */
+        p = strchr(line, '\t');
+        if (sup && p)
+            p = strchr(p+1, '\t');
+        if (e->mode < 0 && p && s7150_decode(p+1, &r))
+            switch (r.unit)
+                {
+                case U_V:    e->mode = (r.acdc == AD_AC) ? 1 : 0; break;
+                case U_KOHM:
+                case U_MOHM: e->mode = 2; break;
+                case U_MA:   e->mode = (r.acdc == AD_AC) ? 4 : 3; break;
+                case U_MV:   e->mode = 5; break;
+                case U_DEGC: e->mode = 6; break;
+                case U_DEGF: e->mode = 7; break;
+                default:     break;
+                }
+        break;
+        }
+    else if (!strncmp(line, "# Acquisition start: ", 21))
+        {
+        if (e->t0 == 0.0)
+            e->t0 = ctimetoepoch(line + 21);
+        }
+    else if (4 == sscanf(line, "# pad=%d mode=%d dt=%lf t0=%lf", &pad, &mode, &dt, &t0))
+        {
+        e->pad = pad;
+        e->mode = mode;
+        e->dt = dt;
+        e->t0 = t0;             /* better than the one of ctime() */
+        }
+    else if (i == 1 && !sup)
+        strncpy (e->comment, line + 2, sizeof(e->comment)-1);
+    }
+
+/* the first line of the tail is probably not complete */
+off = (e->size > TAILLEN) ? e->size - TAILLEN : 0;
+if (0 >= (len = pread(fd, tail, TAILLEN, off)))
+    return;
+tail[len] = '\0';
+line = tail;
+if (off > 0 && NULL != (q = strchr(tail, '\n')))
+    line = q + 1;
+for (; NULL != (q = strchr(line, '\n')); line = q + 1)
+    {
+    *q = '\0';
+    if (line[0] != '#')
+        {
+        t = strtod(line, &p);
+        if (p != line)
+            e->dur = t;
+        }
+    else if (5 == sscanf(line, "# Summary: n=%lf mean=%lf std=%lf min=%lf max=%lf", \
+                         &n, &mean, &std, &min, &max))
+        {
+        e->nval = (int64_t) n;
+        e->mean = mean;
+        e->std = std;
+        e->min = min;
+        e->max = max;
+        }
+    else if (2 == sscanf(line, "# %lu readings with error flag, %lu not decodable", &nover, &nunpars))
+        ;
+    else if (!strncmp(line, "# Acquisition stop: ", 20))
+        {
+        e->t1 = ctimetoepoch(line + 20);
+        e->done = 1;
+        }
+    }
+if (e->nval > 0)
+    e->n = e->nval + nover + nunpars;
+if (e->dur == 0.0 && e->t0 > 0.0 && e->t1 > 0.0)
+    e->dur = (e->t1 - e->t0) / 60.0;
+}
+
+
+/********************************************************
+* read_bin: Entry of a binary file: all is in the       *
+*           header, but the time of the last record.    *
+*           While the file is being written (or if it   *
+*           never was closed), the records are those    *
+*           committed, or all that are in the file.     *
+* Input:    - open file                                 *
+*           - its header                                *
+*           - ptr to entry                              *
+* Return:   nothing                                     *
+********************************************************/
+void read_bin (int fd, const struct s7150_binhdr *h, struct catent *e)
+{
+struct  s7150_rec rec;
+int64_t nrec;
+
+e->kind = K_BIN;
+memcpy (e->program, h->program, sizeof(e->program)-1);
+memcpy (e->comment, h->comment, sizeof(e->comment)-1);
+e->pad = h->pad;
+e->mode = h->mode;
+e->dt = h->delay / 10.0;
+e->t0 = h->t0_us / 1e6;
+if (h->t1_us)
+    {
+    e->t1 = h->t1_us / 1e6;
+    e->done = 1;
+    }
+if (h->t1_us || (h->hflags & HF_COMMIT))
+    nrec = h->nrec;
+else
+    nrec = (e->size - h->hdrsize) / h->recsize;
+e->n = nrec;
+if (nrec > 0 && sizeof(rec) == pread(fd, &rec, sizeof(rec), h->hdrsize + (nrec - 1) * h->recsize))
+    e->dur = rec.t_us / 6e7;
+if (h->nval)
+    {
+    e->nval = h->nval;
+    e->mean = h->vmean;
+    e->std = h->vstd;
+    e->min = h->vmin;
+    e->max = h->vmax;
+    }
+}
+
+
+/********************************************************
+* match:    Checks an entry against the query.          *
+* Input:    - entry                                     *
+*           - the query                                 *
+* Return:   1 if it matches, 0 if not                   *
+********************************************************/
+int match (const struct catent *e, const struct filter *f)
+{
+if (e->kind == K_OTHER)
+    return 0;
+if ((f->pad >= 0 && e->pad != f->pad) || (f->mode >= 0 && e->mode != f->mode))
+    return 0;
+if (f->text && !strcasestr(e->comment, f->text))
+    return 0;
+if (e->dur < f->minlen)
+    return 0;
+/* a start that is not known is never in a range */
+if ((f->from > -HUGE_VAL || f->to < HUGE_VAL) && (e->t0 == 0.0 || e->t0 < f->from || e->t0 >= f->to))
+    return 0;
+return 1;
+}
+
+
+/********************************************************
+* print_ent: One line of output per file.               *
+* Input:    entry                                       *
+* Return:   nothing                                     *
+********************************************************/
+void print_ent (const struct catent *e)
+{
+char    start[32] = "-", stop[32] = "-";
+time_t  tt;
+
+if (e->t0 > 0.0)
+    {
+    tt = (time_t) e->t0;
+    strftime(start, sizeof(start), "%Y-%m-%d %H:%M:%S", localtime(&tt));
+    }
+if (e->t1 > 0.0)
+    {
+    tt = (time_t) e->t1;
+    strftime(stop, sizeof(stop), "%Y-%m-%d %H:%M:%S", localtime(&tt));
+    }
+printf("%s\t%s\t%s\t%.4f\t", e->path, start, stop, e->dur);
+if (e->n >= 0)
+    printf("%lld", (long long) e->n);
+printf("\t");
+if (e->pad >= 0)
+    printf("%d", e->pad);
+printf("\t%s\t", (e->mode >= 0 && e->mode < NMODE) ? modes[e->mode] : "");
+if (e->nval > 0)
+    printf("%.7g\t%.3g\t%.7g\t%.7g", e->mean, e->std, e->min, e->max);
+else
+    printf("\t\t\t");
+printf("\t%s\n", e->comment);
+}
+
+
+/********************************************************
+* parseclock: Converts a date given on the command line.*
+* Input:    - text: YYYY-MM-DD [HH:MM[:SS]]             *
+*           - 1 if a day alone means its end            *
+* Return:   Epoch, or -1 if error                       *
+********************************************************/
+double parseclock (const char *s, int end)
+{
+struct  tm tm;
+int     y, mo, d, h = 0, mi = 0, n;
+double  sec = 0.0;
+
+if ((n = sscanf(s, "%d-%d-%d%*[ T]%d:%d:%lf", &y, &mo, &d, &h, &mi, &sec)) != 3 && n < 5)
+    return -1.0;
+memset (&tm, 0, sizeof(tm));
+tm.tm_year = y - 1900;
+tm.tm_mon = mo - 1;
+tm.tm_mday = d + (n == 3 && end);
+tm.tm_hour = h;
+tm.tm_min = mi;
+tm.tm_isdst = -1;
+return mktime(&tm) + sec;
+}
+
+
+/********************************************************
+* ctimetoepoch: Converts a time as printed by ctime().  *
+* Input:    text                                        *
+* Return:   Epoch, or 0 if error                        *
+********************************************************/
+double ctimetoepoch (const char *s)
+{
+struct  tm tm;
+
+memset (&tm, 0, sizeof(tm));
+if (NULL == strptime(s, "%a %b %d %H:%M:%S %Y", &tm))
+    return 0.0;
+tm.tm_isdst = -1;
+return mktime(&tm);
+}
+
+
+/********************************************************
+* TIMEINFO: Returns actual time elapsed since The Epoch *
+* Input:    Nothing.                                    *
+* Return:   time in microseconds                        *
+* Note:     #include <time.h>                           *
+*           #include <sys/time.h>                       *
+********************************************************/
+double timeinfo (void)
+{
+struct timeval t;
+
+gettimeofday(&t, NULL);
+return (double)t.tv_sec + (double)t.tv_usec/1000000.0;
+}
+
+
+/***************************************************************************
+* GETOPT: Command line parser, system V style.
+*
+*  Widely (and wildly) adapted from code published by Borland Intl. Inc.
+*
+*  Note that libc has a function getopt(), however this is not guaranteed
+*  to be available for other compilers. Therefore we provide *this* function
+*  (which does the same).
+*
+*  Standard option syntax is:
+*
+*    option ::= SW [optLetter]* [argLetter space* argument]
+*
+*  where
+*    - SW is '-'
+*    - there is no space before any optLetter or argLetter.
+*    - opt/arg letters are alphabetic, not punctuation characters.
+*    - optLetters, if present, must be matched in optionS.
+*    - argLetters, if present, are found in optionS followed by ':'.
+*    - argument is any white-space delimited string.  Note that it
+*      can include the SW character.
+*    - upper and lower case letters are distinct.
+*
+*  There may be multiple option clusters on a command line, each
+*  beginning with a SW, but all must appear before any non-option
+*  arguments (arguments not introduced by SW).  Opt/arg letters may
+*  be repeated: it is up to the caller to decide if that is an error.
+*
+*  The character SW appearing alone is not an option but an argument
+*  (as in "-" for stdout), and terminates getOpt.
+*  The lead-in sequence SWSW ("--") causes itself and all the rest
+*  of the line to be ignored (allowing non-options which begin
+*  with the switch char).
+*
+*  The string *optionS allows valid opt/arg letters to be recognized.
+*  argLetters are followed with ':'.  Getopt () returns the value of
+*  the option character found, or EOF if no more options are in the
+*  command line. If option is an argLetter then the global optarg is
+*  set to point to the argument string (having skipped any white-space).
+*
+*  The global optind is initially 1 and is always left as the index
+*  of the next argument of argv[] which getopt has not taken.  Note
+*  that if "--" or "//" are used then optind is stepped to the next
+*  argument before getopt() returns EOF.
+*
+*  If an error occurs, that is an SW char precedes an unknown letter,
+*  then getopt() will return a '~' character and normally prints an
+*  error message via perror().  If the global variable opterr is set
+*  to false (zero) before calling getopt() then the error message is
+*  not printed.
+*
+*  For example, if
+*
+*    *optionS == "A:F:PuU:wXZ:"
+*
+*  then 'P', 'u', 'w', and 'X' are option letters and 'A', 'F',
+*  'U', 'Z' are followed by arguments. A valid command line may be:
+*
+*    aCommand  -uPFPi -X -A L someFile
+*
+*  where:
+*    - 'u' and 'P' will be returned as isolated option letters.
+*    - 'F' will return with "Pi" as its argument string.
+*    - 'X' is an isolated option.
+*    - 'A' will return with "L" as its argument.
+*    - "someFile" is not an option, and terminates getOpt.  The
+*      caller may collect remaining arguments using argv pointers.
+***************************************************************************/
+int GetOpt (int argc, char *argv[], char *optionS)
+{
+   static char *letP = NULL;    /* remember next option char's location */
+   static char SW = '-';    /* switch character */
+
+   int opterr = 1;      /* allow error message        */
+   unsigned char ch;
+   char *optP;
+
+   if (argc > optind)
+   {
+      if (letP == NULL)
+      {
+     if ((letP = argv[optind]) == NULL || *(letP++) != SW || *letP == 0)
+        goto gopEOF;
+
+     if (*letP == SW)
+     {
+        optind++;
+        goto gopEOF;
+     }
+      }
+      if (0 == (ch = *(letP++)))
+      {
+     optind++;
+     goto gopEOF;
+      }
+      if (':' == ch || (optP = strchr (optionS, ch)) == NULL)
+     goto gopError;
+      if (':' == *(++optP))
+      {
+     optind++;
+     if (0 == *letP)
+     {
+        if (argc <= optind)
+           goto gopError;
+        letP = argv[optind++];
+     }
+     optarg = letP;
+     letP = NULL;
+      }
+      else
+      {
+     if (0 == *letP)
+     {
+        optind++;
+        letP = NULL;
+     }
+     optarg = NULL;
+      }
+      return ch;
+   }
+
+ gopEOF:
+   optarg = letP = NULL;
+   return EOF;
+
+ gopError:
+   optarg = NULL;
+   errno = EINVAL;
+   if (opterr)
+      perror ("\nCommand line option");
+   return ('~');
+}
+
@@ -34,6 +34,8 @@
  2016-02-17     bugfix as in s7150.c, updated doc (JHa)
  2017-01-06     updated doc (JHa)
  2025-08-11    moved everything to GitHub (JHa)
+ 2026-10-18     shadow of instrument settings as in s7150.c;
+                committed length for readers during the run
  
  This should compile with any C compiler, something like:
 
@@ -43,7 +45,7 @@
 
 */
 
-#define VERSION "V20250811"     /* String! */
+#define VERSION "V20261018"     /* String! */
 
 //#define DEBUG           /* diagnostic mode, for development only */
 
@@ -53,10 +55,12 @@
 #include <string.h>
 #include <errno.h>          /* command line reading */
 #include <unistd.h>
+#include <fcntl.h>          /* commit sidecar */
 #include <termios.h>        /* kbhit() */
 #include <sys/io.h>
 #include <sys/time.h>       /* clock timing */
 #include "gpib/ib.h"
+#include "s7150fmt.h"       /* commit sidecar */
 
 #define MAXLEN   90         /* text buffers etc */
 #define ESC      27
@@ -92,13 +96,45 @@ double  timeinfo (void);
 int     strclean (char *buf);
 int     GetOpt (int argc, char *argv[], char *optionS);
 
+/* Serial poll status byte. Only RQS is defined by IEEE-488; what the
+   7150 reports in the other bits is not documented here, so they are
+   reserved: shown as they are, but not interpreted. */
+
+#define ST_RQS      0x40    /* instrument requests service */
+#define ST_RESERVED 0xbf    /* all other bits */
+
+/* --- shadow of the instrument state ---- */
+
+struct s7150_dev
+    {
+    int     ud;             /* unit descriptor as delivered by ibdev() */
+    int     pad;            /* GPIB primary address */
+    int     display;        /* last settings sent to the instrument, */
+    int     fun;            /* -1 = unknown (i.e. must be sent) */
+    int     range;
+    int     integ;
+    char    pending[MAXLEN];    /* commands to be merged into next write */
+    unsigned long nwrt;     /* bus transactions: writes */
+    unsigned long nrd;      /* bus transactions: reads */
+    unsigned long nsetup;   /* number of reconfigurations requested */
+    unsigned long nsetwrt;  /* ... and the writes they actually needed */
+    int     status;         /* last serial poll status byte, -1 = none */
+    unsigned long npoll;    /* serial polls done ... */
+    unsigned long nbad;     /* ... and how many of them had RQS set */
+    double  tpoll;          /* total time spent polling, in s */
+    };
+
 /* --- s7150-related function prototypes ---- */
 
-int     s7150_open (const int adr);
-int     s7150_setup (const int dvm, const int display, \
+int     s7150_open (struct s7150_dev *dev, const int pad);
+int     s7150_setup (struct s7150_dev *dev, const int display, \
                      const int fun, const int range, const float freq);
-int     s7150_read (const int dvm, const int delay, char *result);
-int     s7150_close (const int adr);
+int     s7150_read (struct s7150_dev *dev, const int delay, char *result);
+int     s7150_close (struct s7150_dev *dev);
+int     s7150_write (struct s7150_dev *dev, const char *cmd);
+void    s7150_stats (const struct s7150_dev *dev);
+int     s7150_poll (struct s7150_dev *dev);
+void    s7150_status (const struct s7150_dev *dev, FILE *fp);
 
 /* --- things to make life easier ---- */
 #ifdef PLUS
@@ -128,7 +164,7 @@ static char *disclaimer =
 "WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A\n"
 "PARTICULAR PURPOSE. See the GNU General Public License for details.\n";
 
-static char *msg = "\nSyntax: s7150duo [-h] [-n] [-w samp] [-[a|A] id] [-[m|M] mode] [-d] [-t dt] [-T timeout] [-c \"txt\"] [-g /path/to/gnuplot] [-f] datafile"
+static char *msg = "\nSyntax: s7150duo [-h] [-n] [-w samp] [-[a|A] id] [-[m|M] mode] [-d] [-t dt] [-T timeout] [-p samp] [-c \"txt\"] [-g /path/to/gnuplot] [-f] datafile"
 "\n        -h       this help screen"
 "\n        -a id    use instrument 1 at GPIB address 'id' (default is 16)"
 "\n        -A id    use instrument 2 at GPIB address 'id' (default is 12)"
@@ -137,6 +173,7 @@ static char *msg = "\nSyntax: s7150duo [-h] [-n] [-w samp] [-[a|A] id] [-[m|M] m
 "\n        -t dt    delay between measurements in 0.1 s (default is 10)"
 "\n        -d       disable instrument display (default is on)"
 "\n        -w x     force write to disk every x samples (default is 100)"
+"\n        -p x     serial-poll instrument status every x samples (default 0 = off)"
 "\n        -f       force overwriting of existing file"
 "\n        -T min   stop acquisition after this time (in minutes; default 0 = endless)"
 "\n        -c txt   comment text"
@@ -151,8 +188,10 @@ static char *ylabels[] = {"V","V","kOhms","mA","mA","mV"};
 
 FILE    *outfile, *gp = NULL;
 char    buffer1[MAXLEN], buffer2[MAXLEN], filename[MAXLEN], comment[MAXLEN] = "", gnuplot[MAXLEN];
+char    commitname[MAXLEN+8];
 char    do_display = 1, do_graph = 1, do_overwrite = 0;
-int     dvm1, dvm2, pad1 = 16, pad2 = 12, key, do_flush = 100, delay = 10, \
+struct  s7150_dev dvm1, dvm2;
+int     commitfd, pad1 = 16, pad2 = 12, key, do_flush = 100, do_poll = 0, delay = 10, \
 	    mode1 = DCV, mode2 = DCA, range = 0;
 unsigned long loop = 0L;
 double  t0, t1;
@@ -169,7 +208,7 @@ fprintf (stderr, disclaimer);
 
 /* --- decode and read the command line --- */
 
-while ((key = GetOpt(argc, argv, "hfnda:A:w:t:T:m:c:M:g:")) != EOF)
+while ((key = GetOpt(argc, argv, "hfnda:A:w:p:t:T:m:c:M:g:")) != EOF)
     switch (key)
         {
         case 'h':                    /* help me */
@@ -194,6 +233,14 @@ while ((key = GetOpt(argc, argv, "hfnda:A:w:t:T:m:c:M:g:")) != EOF)
         case 'w':
             sscanf (optarg, "%5d", &do_flush);
             continue;
+        case 'p':
+            sscanf (optarg, "%5d", &do_poll);
+            if (do_poll < 0)
+                {
+                puts("Error: poll interval must be positive.");
+                return 1;
+                }
+            continue;
         case 'a':
             sscanf (optarg, "%5d", &pad1);
             if (pad1 < 0 || pad1 > 30)
@@ -304,6 +351,14 @@ if (NULL == (outfile = fopen(filename, "wt")))
     return ERR_FILE;
     }
 
+/* readers learn from here how much of the file is complete */
+sprintf(commitname, "%s" S7150_COMMIT, filename);
+if ((commitfd = open(commitname, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+    {
+    fprintf(stderr, "Could not open '%s' for writing.\n", commitname);
+    return ERR_FILE;
+    }
+
 /* --- real-time display: prepare gnuplot for action --- */
 
 gp = popen(gnuplot,"w");
@@ -326,9 +381,7 @@ init_keyboard();    /* for kbhit() functionality */
 
 /* preparations are finished, now let's get it going ... */
 
-dvm1 = s7150_open(pad1);
-dvm2 = s7150_open(pad2);
-if ((dvm1 == 0) || (dvm2 == 0))
+if ((0 == s7150_open(&dvm1, pad1)) || (0 == s7150_open(&dvm2, pad2)))
     {
     fprintf(stderr, "Quit.\n");
     pclose(gp);
@@ -340,8 +393,8 @@ if ((dvm1 == 0) || (dvm2 == 0))
    once and then both instruments read immediately one after the other */  
 delay = delay/2.0;
 
-if ((0 == s7150_setup(dvm1, do_display, mode1, range, 10.0/delay)) || \
-    (0 == s7150_setup(dvm2, do_display, mode2, range, 10.0/delay)))
+if ((0 == s7150_setup(&dvm1, do_display, mode1, range, 10.0/delay)) || \
+    (0 == s7150_setup(&dvm2, do_display, mode2, range, 10.0/delay)))
     {
     fprintf(stderr, "Quit.\n");
     pclose(gp);
@@ -354,9 +407,11 @@ if (strlen(comment))
 	printf("\n      Comment :  %s", comment);
 printf("\n     Sampling :  %.1f s", 2.0*delay/10.0);
 printf("\n      Refresh :  %d", do_flush);
+if (do_poll)
+    printf("\n  Status poll :  every %d samples", do_poll);
 if (tstop > 0.0)
     printf("\n   Halt after :  %g min", tstop);
-printf("\n         Stop :  Press 'q' or ESC.\n");
+printf("\n         Stop :  Press 'q' or ESC, 's' shows instrument status.\n");
 printf("\n     Count           Time      Reading\n");
 fflush(stdout);
 
@@ -366,13 +421,36 @@ fprintf(outfile, "# s7150duo " VERSION "\n");
 fprintf(outfile, "# %s\n", comment);
 fprintf(outfile, "# Acquisition start: %s", ctime(&t));
 fprintf(outfile, "# min\treadout  errflag  unit  mode  unit mode\n");
+fflush (outfile);
+s7150_commit(commitfd, ftell(outfile), 0);
 t0 = timeinfo();
 
 key = 0;
 do  {
+    /* cheap health check: one status byte per DMM instead of a
+       reading */
+    if (do_poll && !(loop % do_poll))
+        {
+        if ((s7150_poll(&dvm1) < 0) || (s7150_poll(&dvm2) < 0))
+            {
+            fprintf(stderr, "Quit.\n");
+            pclose(gp);
+            close_keyboard();
+            return ERR_INST;
+            }
+        if ((dvm1.status & ST_RQS) || (dvm2.status & ST_RQS))
+            {
+            fprintf(stderr, "\n");
+            s7150_status(&dvm1, stderr);
+            fprintf(stderr, ", ");
+            s7150_status(&dvm2, stderr);
+            fprintf(stderr, "\n");
+            }
+        }
+
     /* delay = 0 means free-running acquisition with highest speed */
-    if ((0 == (s7150_read(dvm1, delay, buffer1))) ||
-        (0 == (s7150_read(dvm2, delay, buffer2))))
+    if ((0 == (s7150_read(&dvm1, delay, buffer1))) ||
+        (0 == (s7150_read(&dvm2, delay, buffer2))))
         {
         fprintf(stderr, "Quit.\n");
         pclose(gp);
@@ -393,6 +471,7 @@ do  {
     if (!(loop % do_flush))
         {
         fflush (outfile);
+        s7150_commit(commitfd, ftell(outfile), 0);
         if (do_graph)
             {
             fprintf(gp, "plot '%s' using 1:2 title '%d: %s', '' using 1:5 title '%d: %s'\n", \
@@ -401,23 +480,39 @@ do  {
             }
         }
 
-    /* look up keyboard for keypress */
+    /* look up keyboard for keypress; 's' polls on demand */
     if(kbhit())
+        {
         key = readch();
+        if (key == 's' && s7150_poll(&dvm1) >= 0 && s7150_poll(&dvm2) >= 0)
+            {
+            printf("\n");
+            s7150_status(&dvm1, stdout);
+            printf(", ");
+            s7150_status(&dvm2, stdout);
+            printf("\n");
+            }
+        }
     }
     while ((key != 'q') && (key != ESC));
 
 time(&t);
 fprintf(outfile, "# Acquisition stop: %s\n", ctime(&t));
+fflush (outfile);
+s7150_commit(commitfd, ftell(outfile), 1);
+close(commitfd);
+unlink(commitname);         /* closed: no sidecar means all of it is valid */
 fclose (outfile);
 
 /* send reset to instrument */
-if ((! s7150_close(dvm1)) ||
-    (! s7150_close(dvm2)))
+if ((! s7150_close(&dvm1)) ||
+    (! s7150_close(&dvm2)))
     {
     fprintf(stderr, "Quit.\n");
     return ERR_INST;
     }
+s7150_stats(&dvm1);
+s7150_stats(&dvm2);
 
 if (do_graph)   /* if graphic display was used, replot data and wait for keypress */
     {
@@ -437,16 +532,19 @@ return 0;
 
 /********************************************************
 * s7150_open: Connect and initialise the Solartron 7150 *
-* Input:      GPIB address                              *
-* Return:     0 if error, file descriptior if OK        *
+* Input:    - ptr to device struct (filled in here)     *
+*           - GPIB address                              *
+* Return:     0 if error, 1 if OK                       *
 ********************************************************/
-int s7150_open (const int pad)
+int s7150_open (struct s7150_dev *dev, const int pad)
 {
-int dvm;
-static char buf[MAXLEN];
+memset (dev, 0, sizeof(*dev));
+dev->pad = pad;
+dev->display = dev->fun = dev->range = dev->integ = -1;
+dev->status = -1;
 
-dvm = ibdev(GPIB_BOARD_ID, pad, 0, T1s, 1, 0);
-if(dvm < 0)
+dev->ud = ibdev(GPIB_BOARD_ID, pad, 0, T1s, 1, 0);
+if(dev->ud < 0)
     {
     fprintf(stderr, "Error trying to open GPIB address %i\n", pad);
     return 0;
@@ -457,37 +555,37 @@ if(dvm < 0)
     N0 = verbose output
     T1 = tracking on (T0 = single-shot)
     I3 = integration 400 ms
-    */
 
-strcpy (buf, "A\n");
-if (ibwrt(dvm, buf, strlen(buf)) & ERR )
+    The clear needs its own write since the instrument needs some
+    time to recover; the rest is kept pending and goes out together
+    with the first s7150_setup(), saving one bus transaction. */
+
+if (0 == s7150_write(dev, "A\n"))
     {
     fprintf(stderr, "Error during init step 1 of GPIB address %i!\n", pad);
     return 0;
     }
 sleep (2);
-strcpy (buf, "U7N0T1\n");
-if (ibwrt(dvm, buf, strlen(buf)) & ERR )
-    {
-    fprintf(stderr, "Error during init step 2 of GPIB address %i!\n", pad);
-    return 0;
-    }
+strcpy (dev->pending, "U7N0T1");
 
 /* arrive here if OK */
-return dvm;
+return 1;
 }
 
 
 /********************************************************
 * s7150_setup: Sets operating mode of the S7150.        *
-* Input:    - file pointer as delivered by s7150_open() *
+*           Only the settings that differ from what was *
+*           sent before are transmitted, all in 1 write.*
+* Input:    - ptr as delivered by s7150_open()          *
 *           - display, function, range, acq freq in Hz  *
 * Return:   1 if OK, 0 if error                         *
 ********************************************************/
-int s7150_setup (const int dvm, const int display, const int fun, \
+int s7150_setup (struct s7150_dev *dev, const int display, const int fun, \
                  const int range, const float freq)
 {
 int d = 0, i = 3;
+char *p;
 static char buf[MAXLEN];
 
 /* note: the 7150 uses "D1" to switch the display OFF */
@@ -513,31 +611,56 @@ if (freq > 10.0)   /* more than 10 Hz */
     fprintf(stderr, "%.2f Hz -> using I%d.\n", freq, i);
 #endif
 
-sprintf (buf, "D%dM%dR%dI%d\n", d, fun, range, i);
-if (ibwrt(dvm, buf, strlen(buf)) & ERR )
+dev->nsetup++;
+
+/* build the command from whatever has changed. The range depends
+   on the function, so a new function always gets its range, too. */
+p = buf;
+p += sprintf (p, "%s", dev->pending);
+if (d != dev->display)
+    p += sprintf (p, "D%d", d);
+if (fun != dev->fun)
+    p += sprintf (p, "M%d", fun);
+if (range != dev->range || fun != dev->fun)
+    p += sprintf (p, "R%d", range);
+if (i != dev->integ)
+    p += sprintf (p, "I%d", i);
+
+if (p == buf)       /* nothing to do, instrument is already set */
+    return 1;
+
+strcpy (p, "\n");
+if (0 == s7150_write(dev, buf))
     {
     fprintf(stderr, "Error during mode setting!\n");
+    dev->display = dev->fun = dev->range = dev->integ = -1;
     return 0;
     }
+dev->nsetwrt++;
+dev->pending[0] = 0;
+dev->display = d;
+dev->fun = fun;
+dev->range = range;
+dev->integ = i;
 return 1;
 }
 
 
 /********************************************************
 * s7150_read: Reads value from the Solartron 7150.      *
-* Input:    - file ptr as delivered by s7150_open()     *
+* Input:    - ptr as delivered by s7150_open()          *
 *           - delay between measurements (in 0.1 s)     *
 *           - ptr to char for result                    *
 * Return:   1 if OK, 0 if error                         *
 ********************************************************/
-int s7150_read (const int dvm, const int delay, char *result)
+int s7150_read (struct s7150_dev *dev, const int delay, char *result)
 {
 static char buf[2];
 
 if (delay > 0)	/* delay == 0 is free-running */
     {
     strcpy (buf, "G");
-/*    if (ibwrt(dvm, buf, strlen(buf)) & ERR )
+/*    if (ibwrt(dev->ud, buf, strlen(buf)) & ERR )
         {
         fprintf(stderr, "Error trying to initiate measurement!\n");
         return 0;
@@ -546,7 +669,8 @@ if (delay > 0)	/* delay == 0 is free-running */
     }
 
 /* Solartron 7150 puts out 15 chars plus LF */
-if(ibrd(dvm, result, 16) & ERR)
+dev->nrd++;
+if(ibrd(dev->ud, result, 16) & ERR)
     {
     fprintf(stderr, "Error trying to read from instrument!\n");
     return 0;
@@ -566,15 +690,14 @@ return 1;
 
 /********************************************************
 * s7150_close: Reset and disconnect Solartron 7150      *
-* Input:    file pointer as delivered by s7150_open()   *
+* Input:    ptr as delivered by s7150_open()            *
 * Return:   0 if error, 1 if OK                         *
 ********************************************************/
-int s7150_close (const int dvm)
+int s7150_close (struct s7150_dev *dev)
 {
-static char buf[10];
-
-strcpy (buf, "DC1\nA\n");
-if (ibwrt(dvm, buf, strlen(buf)) & ERR )
+/* both commands in one go; afterwards, the settings are unknown */
+dev->display = dev->fun = dev->range = dev->integ = -1;
+if (0 == s7150_write(dev, "DC1\nA\n"))
     {
     fprintf(stderr, "Error during reset of instrument!\n");
     return 0;
@@ -583,6 +706,88 @@ return 1;
 }
 
 
+/********************************************************
+* s7150_write: Sends a command string to the S7150 and  *
+*           counts the bus transaction.                 *
+* Input:    - ptr as delivered by s7150_open()          *
+*           - command string (incl. delimiter)          *
+* Return:   0 if error, 1 if OK                         *
+********************************************************/
+int s7150_write (struct s7150_dev *dev, const char *cmd)
+{
+#ifdef DEBUG
+    fprintf(stderr, "GPIB %d <- '%s'\n", dev->pad, cmd);
+#endif
+
+dev->nwrt++;
+if (ibwrt(dev->ud, cmd, strlen(cmd)) & ERR )
+    return 0;
+return 1;
+}
+
+
+/********************************************************
+* s7150_stats: Shows the bus transactions of one DMM.   *
+* Input:    ptr as delivered by s7150_open()            *
+* Return:   nothing                                     *
+********************************************************/
+void s7150_stats (const struct s7150_dev *dev)
+{
+printf("\n GPIB address %d: %lu writes, %lu reads; %lu setups needed %lu writes.",
+       dev->pad, dev->nwrt, dev->nrd, dev->nsetup, dev->nsetwrt);
+if (dev->npoll)
+    printf("\n                 %lu serial polls (%lu with RQS), %.0f us/poll.",
+           dev->npoll, dev->nbad, 1e6 * dev->tpoll / dev->npoll);
+}
+
+
+/********************************************************
+* s7150_poll: Serial-polls the S7150. This costs only   *
+*           one status byte on the bus, much less than  *
+*           a complete reading.                         *
+* Input:    ptr as delivered by s7150_open()            *
+* Return:   status byte, -1 if error                    *
+********************************************************/
+int s7150_poll (struct s7150_dev *dev)
+{
+char st;
+double t;
+
+t = timeinfo();
+if (ibrsp(dev->ud, &st) & ERR)
+    {
+    fprintf(stderr, "Error during serial poll of GPIB address %d!\n", dev->pad);
+    return -1;
+    }
+dev->tpoll += timeinfo() - t;
+dev->npoll++;
+dev->status = (unsigned char) st;
+if (dev->status & ST_RQS)
+    dev->nbad++;
+return dev->status;
+}
+
+
+/********************************************************
+* s7150_status: Shows the decoded status of the S7150.  *
+* Input:    - ptr as delivered by s7150_open()          *
+*           - where to print it                         *
+* Return:   nothing                                     *
+********************************************************/
+void s7150_status (const struct s7150_dev *dev, FILE *fp)
+{
+if (dev->status < 0)
+    {
+    fprintf(fp, "GPIB %d: not polled yet", dev->pad);
+    return;
+    }
+fprintf(fp, "GPIB %d: status 0x%02x%s", dev->pad, dev->status,
+        (dev->status & ST_RQS) ? " (requests service)" : "");
+if (dev->status & ST_RESERVED)
+    fprintf(fp, ", other bits 0x%02x", dev->status & ST_RESERVED);
+}
+
+
 /********************************************************
 * TIMEINFO: Returns actual time elapsed since The Epoch *
 * Input:    Nothing.                                    *
@@ -0,0 +1,473 @@
+/* vi:set syntax=c expandtab tabstop=4 shiftwidth=4:
+
+ S 7 1 5 0 F M T . H
+
+ Decoding of the readings of the Solartron 7150 (and 7150-plus).
+
+ Copyright (c) 2004...2025 by Joerg Hau.
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2 as
+ published by the Free Software Foundation, provided that the copyright
+ notice remains intact even in future versions. See the file LICENSE
+ for details.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ --------------------------------------------------------------------
+
+ Modification/history:
+
+ 2026-10-18     creation: fixed-format decoder for the 15-char reading;
+                binary file format with exact fixed-point records;
+                audit files with the raw bytes that can't be regenerated;
+                committed length of files being written; summary of
+                the readings in the binary header
+
+ This file is #included by s7150.c; there is nothing to compile
+ separately.
+
+ With U7N0 (verbose, CR delimited), the 7150 puts out 15 characters
+ at fixed positions, which is what ends up in the data file:
+
+    0         1
+    012345678901234
+    +1.234567  V DC
+    |         ||  |
+    |         ||  +-- mode: "DC", "AC" or blank
+    |         |+----- unit: "V ", "mV", "mA", "kO", "MO", "C ", "F "
+    |         +------ error flag: blank or '!' (overload)
+    +---------------- readout: sign, 7 digits and a decimal point
+
+ The readout is converted directly into an integer count and a
+ decimal exponent (value = count * 10^exp), i.e. exactly the digits
+ shown on the front panel. No strtod(), no locale, no allocation.
+
+ Binary data files (s7150 -b) consist of one header (struct
+ s7150_binhdr, 256 bytes) followed by fixed-size records (struct
+ s7150_rec, 16 bytes), one per reading, in host byte order. As the
+ records keep count and exponent, the exact digits of the instrument
+ can always be regenerated with s7150_fromrec() and s7150_encode().
+ A count of 0 has no sign of its own, so a "-0.000000" sets RU_NEG in
+ the unit byte of its record (since version 2 of the format).
+
+ While a file is being written, the writer publishes how much of it
+ is complete (s7150_commit(), see below), so readers never get half a
+ line or half a record.
+
+ Audit files (s7150 -R) go along with a binary data file and keep
+ what the instrument actually sent. Records flagged RF_CANON give back
+ their raw bytes with s7150_regen(); only the others have their raw
+ bytes stored in the audit file. The file starts with a header (struct
+ s7150_audhdr), followed by blocks: each is a struct s7150_audblk,
+ then nraw times struct s7150_raw. The CRC in each block covers the
+ raw bytes of all its readings, in order, so a verifier can rebuild
+ the complete raw stream and check it.
+
+*/
+
+#ifndef S7150FMT_H
+#define S7150FMT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>         /* pwrite() */
+
+#define S7150_LEN     15    /* chars per reading, without delimiter */
+#define S7150_DIGITS   7    /* digits in the readout field */
+#define S7150_VALLEN   9    /* sign + digits + decimal point */
+#define S7150_ERRPOS  10    /* position of the error flag */
+#define S7150_UNITPOS 11    /* position of the unit (2 chars) */
+#define S7150_MODEPOS 13    /* position of the mode (2 chars) */
+
+enum s7150_unit  { U_UNKNOWN = 0, U_V, U_MV, U_MA, U_KOHM, U_MOHM, U_DEGC, U_DEGF, U_NUNITS };
+enum s7150_acdc  { AD_NONE = 0, AD_DC, AD_AC, AD_UNKNOWN };
+enum s7150_eflag { EF_OK = 0, EF_OVER, EF_UNKNOWN };
+
+/* unit and mode fields as printed by the instrument, indexed by enum */
+static const char s7150_units[U_NUNITS][3] = { "??", "V ", "mV", "mA", "kO", "MO", "C ", "F " };
+static const char s7150_acdcs[AD_UNKNOWN][3] = { "  ", "DC", "AC" };
+
+struct s7150_reading
+    {
+    int32_t count;          /* readout in digits, incl. sign */
+    int8_t  exp;            /* decimal exponent: value = count * 10^exp;
+                               down to -15 for means (s7150 -O) */
+    uint8_t unit;           /* enum s7150_unit */
+    uint8_t acdc;           /* enum s7150_acdc */
+    uint8_t eflag;          /* enum s7150_eflag */
+    uint8_t neg;            /* sign is '-' (the only sign of a count of 0) */
+    };
+
+
+/********************************************************
+* s7150_decode: Decodes one 15-char reading.            *
+* Input:    - string as received from the instrument    *
+*           - ptr to result                             *
+* Return:   1 if the layout is valid, 0 if not (the     *
+*           result is then incomplete)                  *
+* Note:     There is no early exit on bad chars; every  *
+*           reading costs the same few operations.      *
+********************************************************/
+static inline int s7150_decode (const char *s, struct s7150_reading *r)
+{
+int i, c, dig, dot, ndig = 0, ndot = 0, dotpos = 0, bad;
+int32_t count = 0;
+
+/* readout: sign, then exactly one '.' among 8 digit positions */
+bad = (s[0] != '+') & (s[0] != '-');
+for (i = 1; i < S7150_VALLEN; i++)
+    {
+    c = (unsigned char) s[i] - '0';
+    dig = (unsigned) c < 10;
+    dot = s[i] == '.';
+    count += dig * (9 * count + c);     /* i.e. count*10+c if digit */
+    ndig += dig;
+    ndot += dot;
+    dotpos |= dot * i;
+    bad |= !(dig | dot);
+    }
+bad |= (ndig != S7150_DIGITS) | (ndot != 1) | (s[S7150_VALLEN] != ' ');
+r->count = (s[0] == '-') ? -count : count;
+r->neg = (s[0] == '-');
+r->exp = dotpos - (S7150_VALLEN - 1);
+
+r->eflag = (s[S7150_ERRPOS] == ' ') ? EF_OK :
+           (s[S7150_ERRPOS] == '!') ? EF_OVER : EF_UNKNOWN;
+
+/* unit and mode: table lookup over the few known spellings */
+r->unit = U_UNKNOWN;
+for (i = 1; i < U_NUNITS; i++)
+    if (!memcmp (s + S7150_UNITPOS, s7150_units[i], 2))
+        r->unit = i;
+r->acdc = AD_UNKNOWN;
+for (i = 0; i < AD_UNKNOWN; i++)
+    if (!memcmp (s + S7150_MODEPOS, s7150_acdcs[i], 2))
+        r->acdc = i;
+
+return !bad;
+}
+
+
+/********************************************************
+* s7150_encode: Regenerates the 15-char reading from    *
+*           its decoded form (the reverse of decode).   *
+* Input:    - decoded reading                           *
+*           - ptr to buffer, at least S7150_LEN+1 chars *
+* Return:   1 if OK, 0 if the reading can't be encoded  *
+*           (unknown flags or exponent out of range)    *
+********************************************************/
+static inline int s7150_encode (const struct s7150_reading *r, char *s)
+{
+int i, dotpos;
+uint32_t n;
+
+dotpos = (S7150_VALLEN - 1) + r->exp;
+if (dotpos < 1 || dotpos >= S7150_VALLEN || r->unit == U_UNKNOWN || \
+    r->acdc == AD_UNKNOWN || r->eflag == EF_UNKNOWN)
+    return 0;
+n = (r->count < 0) ? -(int64_t)r->count : r->count;
+if (n > 9999999)
+    return 0;
+
+s[0] = (r->count < 0 || (r->count == 0 && r->neg)) ? '-' : '+';
+for (i = S7150_VALLEN - 1; i > 0; i--)
+    {
+    if (i == dotpos)
+        s[i] = '.';
+    else
+        {
+        s[i] = '0' + n % 10;
+        n /= 10;
+        }
+    }
+s[S7150_VALLEN] = ' ';
+s[S7150_ERRPOS] = (r->eflag == EF_OVER) ? '!' : ' ';
+memcpy (s + S7150_UNITPOS, s7150_units[r->unit], 2);
+memcpy (s + S7150_MODEPOS, s7150_acdcs[r->acdc], 2);
+s[S7150_LEN] = 0;
+return 1;
+}
+
+
+/********************************************************
+* s7150_value: Converts a decoded reading to double.    *
+* Input:    decoded reading                             *
+* Return:   value in the instrument's unit              *
+********************************************************/
+static inline double s7150_value (const struct s7150_reading *r)
+{
+static const double p10[] = { 1.0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+                              1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+
+/* dividing by an exact power of ten gives the double closest to
+   the displayed digits; multiplying by 1e-x would not */
+return r->count / p10[(-r->exp) & 15];
+}
+
+
+/********************************************************
+* s7150_round: Rounds a reading with more digits than   *
+*           the instrument shows (a mean, s7150 -O) to  *
+*           the 7 digits that s7150_encode() can show.  *
+* Input:    ptr to decoded reading                      *
+********************************************************/
+static inline void s7150_round (struct s7150_reading *r)
+{
+int64_t n = (r->count < 0) ? -(int64_t)r->count : r->count, d = 1;
+int     k;
+
+r->neg = (r->count < 0) || (r->count == 0 && r->neg);   /* "-0.000000" */
+
+/* the decimal point can't go further left than ".1234567" */
+for (k = 0; r->exp + k < 2 - S7150_VALLEN; k++)
+    d *= 10;
+/* half away from zero; once more if that carries into an 8th digit */
+while ((n + d / 2) / d > 9999999)
+    {
+    k++;
+    d *= 10;
+    }
+n = (n + d / 2) / d;
+r->count = (int32_t) ((r->count < 0) ? -n : n);
+r->exp += k;
+}
+
+
+/* --- binary data files ---- */
+
+#define S7150_MAGIC  "S7150BIN"
+#define S7150_BINVER 2       /* 2: RU_NEG; version 1 files are read, too */
+
+/* bits in s7150_rec.flags */
+#define RF_ACDC     0x03    /* enum s7150_acdc */
+#define RF_EFLAG    0x0c    /* enum s7150_eflag, shifted by 2 */
+#define RF_BAD      0x10    /* reading was not decodable, value invalid */
+#define RF_CANON    0x20    /* raw bytes can be regenerated (audit) */
+#define RF_FAST     0x40    /* taken at the fast rate (s7150 -A, -J) */
+#define RF_STEP     0x80    /* a step was detected with this reading (s7150 -J) */
+
+/* bits in s7150_rec.unit */
+#define RU_UNIT     0x7f    /* enum s7150_unit */
+#define RU_NEG      0x80    /* a count of 0 with '-' ("-0.000000") */
+
+/* bits in s7150_binhdr.hflags */
+#define HF_AUDIT    0x01    /* audit file was written */
+#define HF_COMMIT   0x02    /* nrec is updated after every block, see below */
+
+struct s7150_binhdr
+    {
+    char     magic[8];      /* S7150_MAGIC, not terminated */
+    uint16_t version;       /* S7150_BINVER */
+    uint16_t hdrsize;       /* offset of the first record */
+    uint16_t recsize;       /* sizeof(struct s7150_rec) */
+    uint16_t nchan;         /* readings per sample: 1, or 2 for s7150duo */
+    int64_t  t0_us;         /* acquisition start, us since the Epoch */
+    int64_t  t1_us;         /* acquisition stop, 0 while running */
+    uint64_t nrec;          /* number of records, 0 while running */
+    int32_t  pad;           /* GPIB address */
+    int32_t  mode;          /* measurement mode (-m) */
+    int32_t  delay;         /* sampling interval in 0.1 s (-t) */
+    char     program[24];   /* program name and version */
+    char     comment[96];   /* comment text (-c) */
+    uint32_t hflags;        /* HF_... */
+    uint64_t nval;          /* readings without error flag, set with t1_us ... */
+    double   vmean, vstd;   /* ... their mean and standard deviation ... */
+    double   vmin, vmax;    /* ... and extremes; all 0 in older files */
+    uint8_t  reserved[40];  /* zero */
+    };
+
+struct s7150_rec
+    {
+    int64_t  t_us;          /* time since acquisition start, in us */
+    int32_t  count;         /* readout in digits, incl. sign */
+    int8_t   exp;           /* decimal exponent: value = count * 10^exp */
+    uint8_t  unit;          /* enum s7150_unit, and RU_NEG */
+    uint8_t  flags;         /* RF_... */
+    uint8_t  chan;          /* instrument 0 or 1 */
+    };
+
+/* --- audit files ---- */
+
+#define S7150_AUDMAGIC "S7150AUD"
+#define S7150_RAWLEN   (S7150_LEN + 1)  /* reading plus CR, as received */
+
+struct s7150_audhdr
+    {
+    char     magic[8];      /* S7150_AUDMAGIC, not terminated */
+    uint16_t version;       /* S7150_BINVER */
+    uint16_t hdrsize;       /* offset of the first block */
+    uint32_t reserved;      /* zero */
+    };
+
+struct s7150_audblk
+    {
+    char     magic[4];      /* "BLK", terminated */
+    uint32_t nrec;          /* readings covered by this block */
+    uint32_t nraw;          /* raw entries following this header */
+    uint32_t crc;           /* CRC-32 of the raw bytes of all readings */
+    };
+
+struct s7150_raw
+    {
+    uint32_t rec;           /* record number in the data file */
+    uint16_t len;           /* number of bytes received */
+    uint16_t reserved;      /* zero */
+    char     raw[S7150_RAWLEN];
+    };
+
+/* --- files being written ---- */
+
+/* Readers must not use what the writer has not completed yet: for
+   binary files (HF_COMMIT), the header field nrec counts the records
+   written completely; for text files, the sidecar file "datafile"
+   S7150_COMMIT holds the number of complete bytes. Both are updated
+   after every block (-w), with one small pwrite(). The sidecar goes
+   away at a clean stop; without one, the whole file is valid. */
+
+#define S7150_COMMIT ".commit"
+
+struct s7150_commit
+    {
+    int64_t  len;           /* bytes of the data file that are complete */
+    int64_t  done;          /* 1 when the file is closed */
+    };
+
+/* compile-time check of the on-disk sizes */
+typedef char s7150_binhdr_check[(sizeof(struct s7150_binhdr) == 256) ? 1 : -1];
+typedef char s7150_rec_check[(sizeof(struct s7150_rec) == 16) ? 1 : -1];
+typedef char s7150_audblk_check[(sizeof(struct s7150_audblk) == 16) ? 1 : -1];
+typedef char s7150_raw_check[(sizeof(struct s7150_raw) == 24) ? 1 : -1];
+typedef char s7150_nrec_check[(offsetof(struct s7150_binhdr, nrec) % 8 == 0) ? 1 : -1];
+
+
+/********************************************************
+* s7150_torec: Fills a binary record from a reading.    *
+* Input:    - decoded reading, or NULL if not decodable *
+*           - time since start (us), instrument number  *
+*           - ptr to record                             *
+* Return:   nothing                                     *
+********************************************************/
+static inline void s7150_torec (const struct s7150_reading *r, int64_t t_us, \
+                                int chan, struct s7150_rec *rec)
+{
+memset (rec, 0, sizeof(*rec));
+rec->t_us = t_us;
+rec->chan = chan;
+if (r == NULL)
+    {
+    rec->flags = RF_BAD;
+    return;
+    }
+rec->count = r->count;
+rec->exp = r->exp;
+rec->unit = (r->unit & RU_UNIT) | ((r->count == 0 && r->neg) ? RU_NEG : 0);
+rec->flags = (r->acdc & RF_ACDC) | ((r->eflag << 2) & RF_EFLAG);
+}
+
+
+/********************************************************
+* s7150_fromrec: Gets the reading back from a record.   *
+* Input:    - ptr to record, ptr to result              *
+* Return:   1 if OK, 0 if the record holds no reading   *
+********************************************************/
+static inline int s7150_fromrec (const struct s7150_rec *rec, struct s7150_reading *r)
+{
+r->count = rec->count;
+r->exp = rec->exp;
+r->unit = rec->unit & RU_UNIT;
+r->neg = (rec->count < 0) || (rec->unit & RU_NEG);
+r->acdc = rec->flags & RF_ACDC;
+r->eflag = (rec->flags & RF_EFLAG) >> 2;
+return !(rec->flags & RF_BAD);
+}
+
+
+/********************************************************
+* s7150_checkhdr: Validates the header of a binary file *
+* Input:    ptr to header as read from the file         *
+* Return:   1 if OK, 0 if not a (compatible) file       *
+********************************************************/
+static inline int s7150_checkhdr (const struct s7150_binhdr *h)
+{
+return !memcmp(h->magic, S7150_MAGIC, 8) && h->version >= 1 && h->version <= S7150_BINVER && \
+       h->hdrsize >= sizeof(struct s7150_binhdr) && \
+       h->recsize == sizeof(struct s7150_rec);
+}
+
+
+/********************************************************
+* s7150_regen: Regenerates the raw bytes of a reading   *
+*           as the instrument sent them.                *
+* Input:    - ptr to record                             *
+*           - ptr to buffer, at least S7150_RAWLEN+1    *
+* Return:   number of bytes, 0 if not possible          *
+********************************************************/
+static inline int s7150_regen (const struct s7150_rec *rec, char *raw)
+{
+struct s7150_reading r;
+
+if (!s7150_fromrec(rec, &r) || !s7150_encode(&r, raw))
+    return 0;
+raw[S7150_LEN] = '\r';
+raw[S7150_RAWLEN] = 0;
+return S7150_RAWLEN;
+}
+
+
+/********************************************************
+* s7150_commit: Publishes how much of a data file is    *
+*           complete (after it was flushed).            *
+* Input:    - binary file: its descriptor, and the      *
+*             number of records                         *
+*           - text file: descriptor of the sidecar, the *
+*             length of the data file, 1 if closed      *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+static inline int s7150_commitrec (int fd, uint64_t nrec)
+{
+return sizeof(nrec) == pwrite(fd, &nrec, sizeof(nrec), offsetof(struct s7150_binhdr, nrec));
+}
+
+static inline int s7150_commit (int fd, int64_t len, int done)
+{
+struct s7150_commit c;
+
+c.len = len;
+c.done = done;
+return sizeof(c) == pwrite(fd, &c, sizeof(c), 0);
+}
+
+
+/********************************************************
+* s7150_crc32: CRC-32 (as in zlib, Ethernet etc.)       *
+* Input:    - CRC so far (0 to start with)              *
+*           - ptr to data and its length                *
+* Return:   updated CRC                                 *
+********************************************************/
+static inline uint32_t s7150_crc32 (uint32_t crc, const void *buf, size_t len)
+{
+static uint32_t tab[256];
+const uint8_t *p = buf;
+uint32_t c;
+int i, k;
+
+if (tab[1] == 0)        /* build table on first use */
+    for (i = 0; i < 256; i++)
+        {
+        for (c = i, k = 0; k < 8; k++)
+            c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+        tab[i] = c;
+        }
+
+crc = ~crc;
+while (len--)
+    crc = tab[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+return ~crc;
+}
+
+#endif
@@ -0,0 +1,384 @@
+/* vi:set syntax=c expandtab tabstop=4 shiftwidth=4:
+
+ S 7 1 5 0 M A P . H
+
+ Reading binary data files of s7150 (-b) in place, via mmap().
+
+ Copyright (c) 2004...2025 by Joerg Hau.
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2 as
+ published by the Free Software Foundation, provided that the copyright
+ notice remains intact even in future versions. See the file LICENSE
+ for details.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ --------------------------------------------------------------------
+
+ Modification/history:
+
+ 2026-10-18     creation
+
+ Like s7150fmt.h, this is #included; there is nothing to compile
+ separately. The records are used where they are, in the page cache:
+ no read(), no copy, no conversion. Typical use:
+
+    struct s7150_map m;
+    struct s7150_iter it;
+    struct s7150_span s;
+    size_t i;
+
+    if (!s7150_map_open("file.bin", &m))
+        ...
+    s7150_iter_init(&it, s7150_map_span(&m, s7150_map_find(&m, t_us), m.nrec));
+    while (s7150_iter_chunk(&it, &s))
+        for (i = 0; i < s.n; i++)
+            ... s.rec[i].count, s.rec[i].t_us ...
+    s7150_map_close(&m);
+
+ The iterator hands out the records in chunks of S7150_MAP_CHUNK bytes
+ and asks the kernel to read S7150_MAP_AHEAD bytes ahead, so a cold
+ file is read at disk speed and a cached one at memory speed.
+
+ Only complete and committed records are counted (see s7150fmt.h),
+ so a file that is still being written can be mapped;
+ s7150_map_refresh() picks up what was added. To wait for that without
+ polling the file, use s7150_watch() and s7150_wait(). The same goes
+ for text files, with s7150_committed() instead of a map.
+
+*/
+
+#ifndef S7150MAP_H
+#define S7150MAP_H
+
+#include <stddef.h>
+#include <math.h>           /* NAN */
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include "s7150fmt.h"
+
+#define S7150_MAP_CHUNK  (256 << 10)    /* bytes per chunk of the iterator */
+#define S7150_MAP_AHEAD  (8 << 20)      /* bytes to have read ahead */
+
+struct s7150_map
+    {
+    const struct s7150_binhdr *hdr; /* header, as in the file */
+    const struct s7150_rec *rec;    /* records ... */
+    size_t  nrec;                   /* ... complete ones */
+    void    *base;                  /* as delivered by mmap() */
+    size_t  size;                   /* bytes mapped */
+    };
+
+/* a run of consecutive records */
+struct s7150_span
+    {
+    const struct s7150_rec *rec;
+    size_t  n;
+    };
+
+struct s7150_iter
+    {
+    const struct s7150_rec *p;      /* next record */
+    const struct s7150_rec *end;    /* end of the span */
+    const char *ahead;              /* read-ahead requested up to here */
+    };
+
+
+/********************************************************
+* s7150_map_count: Sets the number of records that can  *
+*           be used: the complete ones, and of these    *
+*           only the committed ones (HF_COMMIT).        *
+* Input:    ptr to map                                  *
+* Return:   number of records                           *
+********************************************************/
+static inline size_t s7150_map_count (struct s7150_map *m)
+{
+const volatile uint64_t *nrec = &m->hdr->nrec;  /* the writer updates it */
+uint64_t n = *nrec;
+
+m->nrec = (m->size - m->hdr->hdrsize) / sizeof(struct s7150_rec);
+if ((m->hdr->hflags & HF_COMMIT) && n < m->nrec)
+    m->nrec = n;
+return m->nrec;
+}
+
+
+/********************************************************
+* s7150_map_open: Maps a binary data file and checks    *
+*           its header.                                 *
+* Input:    - file name                                 *
+*           - ptr to map                                *
+* Return:   1 if OK, 0 if error (or not a binary file)  *
+********************************************************/
+static inline int s7150_map_open (const char *fname, struct s7150_map *m)
+{
+struct stat st;
+int fd;
+
+memset (m, 0, sizeof(*m));
+if ((fd = open(fname, O_RDONLY)) < 0)
+    return 0;
+if (fstat(fd, &st) || st.st_size < (off_t) sizeof(struct s7150_binhdr))
+    {
+    close(fd);
+    return 0;
+    }
+m->size = st.st_size;
+m->base = mmap(NULL, m->size, PROT_READ, MAP_SHARED, fd, 0);
+close(fd);                          /* the mapping stays */
+if (m->base == MAP_FAILED)
+    {
+    m->base = NULL;
+    return 0;
+    }
+
+m->hdr = m->base;
+if (!s7150_checkhdr(m->hdr) || m->hdr->hdrsize > m->size)
+    {
+    munmap(m->base, m->size);
+    m->base = NULL;
+    return 0;
+    }
+m->rec = (const struct s7150_rec *) ((const char *) m->base + m->hdr->hdrsize);
+s7150_map_count(m);
+return 1;
+}
+
+
+/********************************************************
+* s7150_map_refresh: Maps the file again if it has      *
+*           grown (acquisition still running). Spans    *
+*           and iterators taken before are invalid then.*
+* Input:    - file name                                 *
+*           - ptr to map                                *
+* Return:   1 if OK, 0 if error (map is closed then)    *
+********************************************************/
+static inline int s7150_map_refresh (const char *fname, struct s7150_map *m)
+{
+struct stat st;
+
+if (0 == stat(fname, &st) && (size_t) st.st_size == m->size)
+    {
+    s7150_map_count(m);
+    return 1;
+    }
+if (m->base)
+    munmap(m->base, m->size);
+return s7150_map_open(fname, m);
+}
+
+
+static inline void s7150_map_close (struct s7150_map *m)
+{
+if (m->base)
+    munmap(m->base, m->size);
+memset (m, 0, sizeof(*m));
+}
+
+
+/********************************************************
+* s7150_map_find: First record not before a given time; *
+*           the records are sorted by time.             *
+* Input:    - ptr to map                                *
+*           - time since acquisition start, in us       *
+* Return:   index of record, nrec if there is none      *
+********************************************************/
+static inline size_t s7150_map_find (const struct s7150_map *m, int64_t t_us)
+{
+size_t lo = 0, hi = m->nrec, mid;
+
+while (lo < hi)
+    {
+    mid = lo + (hi - lo) / 2;
+    if (m->rec[mid].t_us < t_us)
+        lo = mid + 1;
+    else
+        hi = mid;
+    }
+return lo;
+}
+
+
+/********************************************************
+* s7150_map_span: Records first ... last-1, clipped to  *
+*           what is in the file.                        *
+********************************************************/
+static inline struct s7150_span s7150_map_span (const struct s7150_map *m, size_t first, size_t last)
+{
+struct s7150_span s;
+
+if (last > m->nrec)
+    last = m->nrec;
+if (first > last)
+    first = last;
+s.rec = m->rec + first;
+s.n = last - first;
+return s;
+}
+
+
+/********************************************************
+* s7150_iter_init: Prepares to go through a span, and   *
+*           tells the kernel we'll read it in order.    *
+********************************************************/
+static inline void s7150_iter_init (struct s7150_iter *it, struct s7150_span s)
+{
+long pg = sysconf(_SC_PAGESIZE);
+uintptr_t a = (uintptr_t) s.rec & ~(uintptr_t) (pg - 1);
+
+it->p = s.rec;
+it->end = s.rec + s.n;
+it->ahead = (const char *) a;
+if (s.n)
+    posix_madvise((void *) a, (const char *) it->end - (const char *) a, POSIX_MADV_SEQUENTIAL);
+}
+
+
+/* keeps S7150_MAP_AHEAD bytes requested ahead of the iterator */
+static inline void s7150_iter_ahead (struct s7150_iter *it)
+{
+size_t len = S7150_MAP_AHEAD;
+
+if ((const char *) it->p + S7150_MAP_AHEAD / 2 <= it->ahead || it->ahead >= (const char *) it->end)
+    return;
+if (it->ahead + len > (const char *) it->end)
+    len = (const char *) it->end - it->ahead;
+posix_madvise((void *) it->ahead, len, POSIX_MADV_WILLNEED);
+it->ahead += len;
+}
+
+
+/********************************************************
+* s7150_iter_chunk: Next chunk of records.              *
+* Input:    - iterator                                  *
+*           - ptr to span for the chunk                 *
+* Return:   1 if there is one, 0 at the end             *
+********************************************************/
+static inline int s7150_iter_chunk (struct s7150_iter *it, struct s7150_span *s)
+{
+size_t n = it->end - it->p;
+
+if (n == 0)
+    return 0;
+if (n > S7150_MAP_CHUNK / sizeof(struct s7150_rec))
+    n = S7150_MAP_CHUNK / sizeof(struct s7150_rec);
+s7150_iter_ahead(it);
+s->rec = it->p;
+s->n = n;
+it->p += n;
+return 1;
+}
+
+
+/********************************************************
+* s7150_iter_next: Next record, one by one.             *
+* Return:   ptr to record, NULL at the end              *
+********************************************************/
+static inline const struct s7150_rec *s7150_iter_next (struct s7150_iter *it)
+{
+if (it->p == it->end)
+    return NULL;
+s7150_iter_ahead(it);
+return it->p++;
+}
+
+
+/********************************************************
+* s7150_committed: How much of a text file is complete, *
+*           from its sidecar (see s7150fmt.h).          *
+* Input:    - name of data file                         *
+*           - ptr to length in bytes                    *
+* Return:   1 if the file is closed, 0 if it is still   *
+*           being written, -1 if there is no sidecar    *
+********************************************************/
+static inline int s7150_committed (const char *fname, int64_t *len)
+{
+char    name[4096];
+struct  s7150_commit c;
+int     fd, n;
+
+snprintf(name, sizeof(name), "%s" S7150_COMMIT, fname);
+if ((fd = open(name, O_RDONLY)) < 0)
+    return -1;
+n = pread(fd, &c, sizeof(c), 0);
+close(fd);
+if (n != sizeof(c))
+    return -1;
+*len = c.len;
+return c.done != 0;
+}
+
+
+/********************************************************
+* s7150_watch: Prepares to wait for a file to change.   *
+* Input:    name of file (binary data file, or sidecar  *
+*           of a text file)                             *
+* Return:   descriptor for s7150_wait(), -1 if error    *
+********************************************************/
+static inline int s7150_watch (const char *fname)
+{
+int fd;
+
+if ((fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0)
+    return -1;
+if (inotify_add_watch(fd, fname, IN_MODIFY | IN_CLOSE_WRITE) < 0)
+    {
+    close(fd);
+    return -1;
+    }
+return fd;
+}
+
+
+/********************************************************
+* s7150_wait: Sleeps until the file has changed, or at  *
+*           most 'ms' milliseconds (-1 = no limit).     *
+*           Without a watch (fd < 0), just sleeps.      *
+* Input:    - descriptor from s7150_watch()             *
+*           - timeout                                   *
+* Return:   1 if changed, 0 if not                      *
+********************************************************/
+static inline int s7150_wait (int fd, int ms)
+{
+struct pollfd p;
+char buf[4096];
+int n;
+
+if (fd < 0)
+    {
+    poll(NULL, 0, ms);
+    return 0;
+    }
+p.fd = fd;
+p.events = POLLIN;
+if (poll(&p, 1, ms) <= 0)
+    return 0;
+while ((n = read(fd, buf, sizeof(buf))) > 0)     /* drain the events */
+    ;
+return 1;
+}
+
+
+/********************************************************
+* s7150_recvalue: Value of a record as double, like     *
+*           s7150_value(); NaN if it holds no reading.  *
+********************************************************/
+static inline double s7150_recvalue (const struct s7150_rec *r)
+{
+static const double p10[] = { 1.0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+                              1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+
+if (r->flags & RF_BAD)
+    return NAN;
+return r->count / p10[(-r->exp) & 15];
+}
+
+#endif
@@ -0,0 +1,1117 @@
+/* vi:set syntax=c expandtab tabstop=4 shiftwidth=4:
+
+ S 7 1 5 0 Q . C
+
+ Queries on recorded data: mean, min, max, standard deviation and count
+ of the readings in a time range, optionally in buckets of equal width.
+
+ Copyright (c) 2004...2025 by Joerg Hau.
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2 as
+ published by the Free Software Foundation, provided that the copyright
+ notice remains intact even in future versions. See the file LICENSE
+ for details.
+
+ If you use this program (or any part of it) in another application,
+ note that the resulting application becomes also GPL. In other
+ words, GPL is a "contaminating" license.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ --------------------------------------------------------------------
+
+ Modification/history (adapt VERSION below when changing!):
+
+ 2026-10-18     creation; follow mode (-F) for files being written;
+                quantiles per bucket (-p), digests saved (-K) and
+                merged (-M), see s7150td.h
+
+ This should compile with any C compiler, something like:
+
+ gcc -Wall -O2 -o s7150q s7150q.c -lm
+
+ Works on text files of s7150, s7150duo and s7150sup, and on binary
+ files of s7150 (-b). Binary files have fixed-size records and are
+ searched directly, in place (see s7150map.h). For text files, an
+ index (file.idx: time and offset of every IDXSTEP-th line) is built on
+ the first query and extended when the file has grown since, so later
+ queries only read the lines in the requested range. The index notes
+ inode, time of last change, and CRCs of the first and last bytes it
+ covers; a file written anew under the same name is indexed anew. Only what the
+ writer has committed is read (see s7150fmt.h).
+
+*/
+
+#define VERSION "V20261018"     /* String! */
+
+#define _FILE_OFFSET_BITS 64    /* data files > 2 GB */
+#define _XOPEN_SOURCE 700       /* strptime() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <errno.h>          /* command line reading */
+#include <unistd.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <sys/time.h>       /* clock timing */
+#include "s7150fmt.h"       /* decoding of readings */
+#include "s7150map.h"       /* binary files, in place */
+#include "s7150td.h"        /* quantiles */
+
+#define MAXLEN   90         /* text buffers etc */
+#define IDXMAGIC "S7150IDX"
+#define IDXVER    2
+#define IDXSTEP 1024        /* data lines per index entry */
+#define IDXHEAD   64        /* bytes of the data file kept to recognise it */
+#define IDXSUM  4096        /* bytes at start and end of what is indexed, in a CRC */
+
+#define ERR_FILE  4         /* error code */
+
+/* --- stuff for reading the command line --- */
+
+char *optarg;               /* global: pointer to argument of current option */
+int optind = 1;             /* global: index of which argument is next. Is used
+                            as a global variable for collection of further
+                            arguments (= not options) via argv pointers */
+
+/* --- miscellaneous function prototypes ---- */
+
+double  timeinfo (void);
+int     GetOpt (int argc, char *argv[], char *optionS);
+
+/* --- index of a text file ---- */
+
+struct idxhdr
+    {
+    char    magic[8];       /* IDXMAGIC, not terminated */
+    int32_t version;        /* IDXVER */
+    int32_t step;           /* IDXSTEP */
+    int64_t size;           /* bytes of the data file covered */
+    double  t0;             /* acquisition start (Epoch), 0 if unknown */
+    int64_t nent;           /* number of entries following */
+    char    head[IDXHEAD];  /* first bytes of the data file */
+    uint64_t dev, ino;      /* the data file itself ... */
+    int64_t mtime;          /* ... its last change when indexed, in ns ... */
+    uint32_t crchead;       /* ... and CRC-32 of its first and last IDXSUM */
+    uint32_t crctail;       /* bytes up to 'size' (header, last lines) */
+    };
+
+struct idxent
+    {
+    double  t;              /* time of the line, in min */
+    int64_t off;            /* offset of the line in the data file */
+    };
+
+/* --- what to look for, and what was found ---- */
+
+struct query
+    {
+    double  from, to;       /* time range, in min since start */
+    double  width;          /* bucket width in min, 0 = one bucket */
+    int     col;            /* which reading in a line (s7150duo) ... */
+    int     pad;            /* ... and which instrument (s7150sup), -1 = all */
+    double  t0;             /* acquisition start (Epoch), 0 if unknown */
+    int     follow;         /* go on while the file is being written */
+    struct  s7150_td *btd;  /* digest of the bucket (-p), or NULL ... */
+    struct  s7150_td *all;  /* ... and of the whole range (-K) */
+    unsigned long nread;    /* lines (records) read */
+    };
+
+struct bucket
+    {
+    long    i;              /* bucket number, -1 if none started */
+    double  t;              /* its start in min */
+    unsigned long n;        /* readings ... */
+    unsigned long nbad;     /* ... and overloads or undecodable ones */
+    double  mean, m2;       /* running mean and sum of squared deviations */
+    double  min, max;
+    };
+
+int     idx_load (const char *fname, struct idxhdr *h, struct idxent **ent);
+int     idx_scan (FILE *fp, struct idxhdr *h, struct idxent **ent);
+int     idx_save (const char *fname, const struct idxhdr *h, const struct idxent *ent);
+int     idx_sums (FILE *fp, const struct stat *st, struct idxhdr *h);
+int     idx_same (FILE *fp, const struct stat *st, const struct idxhdr *h);
+int     query_text (const char *fname, FILE *fp, const struct idxhdr *h, \
+                    const struct idxent *ent, struct query *q, int sup);
+int     query_bin (const char *fname, struct query *q);
+int     bench (const char *fname);
+int     merge (char *fnames[], const char *tdname);
+void    bucket_add (struct bucket *b, const struct query *q, double t, \
+                    const struct s7150_reading *r);
+void    bucket_print (const struct bucket *b, const struct query *q);
+int     parsetime (const char *s, double t0, double *tmin);
+
+
+/********************************************************
+* main:       main program.                             *
+* Input:      see below.                                *
+* Return:     0 if OK, else error code                  *
+********************************************************/
+int main (int argc, char *argv[])
+{
+static char *disclaimer =
+"\ns7150q - Queries on data recorded by s7150. " VERSION ".\n"
+"Copyright (C) 2004...2025 by Joerg Hau.\n\n"
+"This program is free software; you can redistribute it and/or modify it under\n"
+"the terms of the GNU General Public License, version 2, as published by the\n"
+"Free Software Foundation.\n\n"
+"This program is distributed in the hope that it will be useful, but WITHOUT ANY\n"
+"WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A\n"
+"PARTICULAR PURPOSE. See the GNU General Public License for details.\n";
+
+static char *msg = "\nSyntax: s7150q [-h] [-f from] [-t to] [-b width] [-k col] [-a id] [-r] [-F] [-p] [-K file] [-v] [-B] datafile"
+"\n        s7150q [-K file] -M digest [digest ...]"
+"\n        -h       this help screen"
+"\n        -f time  start of the time range (default: start of acquisition)"
+"\n        -t time  end of the time range, not included (default: end of file)"
+"\n        -b min   statistics per bucket of 'min' minutes (default: one for all)"
+"\n        -k col   which reading of s7150duo files, 1 or 2 (default is 1)"
+"\n        -a id    only instrument at GPIB address 'id' (s7150sup files)"
+"\n        -r       rebuild the index of a text file"
+"\n        -F       follow: go on while the file is being written; without -b,"
+"\n                 every reading is shown"
+"\n        -p       quantiles p0.1, p1, p50, p99 and p99.9 per bucket, too"
+"\n        -K file  save the distribution of the range (t-digest) to file"
+"\n        -M       merge digests saved by s7150 -K or s7150q -K, and show"
+"\n                 the quantiles of all the readings in them"
+"\n        -v       report index and reading statistics on stderr"
+"\n        -B       benchmark: sum all readings of a binary file"
+"\n        time     minutes since start (12.5), clock time on the first day"
+"\n                 (02:00[:00]), on day N (3/02:00) or absolute"
+"\n                 (2026-10-18 02:00); clock times need the start in the file"
+"\n\nOutput is tab-separated: bucket start (min and clock), n, mean, min, max,"
+"\nstandard deviation, number of overloads or undecodable readings, and the"
+"\nquantiles (-p).\n\n";
+
+char    filename[MAXLEN], idxname[MAXLEN+4], *from = NULL, *to = NULL;
+char    do_rebuild = 0, do_verbose = 0, do_bench = 0, do_merge = 0, *tdname = NULL;
+int     key, ok, size, sup, i;
+double  t;
+FILE    *fp;
+struct  query q;
+struct  stat st;
+struct  idxhdr h;
+struct  idxent *ent = NULL;
+struct  s7150_binhdr bh;
+static struct s7150_td btd, all;    /* too big for the stack */
+FILE    *tdfile = NULL;
+
+memset (&q, 0, sizeof(q));
+q.col = 1;
+q.pad = -1;
+
+/* --- decode and read the command line --- */
+
+while ((key = GetOpt(argc, argv, "hrvBFpMf:t:b:k:a:K:")) != EOF)
+    switch (key)
+        {
+        case 'h':                    /* help me */
+            fprintf (stderr, disclaimer);
+            fprintf (stderr, msg);
+            return 0;
+        case 'r':
+            do_rebuild = 1;
+            continue;
+        case 'v':
+            do_verbose = 1;
+            continue;
+        case 'B':
+            do_bench = 1;
+            continue;
+        case 'F':
+            q.follow = 1;
+            continue;
+        case 'p':
+            s7150_td_init(&btd);
+            q.btd = &btd;
+            continue;
+        case 'M':
+            do_merge = 1;
+            continue;
+        case 'K':
+            tdname = optarg;
+            continue;
+        case 'f':
+            from = optarg;
+            continue;
+        case 't':
+            to = optarg;
+            continue;
+        case 'b':
+            sscanf (optarg, "%lf", &q.width);
+            if (q.width < 0.0)
+                {
+                fprintf(stderr, "Error: bucket width must be positive.\n");
+                return 1;
+                }
+            continue;
+        case 'k':
+            sscanf (optarg, "%d", &q.col);
+            if (q.col < 1 || q.col > 2)
+                {
+                fprintf(stderr, "Error: column must be 1 or 2.\n");
+                return 1;
+                }
+            continue;
+        case 'a':
+            sscanf (optarg, "%d", &q.pad);
+            continue;
+        case '~':                    /* invalid arg */
+        default:
+        fprintf (stderr, "'%s -h' for help.\n\n", argv[0]);
+            return 1;
+        }
+
+if (argv[optind] == NULL)
+    {
+    fprintf (stderr, msg);
+    fprintf (stderr, "Please specify a data file.\n");
+    return 1;
+    }
+if (do_merge)
+    return merge(argv + optind, tdname);
+strncpy (filename, argv[optind], MAXLEN-1);
+if (do_bench)
+    return bench(filename);
+
+/* opened now, so a wrong name is found before the work is done */
+if (tdname && NULL == (tdfile = fopen(tdname, "wt")))
+    {
+    fprintf(stderr, "Could not open '%s' for writing.\n", tdname);
+    return ERR_FILE;
+    }
+if (tdfile)
+    {
+    s7150_td_init(&all);
+    q.all = &all;
+    }
+
+t = timeinfo();
+if (NULL == (fp = fopen(filename, "rb")) || fstat(fileno(fp), &st))
+    {
+    fprintf(stderr, "Could not open '%s'.\n", filename);
+    return ERR_FILE;
+    }
+
+/* a file that was just created is empty until the header is out */
+while (q.follow && st.st_size == 0 && 0 == fstat(fileno(fp), &st))
+    s7150_wait(-1, 200);
+
+/* binary files need no index, text files do */
+size = fread(&bh, 1, sizeof(bh), fp);
+if (size == sizeof(bh) && s7150_checkhdr(&bh))
+    {
+    q.t0 = bh.t0_us / 1e6;
+    sup = -1;
+    }
+else
+    {
+    memset (&h, 0, sizeof(h));
+    memcpy (h.head, &bh, size < IDXHEAD ? size : IDXHEAD);
+    sup = !strncmp(h.head, "# s7150sup", 10);
+    sprintf(idxname, "%s.idx", filename);
+    ok = !do_rebuild && idx_load(idxname, &h, &ent);
+    if (ok && 0 == idx_same(fp, &st, &h))     /* not the same file any more */
+        {
+        free (ent);
+        ent = NULL;
+        ok = 0;
+        }
+    if (!ok || h.size != st.st_size)
+        {
+        if (!ok)
+            {
+            h.size = h.nent = 0;
+            h.t0 = 0.0;
+            }
+        if (0 == idx_scan(fp, &h, &ent))
+            {
+            fprintf(stderr, "Could not index '%s'.\n", filename);
+            return ERR_FILE;
+            }
+        if (0 == idx_sums(fp, &st, &h) || 0 == idx_save(idxname, &h, ent))
+            fprintf(stderr, "Could not write index '%s', continuing without.\n", idxname);
+        if (do_verbose)
+            fprintf(stderr, "# index %s: %lld entries (%s)\n", idxname, (long long) h.nent,
+                    ok ? "extended" : "built");
+        }
+    else if (do_verbose)
+        fprintf(stderr, "# index %s: %lld entries\n", idxname, (long long) h.nent);
+    q.t0 = h.t0;
+    }
+
+q.from = 0.0;
+q.to = HUGE_VAL;
+if ((from && 0 == parsetime(from, q.t0, &q.from)) || (to && 0 == parsetime(to, q.t0, &q.to)))
+    {
+    fprintf(stderr, "Error: can't make sense of that time (or no start time in '%s').\n", filename);
+    return 1;
+    }
+
+printf("# s7150q " VERSION ": %s\n", filename);
+printf("# from %.4f to %.4f min, bucket %g min\n", q.from, q.to, q.width);
+printf("# min\tclock\tn\tmean\tmin\tmax\tstd\tbad");
+for (i = 0; q.btd && i < S7150_TD_NQ; i++)
+    printf("\t%s", s7150_td_qname[i]);
+printf("\n");
+if (sup < 0)
+    ok = query_bin(filename, &q);
+else
+    ok = query_text(filename, fp, &h, ent, &q, sup);
+fclose (fp);
+free (ent);
+if (tdfile && (0 == s7150_td_save(tdfile, &all) || fclose(tdfile)))
+    {
+    fprintf(stderr, "Could not write '%s'.\n", tdname);
+    ok = 0;
+    }
+
+if (do_verbose)
+    fprintf(stderr, "# %lu lines read, %.1f ms\n", q.nread, 1e3 * (timeinfo() - t));
+return ok ? 0 : ERR_FILE;
+}
+
+
+/********************************************************
+* idx_load: Reads the index of a text file, if it is    *
+*           for this file (same first bytes; the rest   *
+*           is up to idx_same()).                       *
+* Input:    - name of index file                        *
+*           - header, with head[] of the data file      *
+*           - ptr to entries, allocated here            *
+* Return:   1 if OK, 0 if no (usable) index             *
+********************************************************/
+int idx_load (const char *fname, struct idxhdr *h, struct idxent **ent)
+{
+FILE    *fp;
+struct  idxhdr hh;
+int     ok = 0;
+
+if (NULL == (fp = fopen(fname, "rb")))
+    return 0;
+if (1 == fread(&hh, sizeof(hh), 1, fp) && !memcmp(hh.magic, IDXMAGIC, 8) && \
+    hh.version == IDXVER && hh.step == IDXSTEP && hh.nent > 0 && \
+    !memcmp(hh.head, h->head, IDXHEAD) && \
+    NULL != (*ent = malloc(hh.nent * sizeof(**ent))))
+    {
+    ok = (hh.nent == fread(*ent, sizeof(**ent), hh.nent, fp));
+    if (ok)
+        *h = hh;
+    else
+        {
+        free (*ent);
+        *ent = NULL;
+        }
+    }
+fclose(fp);
+return ok;
+}
+
+
+/********************************************************
+* idx_sums: Notes which file the index is for: device,  *
+*           inode, time of last change, and CRC-32 of   *
+*           the first and the last IDXSUM bytes that    *
+*           are indexed (h->size).                      *
+* Input:    - data file, and what fstat() says about it *
+*           - index header, updated here                *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+int idx_sums (FILE *fp, const struct stat *st, struct idxhdr *h)
+{
+char    buf[IDXSUM];
+int64_t n = (h->size < IDXSUM) ? h->size : IDXSUM;
+
+h->dev = st->st_dev;
+h->ino = st->st_ino;
+h->mtime = st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+if (n != pread(fileno(fp), buf, n, 0))
+    return 0;
+h->crchead = s7150_crc32(0, buf, n);
+if (n != pread(fileno(fp), buf, n, h->size - n))
+    return 0;
+h->crctail = s7150_crc32(0, buf, n);
+return 1;
+}
+
+
+/********************************************************
+* idx_same: Checks that an index is for this file, as   *
+*           it was then: the same file (not one written *
+*           anew under its name), with the same first   *
+*           and last bytes, and, if it has not grown,   *
+*           not changed since.                          *
+* Input:    - data file, and what fstat() says about it *
+*           - index header                              *
+* Return:   1 if the index can be used (or extended),   *
+*           0 if it must be built anew                  *
+********************************************************/
+int idx_same (FILE *fp, const struct stat *st, const struct idxhdr *h)
+{
+struct idxhdr now = *h;
+
+if (h->size > st->st_size || 0 == idx_sums(fp, st, &now))
+    return 0;
+return now.dev == h->dev && now.ino == h->ino && \
+       now.crchead == h->crchead && now.crctail == h->crctail && \
+       (h->size < st->st_size || now.mtime == h->mtime);
+}
+
+
+/********************************************************
+* idx_scan: Indexes a text file from the last entry on  *
+*           (or from the start, if there is none). Only *
+*           complete lines are taken, so a file that is *
+*           still being written can be extended later.  *
+* Input:    - data file                                 *
+*           - index header and entries, updated here    *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+int idx_scan (FILE *fp, struct idxhdr *h, struct idxent **ent)
+{
+char    line[4*MAXLEN], *p;
+off_t   off = 0;
+long    n = 0, len, max;
+double  tmin;
+struct  idxent *e;
+struct  tm tm;
+
+/* the last entry is done again; its line may have been incomplete */
+if (h->nent)
+    off = (*ent)[--h->nent].off;
+max = h->nent + 1024;
+if (NULL == (e = realloc(*ent, max * sizeof(*e))))
+    return 0;
+*ent = e;
+if (fseeko(fp, off, SEEK_SET))
+    return 0;
+h->size = off;
+
+while (fgets(line, sizeof(line), fp))
+    {
+    len = strlen(line);
+    if (line[len-1] != '\n')
+        break;
+    if (line[0] == '#' && h->nent == 0)
+        {
+        /* s7150 has the exact start time, the others only ctime() */
+        if (NULL != (p = strstr(line, " t0=")))
+            h->t0 = atof(p+4);
+        else if (h->t0 == 0.0 && !strncmp(line, "# Acquisition start: ", 21))
+            {
+            memset (&tm, 0, sizeof(tm));
+            if (strptime(line+21, "%a %b %d %H:%M:%S %Y", &tm))
+                {
+                tm.tm_isdst = -1;
+                h->t0 = mktime(&tm);
+                }
+            }
+        }
+    else if ((tmin = strtod(line, &p), p != line) && !(n++ % IDXSTEP))
+        {
+        if (h->nent == max)
+            {
+            max *= 2;
+            if (NULL == (e = realloc(*ent, max * sizeof(*e))))
+                return 0;
+            *ent = e;
+            }
+        e[h->nent].t = tmin;
+        e[h->nent++].off = off;
+        }
+    off += len;
+    }
+h->size = off;
+return !ferror(fp);
+}
+
+
+/********************************************************
+* idx_save: Writes the index (via a temporary file, so  *
+*           a concurrent reader never sees half of it). *
+* Input:    - name of index file                        *
+*           - header and entries                        *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+int idx_save (const char *fname, const struct idxhdr *h, const struct idxent *ent)
+{
+char    tmp[MAXLEN+16];
+FILE    *fp;
+struct  idxhdr hh = *h;
+int     ok;
+
+memcpy (hh.magic, IDXMAGIC, 8);
+hh.version = IDXVER;
+hh.step = IDXSTEP;
+sprintf(tmp, "%s.%d", fname, (int) getpid());
+if (NULL == (fp = fopen(tmp, "wb")))
+    return 0;
+ok = (1 == fwrite(&hh, sizeof(hh), 1, fp)) && \
+     (hh.nent == fwrite(ent, sizeof(*ent), hh.nent, fp));
+ok &= (0 == fclose(fp));
+if (ok)
+    ok = (0 == rename(tmp, fname));
+if (!ok)
+    unlink(tmp);
+return ok;
+}
+
+
+/********************************************************
+* query_text: Statistics over a text file. Starts at    *
+*           the last index entry before the range, and  *
+*           stops at the first line after it. Only the  *
+*           committed part of the file is read (see     *
+*           s7150fmt.h); when following, waits for more *
+*           until the file is closed.                   *
+* Input:    - name of data file, and the open file      *
+*           - its index                                 *
+*           - the query                                 *
+*           - 1 if written by s7150sup (pad in col. 2)  *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+int query_text (const char *fname, FILE *fp, const struct idxhdr *h, \
+                const struct idxent *ent, struct query *q, int sup)
+{
+char    line[4*MAXLEN], name[MAXLEN+8], *p;
+long    lo = 0, hi = h->nent - 1, mid;
+int     i, ok, done, wfd = -1;
+size_t  n;
+off_t   off;
+int64_t len = 0;
+double  tmin;
+struct  bucket b;
+struct  s7150_reading r;
+
+/* last entry not after the start of the range */
+while (lo < hi)
+    {
+    mid = (lo + hi + 1) / 2;
+    if (ent[mid].t <= q->from)
+        lo = mid;
+    else
+        hi = mid - 1;
+    }
+off = h->nent ? ent[lo].off : 0;
+if (fseeko(fp, off, SEEK_SET))
+    return 0;
+
+/* the sidecar changes with every commit; without one (older
+   programs), watch the data file itself */
+if (q->follow)
+    {
+    sprintf(name, "%s" S7150_COMMIT, fname);
+    wfd = s7150_watch(access(name, R_OK) ? fname : name);
+    }
+
+b.i = -1;
+do  {
+    done = s7150_committed(fname, &len);
+    while (fgets(line, sizeof(line), fp))
+        {
+        /* not complete yet: take it next time */
+        n = strlen(line);
+        if (line[n-1] != '\n' || (done >= 0 && off + n > len))
+            break;
+        off += n;
+
+        tmin = strtod(line, &p);
+        if (line[0] == '#' || p == line)
+            {
+            if (!strncmp(line, "# Acquisition stop", 18))
+                done = 1;
+            else if (q->t0 == 0.0 && (p = strstr(line, " t0=")))
+                q->t0 = atof(p+4);      /* file was empty when indexed */
+            continue;
+            }
+        q->nread++;
+        if (tmin < q->from)
+            continue;
+        if (tmin >= q->to)
+            {
+            done = 1;
+            break;
+            }
+
+        /* time, [pad,] reading [, reading] */
+        p = strchr(line, '\t');
+        if (sup && p && q->pad >= 0 && atoi(p+1) != q->pad)
+            continue;
+        for (i = sup ? 0 : 1; p && i < q->col; i++)
+            p = strchr(p+1, '\t');
+        ok = p && s7150_decode(p+1, &r);
+        bucket_add(&b, q, tmin, ok ? &r : NULL);
+        }
+    if (!q->follow || done == 1 || ferror(fp))
+        break;
+
+    fflush(stdout);
+    s7150_wait(wfd, wfd < 0 ? 200 : 1000);
+    clearerr(fp);
+    fseeko(fp, off, SEEK_SET);
+    }
+    while (1);
+
+if (wfd >= 0)
+    close(wfd);
+if (b.i >= 0)
+    bucket_print(&b, q);
+return !ferror(fp);
+}
+
+
+/********************************************************
+* query_bin: Statistics over a binary file, read in     *
+*           place (see s7150map.h). The records are     *
+*           sorted by time, so the start is found by    *
+*           bisection. When following, waits for more  *
+*           until the file is closed.                   *
+* Input:    - name of data file                         *
+*           - the query                                 *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+int query_bin (const char *fname, struct query *q)
+{
+struct  s7150_map m;
+struct  s7150_iter it;
+struct  s7150_span s;
+struct  s7150_reading r;
+struct  bucket b;
+size_t  i, next;
+double  tmin;
+int     wfd = -1, done;
+
+if (0 == s7150_map_open(fname, &m))
+    return 0;
+if (q->follow)
+    wfd = s7150_watch(fname);
+
+b.i = -1;
+next = s7150_map_find(&m, (int64_t) ceil(q->from * 6e7));
+do  {
+    /* the writer sets t1 last, so what is committed now is all */
+    done = (((const volatile struct s7150_binhdr *) m.hdr)->t1_us != 0);
+    s7150_map_count(&m);
+    s7150_iter_init(&it, s7150_map_span(&m, next, m.nrec));
+    while (s7150_iter_chunk(&it, &s))
+        for (i = 0; i < s.n; i++)
+            {
+            q->nread++;
+            tmin = s.rec[i].t_us / 6e7;
+            if (tmin >= q->to)
+                {
+                done = 1;
+                goto out;
+                }
+            if (s.rec[i].chan != q->col - 1)
+                continue;
+            bucket_add(&b, q, tmin, s7150_fromrec(&s.rec[i], &r) ? &r : NULL);
+            }
+    next = m.nrec;
+out:
+    if (!q->follow || done)
+        break;
+
+    fflush(stdout);
+    s7150_wait(wfd, wfd < 0 ? 200 : 1000);
+    if (0 == s7150_map_refresh(fname, &m))
+        return 0;
+    }
+    while (1);
+
+if (wfd >= 0)
+    close(wfd);
+if (b.i >= 0)
+    bucket_print(&b, q);
+s7150_map_close(&m);
+return 1;
+}
+
+
+/********************************************************
+* bench:    Sums all readings of a binary file, read in *
+*           place, to see how fast this can be done.    *
+* Input:    name of data file                           *
+* Return:   0 if OK, else error code                    *
+********************************************************/
+int bench (const char *fname)
+{
+struct  s7150_map m;
+struct  s7150_iter it;
+struct  s7150_span s;
+size_t  i, n = 0;
+double  sum = 0.0, t;
+
+t = timeinfo();
+if (0 == s7150_map_open(fname, &m))
+    {
+    fprintf(stderr, "'%s' is not a binary data file.\n", fname);
+    return ERR_FILE;
+    }
+s7150_iter_init(&it, s7150_map_span(&m, 0, m.nrec));
+while (s7150_iter_chunk(&it, &s))
+    for (i = 0; i < s.n; i++)
+        if (!(s.rec[i].flags & (RF_BAD | RF_EFLAG)))
+            {
+            sum += s7150_recvalue(&s.rec[i]);
+            n++;
+            }
+t = timeinfo() - t;
+printf("%s: %lu records, %lu summed: %.10g\n", fname, (unsigned long) m.nrec, (unsigned long) n, sum);
+printf("%.3f s, %.1f Mrecords/s, %.2f GB/s\n", t, m.nrec / t / 1e6, m.size / t / 1e9);
+s7150_map_close(&m);
+return 0;
+}
+
+
+/********************************************************
+* merge:    Merges digests saved with -K (by s7150 or   *
+*           s7150q), e.g. of several runs, and shows    *
+*           the quantiles of all of them together.      *
+* Input:    - names of digest files, NULL-terminated    *
+*           - where to save the result, NULL if not     *
+* Return:   0 if OK, else error code                    *
+********************************************************/
+int merge (char *fnames[], const char *tdname)
+{
+static struct s7150_td td;
+FILE    *fp;
+int     i, ok;
+
+s7150_td_init(&td);
+for (i = 0; fnames[i]; i++)
+    {
+    if (NULL == (fp = fopen(fnames[i], "rt")))
+        {
+        fprintf(stderr, "Could not open '%s'.\n", fnames[i]);
+        return ERR_FILE;
+        }
+    ok = s7150_td_load(fp, &td);
+    fclose(fp);
+    if (!ok)
+        {
+        fprintf(stderr, "'%s' is not a digest saved with -K.\n", fnames[i]);
+        return ERR_FILE;
+        }
+    }
+
+printf("# s7150q " VERSION ": %d digests merged\n# n\tmin\tmax", i);
+for (i = 0; i < S7150_TD_NQ; i++)
+    printf("\t%s", s7150_td_qname[i]);
+printf("\n%.0f\t%.7g\t%.7g", td.n, td.min, td.max);
+for (i = 0; i < S7150_TD_NQ; i++)
+    printf("\t%.7g", s7150_td_quantile(&td, s7150_td_q[i]));
+printf("\n");
+
+if (tdname && (NULL == (fp = fopen(tdname, "wt")) || 0 == s7150_td_save(fp, &td) || fclose(fp)))
+    {
+    fprintf(stderr, "Could not write '%s'.\n", tdname);
+    return ERR_FILE;
+    }
+return 0;
+}
+
+
+/********************************************************
+* bucket_add: Adds a reading to the statistics, and     *
+*           prints them when the bucket is complete.    *
+* Input:    - bucket                                    *
+*           - the query                                 *
+*           - time in min, reading (NULL if undecodable)*
+* Return:   nothing                                     *
+********************************************************/
+void bucket_add (struct bucket *b, const struct query *q, double t, \
+                 const struct s7150_reading *r)
+{
+long    i;
+double  v, d;
+
+/* following without buckets: every reading on its own */
+if (q->follow && q->width == 0.0)
+    {
+    memset (b, 0, sizeof(*b));
+    b->i = 0;
+    b->t = t;
+    if (q->btd)
+        s7150_td_init(q->btd);
+    if (r && r->eflag == EF_OK)
+        {
+        b->n = 1;
+        b->mean = b->min = b->max = s7150_value(r);
+        if (q->btd)
+            s7150_td_add(q->btd, b->mean, 1.0);
+        if (q->all)
+            s7150_td_add(q->all, b->mean, 1.0);
+        }
+    else
+        b->nbad = 1;
+    bucket_print(b, q);
+    b->i = -1;
+    return;
+    }
+
+i = (q->width > 0.0) ? (long) floor((t - q->from) / q->width) : 0;
+if (i != b->i)
+    {
+    if (b->i >= 0)
+        bucket_print(b, q);
+    memset (b, 0, sizeof(*b));
+    b->i = i;
+    b->t = q->from + i * q->width;
+    if (q->btd)
+        s7150_td_init(q->btd);
+    }
+
+if (r == NULL || r->eflag != EF_OK)
+    {
+    b->nbad++;
+    return;
+    }
+v = s7150_value(r);
+if (b->n == 0 || v < b->min)
+    b->min = v;
+if (b->n == 0 || v > b->max)
+    b->max = v;
+/* Welford: stable in one pass */
+b->n++;
+d = v - b->mean;
+b->mean += d / b->n;
+b->m2 += d * (v - b->mean);
+if (q->btd)
+    s7150_td_add(q->btd, v, 1.0);
+if (q->all)
+    s7150_td_add(q->all, v, 1.0);
+}
+
+
+/********************************************************
+* bucket_print: One line of output per bucket.          *
+* Input:    - bucket                                    *
+*           - the query                                 *
+* Return:   nothing                                     *
+********************************************************/
+void bucket_print (const struct bucket *b, const struct query *q)
+{
+char    clock[32] = "-";
+double  t = b->t;
+time_t  tt;
+int     i;
+
+if (q->t0 > 0.0)
+    {
+    tt = (time_t) floor(q->t0 + 60.0 * t);
+    strftime(clock, sizeof(clock), "%Y-%m-%d %H:%M:%S", localtime(&tt));
+    }
+if (b->n)
+    printf("%.4f\t%s\t%lu\t%.7g\t%.7g\t%.7g\t%.7g\t%lu", t, clock, b->n, b->mean,
+           b->min, b->max, b->n > 1 ? sqrt(b->m2 / (b->n - 1)) : 0.0, b->nbad);
+else
+    printf("%.4f\t%s\t0\t\t\t\t\t%lu", t, clock, b->nbad);
+for (i = 0; q->btd && i < S7150_TD_NQ; i++)
+    if (b->n)
+        printf("\t%.7g", s7150_td_quantile(q->btd, s7150_td_q[i]));
+    else
+        printf("\t");
+printf("\n");
+}
+
+
+/********************************************************
+* parsetime: Converts a time given on the command line.  *
+* Input:    - text: minutes since start, HH:MM[:SS] on  *
+*             the first day, N/HH:MM[:SS] on day N, or  *
+*             YYYY-MM-DD HH:MM[:SS]                     *
+*           - acquisition start (Epoch), 0 if unknown   *
+*           - ptr to result, in min since start         *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+int parsetime (const char *s, double t0, double *tmin)
+{
+struct  tm tm;
+time_t  tt;
+int     day = 1, y, mo, d, h, mi;
+double  sec = 0.0;
+
+if (NULL == strchr(s, ':'))
+    return 1 == sscanf(s, "%lf", tmin);
+if (t0 <= 0.0)
+    return 0;
+
+tt = (time_t) t0;
+localtime_r(&tt, &tm);
+if (sscanf(s, "%d-%d-%d%*[ T]%d:%d:%lf", &y, &mo, &d, &h, &mi, &sec) >= 5)
+    {
+    tm.tm_year = y - 1900;
+    tm.tm_mon = mo - 1;
+    tm.tm_mday = d;
+    }
+else if (sscanf(s, "%d/%d:%d:%lf", &day, &h, &mi, &sec) >= 3 || \
+         (day = 1, sscanf(s, "%d:%d:%lf", &h, &mi, &sec) >= 2))
+    tm.tm_mday += day - 1;
+else
+    return 0;
+tm.tm_hour = h;
+tm.tm_min = mi;
+tm.tm_sec = 0;
+tm.tm_isdst = -1;
+*tmin = (mktime(&tm) + sec - t0) / 60.0;
+return 1;
+}
+
+
+/********************************************************
+* TIMEINFO: Returns actual time elapsed since The Epoch *
+* Input:    Nothing.                                    *
+* Return:   time in microseconds                        *
+* Note:     #include <time.h>                           *
+*           #include <sys/time.h>                       *
+********************************************************/
+double timeinfo (void)
+{
+struct timeval t;
+
+gettimeofday(&t, NULL);
+return (double)t.tv_sec + (double)t.tv_usec/1000000.0;
+}
+
+
+/***************************************************************************
+* GETOPT: Command line parser, system V style.
+*
+*  Widely (and wildly) adapted from code published by Borland Intl. Inc.
+*
+*  Note that libc has a function getopt(), however this is not guaranteed
+*  to be available for other compilers. Therefore we provide *this* function
+*  (which does the same).
+*
+*  Standard option syntax is:
+*
+*    option ::= SW [optLetter]* [argLetter space* argument]
+*
+*  where
+*    - SW is '-'
+*    - there is no space before any optLetter or argLetter.
+*    - opt/arg letters are alphabetic, not punctuation characters.
+*    - optLetters, if present, must be matched in optionS.
+*    - argLetters, if present, are found in optionS followed by ':'.
+*    - argument is any white-space delimited string.  Note that it
+*      can include the SW character.
+*    - upper and lower case letters are distinct.
+*
+*  There may be multiple option clusters on a command line, each
+*  beginning with a SW, but all must appear before any non-option
+*  arguments (arguments not introduced by SW).  Opt/arg letters may
+*  be repeated: it is up to the caller to decide if that is an error.
+*
+*  The character SW appearing alone is not an option but an argument
+*  (as in "-" for stdout), and terminates getOpt.
+*  The lead-in sequence SWSW ("--") causes itself and all the rest
+*  of the line to be ignored (allowing non-options which begin
+*  with the switch char).
+*
+*  The string *optionS allows valid opt/arg letters to be recognized.
+*  argLetters are followed with ':'.  Getopt () returns the value of
+*  the option character found, or EOF if no more options are in the
+*  command line. If option is an argLetter then the global optarg is
+*  set to point to the argument string (having skipped any white-space).
+*
+*  The global optind is initially 1 and is always left as the index
+*  of the next argument of argv[] which getopt has not taken.  Note
+*  that if "--" or "//" are used then optind is stepped to the next
+*  argument before getopt() returns EOF.
+*
+*  If an error occurs, that is an SW char precedes an unknown letter,
+*  then getopt() will return a '~' character and normally prints an
+*  error message via perror().  If the global variable opterr is set
+*  to false (zero) before calling getopt() then the error message is
+*  not printed.
+*
+*  For example, if
+*
+*    *optionS == "A:F:PuU:wXZ:"
+*
+*  then 'P', 'u', 'w', and 'X' are option letters and 'A', 'F',
+*  'U', 'Z' are followed by arguments. A valid command line may be:
+*
+*    aCommand  -uPFPi -X -A L someFile
+*
+*  where:
+*    - 'u' and 'P' will be returned as isolated option letters.
+*    - 'F' will return with "Pi" as its argument string.
+*    - 'X' is an isolated option.
+*    - 'A' will return with "L" as its argument.
+*    - "someFile" is not an option, and terminates getOpt.  The
+*      caller may collect remaining arguments using argv pointers.
+***************************************************************************/
+int GetOpt (int argc, char *argv[], char *optionS)
+{
+   static char *letP = NULL;    /* remember next option char's location */
+   static char SW = '-';    /* switch character */
+
+   int opterr = 1;      /* allow error message        */
+   unsigned char ch;
+   char *optP;
+
+   if (argc > optind)
+   {
+      if (letP == NULL)
+      {
+     if ((letP = argv[optind]) == NULL || *(letP++) != SW || *letP == 0)
+        goto gopEOF;
+
+     if (*letP == SW)
+     {
+        optind++;
+        goto gopEOF;
+     }
+      }
+      if (0 == (ch = *(letP++)))
+      {
+     optind++;
+     goto gopEOF;
+      }
+      if (':' == ch || (optP = strchr (optionS, ch)) == NULL)
+     goto gopError;
+      if (':' == *(++optP))
+      {
+     optind++;
+     if (0 == *letP)
+     {
+        if (argc <= optind)
+           goto gopError;
+        letP = argv[optind++];
+     }
+     optarg = letP;
+     letP = NULL;
+      }
+      else
+      {
+     if (0 == *letP)
+     {
+        optind++;
+        letP = NULL;
+     }
+     optarg = NULL;
+      }
+      return ch;
+   }
+
+ gopEOF:
+   optarg = letP = NULL;
+   return EOF;
+
+ gopError:
+   optarg = NULL;
+   errno = EINVAL;
+   if (opterr)
+      perror ("\nCommand line option");
+   return ('~');
+}
+
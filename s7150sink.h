@@ -0,0 +1,99 @@
+/* vi:set syntax=c expandtab tabstop=4 shiftwidth=4:
+
+ S 7 1 5 0 S I N K . H
+
+ Interface for output plugins ("sinks") of s7150.
+
+ Copyright (c) 2004...2025 by Joerg Hau.
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2 as
+ published by the Free Software Foundation, provided that the copyright
+ notice remains intact even in future versions. See the file LICENSE
+ for details.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ --------------------------------------------------------------------
+
+ Modification/history:
+
+ 2026-10-18     creation
+
+ A sink is a shared library, loaded at runtime with s7150 -P lib.so[:arg].
+ It exports one symbol, S7150_SINK_SYMBOL, of type struct s7150_sinkops.
+ All functions are called from the writer thread of s7150, never from
+ the acquisition loop, so a slow sink does not hold up the instrument.
+ Samples are handed over in batches (pointer + count); the batch is only
+ valid during the call.
+
+ Each sample is decoded and formatted once, by s7150, for all sinks:
+ a sink that writes text like the main data file just copies 'line'.
+ A sink that keeps failing (a number of write calls in a row) is
+ switched off for the rest of the run; the others carry on.
+
+ All functions return 1 if OK, 0 if error (as everywhere in s7150).
+ Compile a sink with something like:
+
+ gcc -Wall -O2 -shared -fPIC -o sink_tsv.so sink_tsv.c
+
+*/
+
+#ifndef S7150SINK_H
+#define S7150SINK_H
+
+#include <stddef.h>
+#include "s7150fmt.h"
+
+#define S7150_SINK_ABI    2
+#define S7150_SINK_SYMBOL "s7150_sink"
+#define S7150_LINELEN    64     /* room for a line of the text data file */
+
+/* one reading, decoded once and shared by all sinks */
+struct s7150_sample
+    {
+    struct s7150_rec rec;   /* exact reading and time, see s7150fmt.h;
+                               with s7150 -O, the mean with all its digits */
+    double  value;          /* same as double; NaN if not decodable */
+    char    text[S7150_LEN+1];  /* reading as received, without CR */
+    int     linelen;        /* the sample as line of the text data file */
+    char    line[S7150_LINELEN];    /* ("min<TAB>reading[<TAB>mean<TAB>stderr]\n") */
+    };
+
+/* what a sink gets to know about the acquisition */
+struct s7150_runinfo
+    {
+    int     abi;            /* S7150_SINK_ABI */
+    const char *program;    /* program name and version */
+    const char *datafile;   /* main data file */
+    const char *comment;    /* comment text (-c) */
+    int     pad;            /* GPIB address */
+    int     mode;           /* measurement mode (-m) */
+    int     delay;          /* sampling interval in 0.1 s (-t) */
+    double  t0;             /* acquisition start (Epoch) */
+    double  t1;             /* acquisition stop (Epoch), 0 while running */
+    };
+
+struct s7150_sinkops
+    {
+    int     abi;            /* must be S7150_SINK_ABI */
+    const char *name;       /* short name, for messages and statistics */
+
+    /* called once before the acquisition; 'arg' is whatever followed
+       the ':' on the command line (or ""), '*ctx' is for the sink */
+    int     (*init)  (const char *arg, const struct s7150_runinfo *run, void **ctx);
+
+    /* n samples, oldest first */
+    int     (*write) (void *ctx, const struct s7150_sample *s, size_t n);
+
+    /* called every -w samples; may be NULL */
+    int     (*flush) (void *ctx);
+
+    /* called once after the acquisition; run->t1 is set */
+    int     (*close) (void *ctx, const struct s7150_runinfo *run);
+    };
+
+#endif
@@ -0,0 +1,846 @@
+/* vi:set syntax=c expandtab tabstop=4 shiftwidth=4:
+
+ S 7 1 5 0 S U P . C
+
+ Supervisor for several s7150 acquisition processes, one per instrument,
+ merging their data into one file.
+
+ Copyright (c) 2004...2025 by Joerg Hau.
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2 as
+ published by the Free Software Foundation, provided that the copyright
+ notice remains intact even in future versions. See the file LICENSE
+ for details.
+
+ If you use this program (or any part of it) in another application,
+ note that the resulting application becomes also GPL. In other
+ words, GPL is a "contaminating" license.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ --------------------------------------------------------------------
+
+ Modification/history (adapt VERSION below when changing!):
+
+ 2026-10-18     creation
+
+ This should compile with any C compiler, something like:
+
+ gcc -Wall -O2 -o s7150sup s7150sup.c
+
+ Each worker is an ordinary s7150 process writing its data into a
+ pipe (data file '-'). The supervisor merges the samples of all
+ workers by time, restarts workers that crashed (with the remaining
+ acquisition time, so the schedule is kept), and reports CPU time,
+ lag and restarts per worker.
+
+*/
+
+#define VERSION "V20261018"     /* String! */
+
+//#define DEBUG             /* diagnostic mode, for development only */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <errno.h>          /* command line reading */
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>        /* kbhit() */
+#include <sys/time.h>       /* clock timing */
+#include <sys/wait.h>
+
+#define MAXLEN   90         /* text buffers etc */
+#define MAXWORK  16         /* max. number of workers */
+#define MAXARG   32         /* max. number of options per worker */
+#define QLEN    256         /* samples waiting per worker */
+#define ESC      27
+#define S7150    "s7150"    /* worker executable */
+
+#define ERR_FILE  4         /* error code */
+#define ERR_INST  5         /* error code */
+
+/* --- stuff for reading the command line --- */
+
+char *optarg;               /* global: pointer to argument of current option */
+int optind = 1;             /* global: index of which argument is next. Is used
+                            as a global variable for collection of further
+                            arguments (= not options) via argv pointers */
+
+/* --- stuff for kbhit() ---- */
+
+static  struct termios initial_settings, new_settings;
+static  int peek_character = -1;
+
+void    init_keyboard(void);
+void    close_keyboard(void);
+int     kbhit(void);
+int     readch(void);
+
+/* --- miscellaneous function prototypes ---- */
+
+double  timeinfo (void);
+int     GetOpt (int argc, char *argv[], char *optionS);
+
+/* --- one acquisition process ---- */
+
+struct worker
+    {
+    char    spec[4*MAXLEN]; /* s7150 options as given on the command line */
+    pid_t   pid;            /* process id, 0 if not running */
+    int     fd;             /* read end of its data pipe, -1 if none */
+    int     done;           /* finished, don't restart */
+    char    line[4*MAXLEN]; /* incomplete line read so far */
+    int     nline;
+    int     pad;            /* from the data header */
+    double  t0;             /* start of the current run (Epoch) */
+    double  dt;             /* sampling interval, in s */
+    char    q[QLEN][MAXLEN];    /* samples waiting to be merged ... */
+    double  qt[QLEN];       /* ... and their times (Epoch) */
+    int     qhead, qn;
+    double  tsamp;          /* time of the last sample received */
+    double  trecv;          /* when we last heard from it */
+    unsigned long nsamp;    /* samples received */
+    unsigned long nrestart; /* times it had to be restarted */
+    unsigned long nforced;  /* samples merged without waiting for others */
+    long    ticks, ticks0;  /* CPU time (clock ticks): now, at last report */
+    };
+
+static struct worker work[MAXWORK];
+static int nwork = 0;
+static volatile sig_atomic_t got_signal = 0;
+
+static FILE *outfile;       /* merged data */
+static double tstart;       /* start of acquisition (Epoch) */
+static double maxlag = 10.0;    /* max. time to wait for a lagging worker */
+
+int     worker_start (struct worker *w, const char *s7150, const char *logname, \
+                      const float tleft);
+void    worker_input (struct worker *w);
+void    worker_line (struct worker *w, char *line);
+long    worker_cpu (const struct worker *w);
+int     merge (const int force);
+void    report (FILE *fp, const double dt);
+void    on_signal (int sig);
+
+
+/********************************************************
+* main:       main program loop.                        *
+* Input:      see below.                                *
+* Return:     0 if OK, else error code                  *
+********************************************************/
+int main (int argc, char *argv[])
+{
+static char *disclaimer =
+"\ns7150sup - Supervisor for several s7150 acquisitions. " VERSION ".\n"
+"Copyright (C) 2004...2025 by Joerg Hau.\n\n"
+"This program is free software; you can redistribute it and/or modify it under\n"
+"the terms of the GNU General Public License, version 2, as published by the\n"
+"Free Software Foundation.\n\n"
+"This program is distributed in the hope that it will be useful, but WITHOUT ANY\n"
+"WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A\n"
+"PARTICULAR PURPOSE. See the GNU General Public License for details.\n";
+
+static char *msg = "\nSyntax: s7150sup [-h] [-s /path/to/s7150] [-T timeout] [-r max] [-i sec] [-l sec] [-f] datafile \"options\" [\"options\" ...]"
+"\n        -h       this help screen"
+"\n        -s       specify path/to/s7150 (if not in your current PATH)"
+"\n        -T min   stop acquisition after this time (in minutes; default 0 = endless)"
+"\n        -r max   restart a crashed worker at most 'max' times (default is 10)"
+"\n        -i sec   report worker statistics every 'sec' seconds (default is 60)"
+"\n        -l sec   don't wait longer than 'sec' for a lagging worker (default is 10)"
+"\n        -f       force overwriting of existing file"
+"\n        datafile file for the merged data"
+"\n        options  s7150 options for one worker, e.g. \"-a 16 -m 0 -t 10\""
+"\n                 (one string per instrument; no data file, no quotes inside)\n\n";
+
+char    filename[MAXLEN], s7150[MAXLEN], logname[MAXLEN+8];
+char    do_overwrite = 0, stopping = 0;
+int     i, key, status, maxrestart = 10;
+float   tstop = 0.0, tleft, tmp;
+double  tnow, treport, dtreport = 60.0;
+pid_t   pid;
+time_t  t;
+struct  pollfd pfd[MAXWORK];
+struct  worker *w;
+
+sprintf (s7150, "%s", S7150);
+
+fprintf (stderr, disclaimer);
+
+/* --- decode and read the command line --- */
+
+while ((key = GetOpt(argc, argv, "hfs:T:r:i:l:")) != EOF)
+    switch (key)
+        {
+        case 'h':                    /* help me */
+            fprintf (stderr, msg);
+            return 0;
+        case 'f':                    /* force overwriting of existing file */
+            do_overwrite = 1;
+            continue;
+        case 's':
+            sscanf (optarg, "%80s", s7150);
+            continue;
+        case 'T':
+            sscanf (optarg, "%g", &tstop);
+            if (tstop < 0.0)
+                {
+                puts("Error: timeout must be positive.");
+                return 1;
+                }
+            continue;
+        case 'r':
+            sscanf (optarg, "%5d", &maxrestart);
+            continue;
+        case 'i':
+            sscanf (optarg, "%g", &tmp);
+            dtreport = (tmp > 0.0) ? tmp : 60.0;
+            continue;
+        case 'l':
+            sscanf (optarg, "%g", &tmp);
+            maxlag = (tmp > 0.0) ? tmp : 10.0;
+            continue;
+        case '~':                    /* invalid arg */
+        default:
+        fprintf (stderr, "'%s -h' for help.\n\n", argv[0]);
+            return 1;
+        }
+
+if (argv[optind] == NULL || argv[optind+1] == NULL)
+    {
+    fprintf (stderr, msg);
+    fprintf (stderr, "Please specify a data file and at least one worker.\n");
+    return 1;
+    }
+
+strcpy (filename, argv[optind++]);
+for (; argv[optind] != NULL; optind++)
+    {
+    if (nwork == MAXWORK)
+        {
+        fprintf (stderr, "Error: at most %d workers.\n", MAXWORK);
+        return 1;
+        }
+    strncpy (work[nwork].spec, argv[optind], sizeof(work[nwork].spec)-1);
+    work[nwork].fd = -1;
+    nwork++;
+    }
+
+/* --- prepare output data file --- */
+
+if ((!access(filename, 0)) && (!do_overwrite))
+    {
+    fprintf (stderr, "\a\nFile '%s' exists - Overwrite? [Y/*] ", filename);
+    key = fgetc(stdin);
+    if (key != 'Y' && key != 'y')
+        return 1;
+    }
+if (NULL == (outfile = fopen(filename, "wt")))
+    {
+    fprintf(stderr, "Could not open '%s' for writing.\n", filename);
+    return ERR_FILE;
+    }
+
+/* --- start the workers; their terminal output goes to a log file --- */
+
+init_keyboard();
+signal(SIGTERM, on_signal);
+signal(SIGINT, on_signal);
+signal(SIGPIPE, SIG_IGN);
+
+tstart = treport = timeinfo();
+time(&t);
+fprintf(outfile, "# s7150sup " VERSION "\n");
+fprintf(outfile, "# Acquisition start: %s", ctime(&t));
+for (i = 0; i < nwork; i++)
+    {
+    fprintf(outfile, "# worker %d: %s\n", i, work[i].spec);
+    sprintf(logname, "%s.%d.log", filename, i);
+    if (0 == worker_start(&work[i], s7150, logname, tstop))
+        {
+        fprintf(stderr, "Quit.\n");
+        close_keyboard();
+        return ERR_INST;
+        }
+    }
+fprintf(outfile, "# min\tpad\treadout  errflag  unit  mode\n");
+
+printf("\n  Output file :  %s", filename);
+printf("\n      Workers :  %d", nwork);
+if (tstop > 0.0)
+    printf("\n   Halt after :  %g min", tstop);
+printf("\n         Stop :  Press 'q' or ESC.\n");
+fflush(stdout);
+
+/* --- main loop: collect, merge, supervise --- */
+
+do  {
+    for (i = 0; i < nwork; i++)
+        {
+        pfd[i].fd = work[i].fd;         /* poll() ignores fd < 0 */
+        pfd[i].events = POLLIN;
+        pfd[i].revents = 0;
+        }
+    poll(pfd, nwork, 100);
+    for (i = 0; i < nwork; i++)
+        if (pfd[i].revents)
+            worker_input(&work[i]);
+
+    /* reap workers; restart the ones that did not finish properly */
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+        for (w = work; w < work + nwork; w++)
+            {
+            if (w->pid != pid)
+                continue;
+            w->pid = 0;
+            while (w->fd >= 0)          /* get whatever is left */
+                worker_input(w);
+            tnow = timeinfo();
+            tleft = tstop - (tnow - tstart) / 60.0;
+            if (stopping || (WIFEXITED(status) && WEXITSTATUS(status) == 0) || \
+                (tstop > 0.0 && tleft <= 0.0))
+                w->done = 1;
+            else if (WIFEXITED(status) && WEXITSTATUS(status) == 1)
+                {
+                fprintf(stderr, "\nWorker %d: command line error, see log.\n", (int)(w - work));
+                w->done = 1;
+                }
+            else if (w->nrestart >= maxrestart)
+                {
+                fprintf(stderr, "\nWorker %d: too many restarts, giving up.\n", (int)(w - work));
+                w->done = 1;
+                }
+            else
+                {
+                w->nrestart++;
+                fprintf(stderr, "\nWorker %d died (status 0x%x), restart #%lu.\n",
+                        (int)(w - work), status, w->nrestart);
+                sprintf(logname, "%s.%d.log", filename, (int)(w - work));
+                if (0 == worker_start(w, s7150, logname, (tstop > 0.0) ? tleft : 0.0))
+                    w->done = 1;
+                }
+            }
+
+    merge(0);
+
+    tnow = timeinfo();
+    if (tnow - treport >= dtreport)
+        {
+        fprintf(outfile, "# %.4f min:\n", (tnow - tstart) / 60.0);
+        report(outfile, tnow - treport);
+        fflush(outfile);
+        report(stdout, tnow - treport);
+        treport = tnow;
+        }
+
+    /* stop: keyboard, signal or timeout; the workers finish by themselves */
+    if (kbhit())
+        {
+        key = readch();
+        if (key == 'q' || key == ESC)
+            got_signal = 1;
+        }
+    if (got_signal && !stopping)
+        {
+        stopping = 1;
+        for (i = 0; i < nwork; i++)
+            if (work[i].pid)
+                kill(work[i].pid, SIGTERM);
+        }
+
+    for (i = 0; i < nwork; i++)
+        if (!work[i].done)
+            break;
+    }
+    while (i < nwork);
+
+/* all done: flush what's left, in order */
+while (merge(1))
+    ;
+time(&t);
+tnow = timeinfo();
+fprintf(outfile, "# %.4f min:\n", (tnow - tstart) / 60.0);
+report(outfile, tnow - treport);
+fprintf(outfile, "# Acquisition stop: %s\n", ctime(&t));
+fclose (outfile);
+report(stdout, tnow - treport);
+
+close_keyboard();
+printf("\n");
+return 0;
+}
+
+
+/********************************************************
+* worker_start: Launches an s7150 process.              *
+* Input:    - worker                                    *
+*           - s7150 executable, log file for its output *
+*           - remaining acquisition time in min, 0=none *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+int worker_start (struct worker *w, const char *s7150, const char *logname, \
+                  const float tleft)
+{
+char    spec[4*MAXLEN], tbuf[20], *args[MAXARG+10], *p;
+int     n = 0, fds[2], log;
+
+/* options as given, then ours: no graph, flush every line, stdout */
+strcpy(spec, w->spec);
+args[n++] = (char *) s7150;
+for (p = strtok(spec, " \t"); p && n < MAXARG; p = strtok(NULL, " \t"))
+    args[n++] = p;
+args[n++] = "-n";
+args[n++] = "-w";
+args[n++] = "1";
+if (tleft > 0.0)
+    {
+    sprintf(tbuf, "%g", tleft);
+    args[n++] = "-T";
+    args[n++] = tbuf;
+    }
+args[n++] = "-";
+args[n] = NULL;
+
+if (pipe(fds) < 0 || (log = open(logname, O_WRONLY | O_CREAT | O_APPEND, 0644)) < 0)
+    {
+    fprintf(stderr, "Could not create pipe or log file '%s'.\n", logname);
+    return 0;
+    }
+
+w->pid = fork();
+if (w->pid < 0)
+    {
+    fprintf(stderr, "Could not start worker '%s'.\n", w->spec);
+    w->pid = 0;
+    return 0;
+    }
+if (w->pid == 0)        /* child: stdin from nowhere, stdout into pipe */
+    {
+    close(fds[0]);
+    dup2(fds[1], STDOUT_FILENO);
+    dup2(log, STDERR_FILENO);
+    close(fds[1]);
+    close(log);
+    close(STDIN_FILENO);
+    open("/dev/null", O_RDONLY);
+    execvp(s7150, args);
+    fprintf(stderr, "Could not execute '%s'.\n", s7150);
+    _exit(127);
+    }
+
+close(fds[1]);
+close(log);
+w->fd = fds[0];
+w->nline = 0;
+w->trecv = timeinfo();
+w->ticks = w->ticks0 = 0;
+return 1;
+}
+
+
+/********************************************************
+* worker_input: Reads what a worker has sent and splits *
+*           it into lines.                              *
+* Input:    worker                                      *
+* Return:   nothing (fd is closed at end of file)       *
+********************************************************/
+void worker_input (struct worker *w)
+{
+char    buf[4096];
+int     i, n;
+
+n = read(w->fd, buf, sizeof(buf));
+if (n <= 0)
+    {
+    if (n < 0 && errno == EINTR)
+        return;
+    close(w->fd);
+    w->fd = -1;
+    return;
+    }
+w->trecv = timeinfo();
+for (i = 0; i < n; i++)
+    {
+    if (buf[i] == '\n')
+        {
+        w->line[w->nline] = 0;
+        worker_line(w, w->line);
+        w->nline = 0;
+        }
+    else if (w->nline < sizeof(w->line) - 1)
+        w->line[w->nline++] = buf[i];
+    }
+}
+
+
+/********************************************************
+* worker_line: Handles one line of s7150 output: header *
+*           info, or a sample to be queued for merging. *
+* Input:    worker, line                                *
+* Return:   nothing                                     *
+********************************************************/
+void worker_line (struct worker *w, char *line)
+{
+double  tmin;
+char    *p;
+int     k;
+
+if (line[0] == '#')
+    {
+    if ((p = strstr(line, "pad=")))
+        sscanf(p, "pad=%d mode=%*d dt=%lf t0=%lf", &w->pad, &w->dt, &w->t0);
+    return;
+    }
+if (w->t0 == 0.0 || 1 != sscanf(line, "%lf", &tmin) || NULL == (p = strchr(line, '\t')))
+    return;
+
+/* no room: don't wait for the others any longer */
+while (w->qn == QLEN)
+    merge(1);
+k = (w->qhead + w->qn) % QLEN;
+strncpy(w->q[k], p + 1, MAXLEN-1);
+w->q[k][MAXLEN-1] = 0;
+w->qt[k] = w->t0 + 60.0 * tmin;
+w->qn++;
+w->tsamp = w->qt[k];
+w->nsamp++;
+}
+
+
+/********************************************************
+* merge:    Writes the oldest waiting sample(s) of all  *
+*           workers to the data file, in time order.    *
+*           A sample can only go out if no other worker *
+*           can still deliver an older one - unless     *
+*           that worker lags more than 'maxlag'.        *
+* Input:    1 to write the oldest sample in any case    *
+* Return:   number of samples written                   *
+********************************************************/
+int merge (const int force)
+{
+struct  worker *w, *v, *oldest;
+double  tnow;
+int     n = 0, wait;
+
+tnow = timeinfo();
+while (1)
+    {
+    oldest = NULL;
+    for (w = work; w < work + nwork; w++)
+        if (w->qn && (oldest == NULL || w->qt[w->qhead] < oldest->qt[oldest->qhead]))
+            oldest = w;
+    if (oldest == NULL)
+        return n;
+
+    /* a running worker with nothing queued might still send
+       something older: its next sample is due at tsamp + dt */
+    wait = 0;
+    for (v = work; v < work + nwork; v++)
+        if (v != oldest && v->qn == 0 && v->fd >= 0 && \
+            oldest->qt[oldest->qhead] > v->tsamp + v->dt && \
+            tnow - v->trecv < maxlag)
+            wait = 1;
+    if (wait && !(force && n == 0))
+        return n;
+    if (wait)
+        oldest->nforced++;
+
+    fprintf(outfile, "%.4f\t%d\t%s\n", (oldest->qt[oldest->qhead] - tstart) / 60.0, \
+            oldest->pad, oldest->q[oldest->qhead]);
+    oldest->qhead = (oldest->qhead + 1) % QLEN;
+    oldest->qn--;
+    n++;
+    if (force)
+        return n;
+    }
+}
+
+
+/********************************************************
+* worker_cpu: CPU time used by a worker so far.         *
+* Input:    worker                                      *
+* Return:   user + system time in clock ticks, -1 if    *
+*           not running (or no /proc)                   *
+********************************************************/
+long worker_cpu (const struct worker *w)
+{
+FILE    *fp;
+char    buf[512], *p;
+long    utime, stime;
+
+if (w->pid == 0)
+    return -1;
+sprintf(buf, "/proc/%d/stat", (int) w->pid);
+if (NULL == (fp = fopen(buf, "rt")))
+    return -1;
+p = fgets(buf, sizeof(buf), fp);
+fclose(fp);
+
+/* fields 14 and 15; skip the command name, which may contain blanks */
+if (p == NULL || NULL == (p = strrchr(buf, ')')) || \
+    2 != sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %ld %ld", &utime, &stime))
+    return -1;
+return utime + stime;
+}
+
+
+/********************************************************
+* report:   Shows samples, restarts, CPU load and lag   *
+*           of each worker.                             *
+* Input:    - where to print it                         *
+*           - time since last report (for CPU load)     *
+* Return:   nothing                                     *
+********************************************************/
+void report (FILE *fp, const double dt)
+{
+struct  worker *w;
+double  tnow, cpu;
+long    ticks;
+
+tnow = timeinfo();
+fprintf(fp, "#  worker  pad   samples  restarts  forced   CPU %%    lag s  state\n");
+for (w = work; w < work + nwork; w++)
+    {
+    ticks = worker_cpu(w);
+    cpu = 0.0;
+    if (ticks >= 0)
+        {
+        if (w->ticks0 > 0 && dt > 0.0)
+            cpu = 100.0 * (ticks - w->ticks0) / sysconf(_SC_CLK_TCK) / dt;
+        w->ticks0 = ticks;
+        }
+    fprintf(fp, "#  %6d %4d %9lu %9lu %7lu %7.2f %8.1f  %s\n", (int)(w - work), w->pad,
+            w->nsamp, w->nrestart, w->nforced, cpu, w->nsamp ? tnow - w->tsamp : 0.0,
+            w->pid ? "running" : (w->done ? "done" : "stopped"));
+    }
+fflush(fp);
+}
+
+
+/********************************************************
+* on_signal: Signal handler, stops the acquisition.     *
+* Input:    signal number                               *
+* Return:   nothing                                     *
+********************************************************/
+void on_signal (int sig)
+{
+got_signal = sig;
+}
+
+
+/********************************************************
+* TIMEINFO: Returns actual time elapsed since The Epoch *
+* Input:    Nothing.                                    *
+* Return:   time in microseconds                        *
+* Note:     #include <time.h>                           *
+*           #include <sys/time.h>                       *
+********************************************************/
+double timeinfo (void)
+{
+struct timeval t;
+
+gettimeofday(&t, NULL);
+return (double)t.tv_sec + (double)t.tv_usec/1000000.0;
+}
+
+
+/********************************************************
+* KBHIT: provides the functionality of DOS's kbhit()    *
+* found at http://linux-sxs.org/programming/kbhit.html  *
+* Input:    Nothing.                                    *
+* Return:   time in microseconds                        *
+* Note:     #include <termios.h>                        *
+********************************************************/
+void init_keyboard (void)
+{
+tcgetattr( 0, &initial_settings );
+new_settings = initial_settings;
+new_settings.c_lflag &= ~ICANON;
+new_settings.c_lflag &= ~ECHO;
+new_settings.c_lflag &= ~ISIG;
+new_settings.c_cc[VMIN] = 1;
+new_settings.c_cc[VTIME] = 0;
+tcsetattr( 0, TCSANOW, &new_settings );
+}
+
+void close_keyboard(void)
+{
+tcsetattr( 0, TCSANOW, &initial_settings );
+}
+
+int kbhit (void)
+{
+char ch;
+int nread;
+
+if( peek_character != -1 )
+    return( 1 );
+new_settings.c_cc[VMIN] = 0;
+tcsetattr( 0, TCSANOW, &new_settings );
+nread = read( 0, &ch, 1 );
+new_settings.c_cc[VMIN] = 1;
+tcsetattr( 0, TCSANOW, &new_settings );
+if( nread == 1 )
+    {
+    peek_character = ch;
+    return (1);
+    }
+return (0);
+}
+
+int readch (void)
+{
+char ch;
+
+if( peek_character != -1 )
+    {
+    ch = peek_character;
+    peek_character = -1;
+    return( ch );
+    }
+/* else */
+read( 0, &ch, 1 );
+return( ch );
+}
+
+
+/***************************************************************************
+* GETOPT: Command line parser, system V style.
+*
+*  Widely (and wildly) adapted from code published by Borland Intl. Inc.
+*
+*  Note that libc has a function getopt(), however this is not guaranteed
+*  to be available for other compilers. Therefore we provide *this* function
+*  (which does the same).
+*
+*  Standard option syntax is:
+*
+*    option ::= SW [optLetter]* [argLetter space* argument]
+*
+*  where
+*    - SW is '-'
+*    - there is no space before any optLetter or argLetter.
+*    - opt/arg letters are alphabetic, not punctuation characters.
+*    - optLetters, if present, must be matched in optionS.
+*    - argLetters, if present, are found in optionS followed by ':'.
+*    - argument is any white-space delimited string.  Note that it
+*      can include the SW character.
+*    - upper and lower case letters are distinct.
+*
+*  There may be multiple option clusters on a command line, each
+*  beginning with a SW, but all must appear before any non-option
+*  arguments (arguments not introduced by SW).  Opt/arg letters may
+*  be repeated: it is up to the caller to decide if that is an error.
+*
+*  The character SW appearing alone is not an option but an argument
+*  (as in "-" for stdout), and terminates getOpt.
+*  The lead-in sequence SWSW ("--") causes itself and all the rest
+*  of the line to be ignored (allowing non-options which begin
+*  with the switch char).
+*
+*  The string *optionS allows valid opt/arg letters to be recognized.
+*  argLetters are followed with ':'.  Getopt () returns the value of
+*  the option character found, or EOF if no more options are in the
+*  command line. If option is an argLetter then the global optarg is
+*  set to point to the argument string (having skipped any white-space).
+*
+*  The global optind is initially 1 and is always left as the index
+*  of the next argument of argv[] which getopt has not taken.  Note
+*  that if "--" or "//" are used then optind is stepped to the next
+*  argument before getopt() returns EOF.
+*
+*  If an error occurs, that is an SW char precedes an unknown letter,
+*  then getopt() will return a '~' character and normally prints an
+*  error message via perror().  If the global variable opterr is set
+*  to false (zero) before calling getopt() then the error message is
+*  not printed.
+*
+*  For example, if
+*
+*    *optionS == "A:F:PuU:wXZ:"
+*
+*  then 'P', 'u', 'w', and 'X' are option letters and 'A', 'F',
+*  'U', 'Z' are followed by arguments. A valid command line may be:
+*
+*    aCommand  -uPFPi -X -A L someFile
+*
+*  where:
+*    - 'u' and 'P' will be returned as isolated option letters.
+*    - 'F' will return with "Pi" as its argument string.
+*    - 'X' is an isolated option.
+*    - 'A' will return with "L" as its argument.
+*    - "someFile" is not an option, and terminates getOpt.  The
+*      caller may collect remaining arguments using argv pointers.
+***************************************************************************/
+int GetOpt (int argc, char *argv[], char *optionS)
+{
+   static char *letP = NULL;    /* remember next option char's location */
+   static char SW = '-';    /* switch character */
+
+   int opterr = 1;      /* allow error message        */
+   unsigned char ch;
+   char *optP;
+
+   if (argc > optind)
+   {
+      if (letP == NULL)
+      {
+     if ((letP = argv[optind]) == NULL || *(letP++) != SW || *letP == 0)
+        goto gopEOF;
+
+     if (*letP == SW)
+     {
+        optind++;
+        goto gopEOF;
+     }
+      }
+      if (0 == (ch = *(letP++)))
+      {
+     optind++;
+     goto gopEOF;
+      }
+      if (':' == ch || (optP = strchr (optionS, ch)) == NULL)
+     goto gopError;
+      if (':' == *(++optP))
+      {
+     optind++;
+     if (0 == *letP)
+     {
+        if (argc <= optind)
+           goto gopError;
+        letP = argv[optind++];
+     }
+     optarg = letP;
+     letP = NULL;
+      }
+      else
+      {
+     if (0 == *letP)
+     {
+        optind++;
+        letP = NULL;
+     }
+     optarg = NULL;
+      }
+      return ch;
+   }
+
+ gopEOF:
+   optarg = letP = NULL;
+   return EOF;
+
+ gopError:
+   optarg = NULL;
+   errno = EINVAL;
+   if (opterr)
+      perror ("\nCommand line option");
+   return ('~');
+}
+
@@ -0,0 +1,327 @@
+/* vi:set syntax=c expandtab tabstop=4 shiftwidth=4:
+
+ S 7 1 5 0 T D . H
+
+ Quantiles of the readings without keeping them: a t-digest, in fixed
+ memory, that can be merged with others (segments, runs, instruments).
+
+ Copyright (c) 2004...2025 by Joerg Hau.
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2 as
+ published by the Free Software Foundation, provided that the copyright
+ notice remains intact even in future versions. See the file LICENSE
+ for details.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ --------------------------------------------------------------------
+
+ Modification/history:
+
+ 2026-10-18     creation
+
+ Like s7150fmt.h, this is #included; there is nothing to compile
+ separately. The digest (Dunning, "Computing extremely accurate
+ quantiles using t-digests") keeps the readings as clusters (centroids:
+ mean and weight). The clusters are small in the tails and large in the
+ middle, so p0.1 and p99.9 come out nearly as exact as the median,
+ which a KLL sketch of the same size cannot do. New readings are
+ collected in a buffer; when it is full, buffer and clusters are
+ sorted and merged in one pass, so a reading costs O(log S7150_TD_BUF)
+ on average. The memory is fixed, about 45 kB per digest. Typical use:
+
+    struct s7150_td td;
+
+    s7150_td_init(&td);
+    ... s7150_td_add(&td, value, 1.0); ...
+    printf("%g\n", s7150_td_quantile(&td, 0.999));
+
+ s7150_td_merge() adds one digest to another; s7150_td_save() and
+ s7150_td_load() keep a digest in a small text file for that.
+
+*/
+
+#ifndef S7150TD_H
+#define S7150TD_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>           /* NAN, asin() */
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define S7150_TD_DELTA  200     /* compression: about this many clusters at most */
+#define S7150_TD_CMAX   (2 * S7150_TD_DELTA)    /* room for clusters ... */
+#define S7150_TD_BUF    (10 * S7150_TD_DELTA)   /* ... and for new readings */
+#define S7150_TD_MAGIC  "# s7150 t-digest"
+
+/* the quantiles shown by the programs */
+#define S7150_TD_NQ  5
+static const double s7150_td_q[S7150_TD_NQ] = { 0.001, 0.01, 0.5, 0.99, 0.999 };
+static const char *s7150_td_qname[S7150_TD_NQ] = { "p0.1", "p1", "p50", "p99", "p99.9" };
+
+struct s7150_td_c
+    {
+    double  mean;
+    double  w;              /* readings in this cluster */
+    };
+
+struct s7150_td
+    {
+    double  n;              /* readings in total ... */
+    double  min, max;       /* ... and their extremes */
+    int     nc;             /* clusters, sorted by mean */
+    int     nb;             /* readings in the buffer, not yet merged */
+    struct  s7150_td_c c[S7150_TD_CMAX];
+    struct  s7150_td_c b[S7150_TD_BUF + S7150_TD_CMAX];    /* sorted with c[] */
+    };
+
+
+static inline void s7150_td_init (struct s7150_td *td)
+{
+td->n = td->min = td->max = 0.0;
+td->nc = td->nb = 0;
+}
+
+
+static inline int s7150_td_cmp (const void *a, const void *b)
+{
+double x = ((const struct s7150_td_c *) a)->mean, y = ((const struct s7150_td_c *) b)->mean;
+
+return (x > y) - (x < y);
+}
+
+
+/* scale function k1 and its inverse: small clusters at both ends */
+static inline double s7150_td_k (double q)
+{
+return S7150_TD_DELTA / (2.0 * M_PI) * asin(2.0 * q - 1.0);
+}
+
+static inline double s7150_td_kinv (double k)
+{
+if (k >= S7150_TD_DELTA / 4.0)
+    return 1.0;
+return (sin(k * 2.0 * M_PI / S7150_TD_DELTA) + 1.0) / 2.0;
+}
+
+
+/********************************************************
+* s7150_td_compress: Merges the buffer into the         *
+*           clusters: all are sorted, and neighbours    *
+*           joined as long as the scale function lets   *
+*           them.                                       *
+* Input:    ptr to digest                               *
+* Return:   nothing                                     *
+********************************************************/
+static inline void s7150_td_compress (struct s7150_td *td)
+{
+struct  s7150_td_c *all = td->b, cur;
+int     i, n;
+double  q0 = 0.0, qlim;
+
+if (td->nb == 0)
+    return;
+memcpy (all + td->nb, td->c, td->nc * sizeof(*all));
+n = td->nb + td->nc;
+qsort(all, n, sizeof(*all), s7150_td_cmp);
+
+td->nc = 0;
+cur = all[0];
+qlim = s7150_td_kinv(s7150_td_k(q0) + 1.0);
+for (i = 1; i < n; i++)
+    {
+    if (q0 + (cur.w + all[i].w) / td->n <= qlim)
+        {
+        cur.w += all[i].w;
+        cur.mean += (all[i].mean - cur.mean) * all[i].w / cur.w;
+        }
+    else
+        {
+        q0 += cur.w / td->n;
+        qlim = s7150_td_kinv(s7150_td_k(q0) + 1.0);
+        td->c[td->nc++] = cur;
+        cur = all[i];
+        }
+    }
+td->c[td->nc++] = cur;
+td->nb = 0;
+}
+
+
+/********************************************************
+* s7150_td_add: Adds a reading (or a cluster).          *
+* Input:    - ptr to digest                             *
+*           - value, weight (1 for a reading)           *
+* Return:   nothing                                     *
+********************************************************/
+static inline void s7150_td_add (struct s7150_td *td, double x, double w)
+{
+if (isnan(x) || w <= 0.0)
+    return;
+if (td->n == 0.0 || x < td->min)
+    td->min = x;
+if (td->n == 0.0 || x > td->max)
+    td->max = x;
+td->n += w;
+td->b[td->nb].mean = x;
+td->b[td->nb++].w = w;
+if (td->nb == S7150_TD_BUF)
+    s7150_td_compress(td);
+}
+
+
+/********************************************************
+* s7150_td_merge: Adds digest 'src' to 'dst'; the       *
+*           result is as if all readings had gone into  *
+*           'dst' (within the accuracy of the digest).  *
+* Input:    ptr to digests                              *
+* Return:   nothing                                     *
+********************************************************/
+static inline void s7150_td_merge (struct s7150_td *dst, struct s7150_td *src)
+{
+int     i;
+double  min = src->min, max = src->max;
+
+if (src->n == 0.0)
+    return;
+s7150_td_compress(src);
+if (dst->n == 0.0 || min < dst->min)
+    dst->min = min;
+if (dst->n == 0.0 || max > dst->max)
+    dst->max = max;
+for (i = 0; i < src->nc; i++)
+    {
+    dst->n += src->c[i].w;
+    dst->b[dst->nb++] = src->c[i];
+    if (dst->nb == S7150_TD_BUF)
+        s7150_td_compress(dst);
+    }
+}
+
+
+/********************************************************
+* s7150_td_quantile: Value below which a fraction q of  *
+*           the readings lies, interpolated between the *
+*           cluster centres (and min and max at the     *
+*           ends).                                      *
+* Input:    - ptr to digest                             *
+*           - q, 0...1                                  *
+* Return:   value, NaN if the digest is empty           *
+********************************************************/
+static inline double s7150_td_quantile (struct s7150_td *td, double q)
+{
+const struct s7150_td_c *c = td->c;
+double  idx, sofar, dw, z1, z2, lu, ru;
+int     i, n;
+
+if (td->n == 0.0)
+    return NAN;
+s7150_td_compress(td);
+n = td->nc;
+if (n == 1)
+    return c[0].mean;
+idx = q * td->n;
+if (idx < 1.0)
+    return td->min;
+if (idx > td->n - 1.0)
+    return td->max;
+
+/* between min and the first centre, and the last centre and max */
+if (c[0].w > 1.0 && idx < c[0].w / 2.0)
+    return td->min + (idx - 1.0) / (c[0].w / 2.0 - 1.0) * (c[0].mean - td->min);
+if (c[n-1].w > 1.0 && td->n - idx <= c[n-1].w / 2.0)
+    return td->max - (td->n - idx - 1.0) / (c[n-1].w / 2.0 - 1.0) * (td->max - c[n-1].mean);
+
+sofar = c[0].w / 2.0;
+for (i = 0; i < n - 1; i++)
+    {
+    dw = (c[i].w + c[i+1].w) / 2.0;
+    if (sofar + dw > idx)
+        {
+        /* a single reading is exactly where it is */
+        lu = ru = 0.0;
+        if (c[i].w == 1.0)
+            {
+            if (idx - sofar < 0.5)
+                return c[i].mean;
+            lu = 0.5;
+            }
+        if (c[i+1].w == 1.0)
+            {
+            if (sofar + dw - idx <= 0.5)
+                return c[i+1].mean;
+            ru = 0.5;
+            }
+        z1 = idx - sofar - lu;
+        z2 = sofar + dw - idx - ru;
+        return (c[i].mean * z2 + c[i+1].mean * z1) / (z1 + z2);
+        }
+    sofar += dw;
+    }
+return c[n-1].mean;
+}
+
+
+/********************************************************
+* s7150_td_save: Writes a digest as text: a header line,*
+*           "n min max", then "mean weight" per cluster.*
+* Input:    - file, open for writing                    *
+*           - ptr to digest                             *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+static inline int s7150_td_save (FILE *fp, struct s7150_td *td)
+{
+int i;
+
+s7150_td_compress(td);
+fprintf(fp, S7150_TD_MAGIC " %d\n%.17g %.17g %.17g\n", S7150_TD_DELTA, td->n, td->min, td->max);
+for (i = 0; i < td->nc; i++)
+    fprintf(fp, "%.17g %.17g\n", td->c[i].mean, td->c[i].w);
+return !ferror(fp);
+}
+
+
+/********************************************************
+* s7150_td_load: Reads a digest written by              *
+*           s7150_td_save() and merges it into 'td'.    *
+* Input:    - file, open for reading                    *
+*           - ptr to digest                             *
+* Return:   1 if OK, 0 if error (not a digest)          *
+********************************************************/
+static inline int s7150_td_load (FILE *fp, struct s7150_td *td)
+{
+char    line[128];
+double  n, min, max, m, w, sum = 0.0;
+int     delta;
+
+if (!fgets(line, sizeof(line), fp) || strncmp(line, S7150_TD_MAGIC, strlen(S7150_TD_MAGIC)) || \
+    1 != sscanf(line + strlen(S7150_TD_MAGIC), "%d", &delta) || \
+    3 != fscanf(fp, "%lf %lf %lf", &n, &min, &max))
+    return 0;
+if (n == 0.0)
+    return 1;
+if (td->n == 0.0 || min < td->min)
+    td->min = min;
+if (td->n == 0.0 || max > td->max)
+    td->max = max;
+while (2 == fscanf(fp, "%lf %lf", &m, &w))
+    {
+    td->n += w;
+    sum += w;
+    td->b[td->nb].mean = m;
+    td->b[td->nb++].w = w;
+    if (td->nb == S7150_TD_BUF)
+        s7150_td_compress(td);
+    }
+return sum == n;
+}
+
+#endif
@@ -0,0 +1,713 @@
+/* vi:set syntax=c expandtab tabstop=4 shiftwidth=4:
+
+ S I N K _ B I N . C
+
+ Output plugin for s7150: writes the samples as a binary data file
+ (see s7150fmt.h), through one of three backends, to compare them:
+
+    stdio   fwrite() into the stdio buffer, like s7150 -b itself
+    uring   io_uring: records go into registered buffers, which are
+            written without a copy (IORING_OP_WRITE_FIXED); at a flush,
+            the fsync and the update of nrec are linked behind them
+    mmap    the file is mapped and grown with ftruncate(); records are
+            copied into the page cache directly, no syscall at all
+            until the mapping has to grow
+
+ Copyright (c) 2004...2025 by Joerg Hau.
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2 as
+ published by the Free Software Foundation, provided that the copyright
+ notice remains intact even in future versions. See the file LICENSE
+ for details.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ --------------------------------------------------------------------
+
+ Modification/history:
+
+ 2026-10-18     creation
+
+ Compile with something like:
+
+ gcc -Wall -O2 -shared -fPIC -o sink_bin.so sink_bin.c
+
+ and use it with:
+
+ s7150 -P ./sink_bin.so:path/to/file.bin[:stdio|uring|mmap[:sync]] path/to/file.dat
+
+ With 'sync', every flush (-w) also waits for the data to be on disk
+ (fdatasync(), a linked IORING_OP_FSYNC, or msync()). In any case, nrec
+ in the header is updated at every flush, after the records, so the
+ file can be read while it is written (HF_COMMIT, see s7150fmt.h).
+ No liburing is needed; the three io_uring syscalls are used directly.
+
+ For a benchmark (syscalls per MB, p99 latency of write() and flush()
+ for each backend), compile with
+
+ gcc -Wall -O2 -DBENCH -o sink_bin_bench sink_bin.c -lm
+
+ and run 'sink_bin_bench path/to/test.bin [sync]'.
+
+*/
+
+#define _GNU_SOURCE         /* mremap() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "s7150sink.h"
+
+enum backend { BK_STDIO = 0, BK_URING, BK_MMAP };
+static const char *bk_names[] = { "stdio", "uring", "mmap" };
+
+#define NBUF        4           /* uring: registered buffers ... */
+#define BUFSZ       (256 << 10) /* ... of this many bytes */
+#define NENTRY      16          /* uring: ring size; > NBUF + 2 in flight */
+#define MAPSTEP     (64 << 20)  /* mmap: grow by at most this much */
+
+struct ring
+    {
+    int     fd;
+    unsigned *sqhead, *sqtail, *sqmask, *sqarray;
+    unsigned *cqhead, *cqtail, *cqmask;
+    struct  io_uring_sqe *sqes;
+    struct  io_uring_cqe *cqes;
+    void    *sqptr, *cqptr;
+    size_t  sqsize, cqsize, sqesize;
+    unsigned queued;            /* SQEs not yet submitted */
+    };
+
+struct binsink
+    {
+    int     backend;            /* enum backend */
+    int     sync;               /* flush waits for the disk */
+    int     fd;
+    struct  s7150_binhdr hdr;
+    uint64_t nrec;              /* records written */
+    unsigned long nsys;         /* syscalls (uring, mmap; stdio: see BENCH) */
+    unsigned long nerr;         /* failed operations */
+
+    FILE    *fp;                /* stdio */
+
+    struct  ring r;             /* uring */
+    char    *buf[NBUF+1];       /* registered; the last one is for the header */
+    size_t  used;               /* bytes in the current buffer ... */
+    int     cur;                /* ... which is this one */
+    int     busy[NBUF+1];       /* buffer is being written */
+    off_t   off;                /* where the current buffer goes */
+
+    char    *map;               /* mmap */
+    size_t  mapsize;
+    };
+
+
+/* the three io_uring syscalls, there is no wrapper in libc */
+static int uring_setup (unsigned n, struct io_uring_params *p)
+{
+return (int) syscall(__NR_io_uring_setup, n, p);
+}
+
+static int uring_enter (int fd, unsigned nsub, unsigned nwait, unsigned flags)
+{
+return (int) syscall(__NR_io_uring_enter, fd, nsub, nwait, flags, NULL, 0);
+}
+
+static int uring_register (int fd, unsigned op, void *arg, unsigned n)
+{
+return (int) syscall(__NR_io_uring_register, fd, op, arg, n);
+}
+
+
+/********************************************************
+* ring_open: Sets up an io_uring and maps its queues.   *
+* Input:    ptr to ring                                 *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+static int ring_open (struct ring *r)
+{
+struct io_uring_params p;
+
+memset (&p, 0, sizeof(p));
+memset (r, 0, sizeof(*r));
+if ((r->fd = uring_setup(NENTRY, &p)) < 0)
+    return 0;
+
+r->sqsize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+r->cqsize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+if (p.features & IORING_FEAT_SINGLE_MMAP)
+    r->sqsize = r->cqsize = (r->sqsize > r->cqsize) ? r->sqsize : r->cqsize;
+r->sqptr = mmap(NULL, r->sqsize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                r->fd, IORING_OFF_SQ_RING);
+if (r->sqptr == MAP_FAILED)
+    {
+    close(r->fd);
+    return 0;
+    }
+r->cqptr = (p.features & IORING_FEAT_SINGLE_MMAP) ? r->sqptr :
+           mmap(NULL, r->cqsize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                r->fd, IORING_OFF_CQ_RING);
+r->sqesize = p.sq_entries * sizeof(struct io_uring_sqe);
+r->sqes = mmap(NULL, r->sqesize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+               r->fd, IORING_OFF_SQES);
+if (r->cqptr == MAP_FAILED || r->sqes == MAP_FAILED)
+    {
+    close(r->fd);
+    return 0;
+    }
+
+r->sqhead = (unsigned *) ((char *) r->sqptr + p.sq_off.head);
+r->sqtail = (unsigned *) ((char *) r->sqptr + p.sq_off.tail);
+r->sqmask = (unsigned *) ((char *) r->sqptr + p.sq_off.ring_mask);
+r->sqarray = (unsigned *) ((char *) r->sqptr + p.sq_off.array);
+r->cqhead = (unsigned *) ((char *) r->cqptr + p.cq_off.head);
+r->cqtail = (unsigned *) ((char *) r->cqptr + p.cq_off.tail);
+r->cqmask = (unsigned *) ((char *) r->cqptr + p.cq_off.ring_mask);
+r->cqes = (struct io_uring_cqe *) ((char *) r->cqptr + p.cq_off.cqes);
+return 1;
+}
+
+
+static void ring_close (struct ring *r)
+{
+munmap(r->sqes, r->sqesize);
+if (r->cqptr != r->sqptr)
+    munmap(r->cqptr, r->cqsize);
+munmap(r->sqptr, r->sqsize);
+close(r->fd);
+}
+
+
+/********************************************************
+* ring_sqe: Next free submission entry, cleared; it is  *
+*           queued, but only submitted by ring_reap().  *
+********************************************************/
+static struct io_uring_sqe *ring_sqe (struct ring *r)
+{
+unsigned tail = *r->sqtail, i = tail & *r->sqmask;
+struct io_uring_sqe *e = &r->sqes[i];
+
+memset (e, 0, sizeof(*e));
+r->sqarray[i] = i;
+__atomic_store_n(r->sqtail, tail + 1, __ATOMIC_RELEASE);
+r->queued++;
+return e;
+}
+
+
+/********************************************************
+* ring_reap: Submits what is queued and collects the    *
+*           completions, waiting for at least 'nwait'.  *
+*           A buffer whose write is complete is free.   *
+* Input:    - plugin data                               *
+*           - completions to wait for                   *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+static int ring_reap (struct binsink *k, unsigned nwait)
+{
+struct  ring *r = &k->r;
+struct  io_uring_cqe *c;
+unsigned head;
+int     ok = 1;
+
+if (r->queued || nwait)
+    {
+    k->nsys++;
+    if (uring_enter(r->fd, r->queued, nwait, nwait ? IORING_ENTER_GETEVENTS : 0) < 0)
+        {
+        fprintf(stderr, "sink_bin: io_uring_enter: %s\n", strerror(errno));
+        return 0;
+        }
+    r->queued = 0;
+    }
+
+head = *r->cqhead;
+while (head != __atomic_load_n(r->cqtail, __ATOMIC_ACQUIRE))
+    {
+    c = &r->cqes[head & *r->cqmask];
+    if (c->res < 0)
+        {
+        fprintf(stderr, "sink_bin: write: %s\n", strerror(-c->res));
+        k->nerr++;
+        ok = 0;
+        }
+    if (c->user_data <= NBUF)
+        k->busy[c->user_data] = 0;
+    head++;
+    }
+__atomic_store_n(r->cqhead, head, __ATOMIC_RELEASE);
+return ok;
+}
+
+
+/* number of buffers (incl. the header's) being written */
+static int uring_inflight (const struct binsink *k)
+{
+int i, n = 0;
+
+for (i = 0; i <= NBUF; i++)
+    n += k->busy[i];
+return n;
+}
+
+
+/********************************************************
+* uring_queue: Queues the write of the current buffer   *
+*           and goes on with the next one, waiting for  *
+*           it to be written if needed.                 *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+static int uring_queue (struct binsink *k)
+{
+struct io_uring_sqe *e;
+
+if (k->used == 0)
+    return 1;
+e = ring_sqe(&k->r);
+e->opcode = IORING_OP_WRITE_FIXED;
+e->fd = k->fd;
+e->off = k->off;
+e->addr = (uintptr_t) k->buf[k->cur];
+e->len = k->used;
+e->buf_index = k->cur;
+e->user_data = k->cur;
+k->busy[k->cur] = 1;
+k->off += k->used;
+k->used = 0;
+
+k->cur = (k->cur + 1) % NBUF;
+while (k->busy[k->cur])
+    if (0 == ring_reap(k, 1))
+        return 0;
+return 1;
+}
+
+
+/********************************************************
+* uring_commit: Queues the update of nrec behind all    *
+*           writes so far: IOSQE_IO_DRAIN waits for     *
+*           them, and with 'sync', a linked fsync comes *
+*           first. The previous update must be complete *
+*           as its buffer is used again.                *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+static int uring_commit (struct binsink *k)
+{
+struct io_uring_sqe *e;
+
+while (k->busy[NBUF])
+    if (0 == ring_reap(k, 1))
+        return 0;
+memcpy (k->buf[NBUF], &k->nrec, sizeof(k->nrec));
+
+if (k->sync)
+    {
+    e = ring_sqe(&k->r);
+    e->opcode = IORING_OP_FSYNC;
+    e->fd = k->fd;
+    e->fsync_flags = IORING_FSYNC_DATASYNC;
+    e->flags = IOSQE_IO_DRAIN | IOSQE_IO_LINK;
+    e->user_data = NBUF + 1;        /* no buffer */
+    }
+e = ring_sqe(&k->r);
+e->opcode = IORING_OP_WRITE_FIXED;
+e->fd = k->fd;
+e->off = offsetof(struct s7150_binhdr, nrec);
+e->addr = (uintptr_t) k->buf[NBUF];
+e->len = sizeof(k->nrec);
+e->buf_index = NBUF;
+e->user_data = NBUF;
+if (!k->sync)
+    e->flags = IOSQE_IO_DRAIN;
+k->busy[NBUF] = 1;
+return ring_reap(k, 0);
+}
+
+
+/********************************************************
+* map_grow: Makes the file and its mapping larger: by   *
+*           its size, up to MAPSTEP at a time.          *
+* Input:    - plugin data                               *
+*           - bytes needed at least                     *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+static int map_grow (struct binsink *k, size_t need)
+{
+size_t  size = k->mapsize;
+void    *p;
+
+while (size < need)
+    size += (size < MAPSTEP) ? size : MAPSTEP;
+k->nsys += 2;
+if (ftruncate(k->fd, size))
+    return 0;
+p = mremap(k->map, k->mapsize, size, MREMAP_MAYMOVE);
+if (p == MAP_FAILED)
+    return 0;
+k->map = p;
+k->mapsize = size;
+return 1;
+}
+
+
+/********************************************************
+* bin_init: Opens the file, writes the header.          *
+*           arg is "file.bin[:backend[:sync]]".         *
+********************************************************/
+static int bin_init (const char *arg, const struct s7150_runinfo *run, void **ctx)
+{
+struct  binsink *k;
+struct  s7150_binhdr *h;
+struct  iovec iov[NBUF+1];
+char    path[256], *p;
+int     i;
+
+if (NULL == (k = calloc(1, sizeof(*k))))
+    return 0;
+strncpy (path, arg, sizeof(path)-1);
+if (NULL != (p = strchr(path, ':')))
+    {
+    *p++ = 0;
+    for (k->backend = BK_MMAP; k->backend >= 0; k->backend--)
+        if (!strncmp(p, bk_names[k->backend], strlen(bk_names[k->backend])))
+            break;
+    k->sync = (NULL != strstr(p, ":sync"));
+    }
+if (path[0] == 0 || k->backend < 0)
+    {
+    fprintf(stderr, "sink_bin: use file.bin[:stdio|uring|mmap[:sync]], not '%s'.\n", arg);
+    free (k);
+    return 0;
+    }
+
+h = &k->hdr;
+memcpy (h->magic, S7150_MAGIC, 8);
+h->version = S7150_BINVER;
+h->hdrsize = sizeof(*h);
+h->recsize = sizeof(struct s7150_rec);
+h->nchan = 1;
+h->t0_us = (int64_t) (run->t0 * 1e6);
+h->pad = run->pad;
+h->mode = run->mode;
+h->delay = run->delay;
+h->hflags = HF_COMMIT;
+strncpy (h->program, run->program, sizeof(h->program)-1);
+strncpy (h->comment, run->comment, sizeof(h->comment)-1);
+
+if ((k->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0)
+    {
+    fprintf(stderr, "sink_bin: could not open '%s' for writing.\n", path);
+    free (k);
+    return 0;
+    }
+
+switch (k->backend)
+    {
+    case BK_STDIO:
+        if (NULL == (k->fp = fdopen(k->fd, "wb")) || 1 != fwrite(h, sizeof(*h), 1, k->fp))
+            break;
+        *ctx = k;
+        return 1;
+
+    case BK_URING:
+        if (0 == ring_open(&k->r))
+            {
+            fprintf(stderr, "sink_bin: io_uring not available: %s\n", strerror(errno));
+            break;
+            }
+        for (i = 0; i <= NBUF; i++)
+            {
+            iov[i].iov_len = (i < NBUF) ? BUFSZ : 4096;
+            if (posix_memalign((void **) &k->buf[i], 4096, iov[i].iov_len))
+                break;
+            iov[i].iov_base = k->buf[i];
+            }
+        if (i <= NBUF || uring_register(k->r.fd, IORING_REGISTER_BUFFERS, iov, NBUF+1) < 0)
+            {
+            fprintf(stderr, "sink_bin: could not register buffers.\n");
+            ring_close(&k->r);
+            while (i--)
+                free (k->buf[i]);
+            break;
+            }
+        memcpy (k->buf[0], h, sizeof(*h));
+        k->used = sizeof(*h);
+        *ctx = k;
+        return 1;
+
+    case BK_MMAP:
+        k->mapsize = BUFSZ;
+        if (ftruncate(k->fd, k->mapsize))
+            break;
+        k->map = mmap(NULL, k->mapsize, PROT_READ | PROT_WRITE, MAP_SHARED, k->fd, 0);
+        if (k->map == MAP_FAILED)
+            break;
+        memcpy (k->map, h, sizeof(*h));
+        k->off = sizeof(*h);
+        *ctx = k;
+        return 1;
+    }
+
+fprintf(stderr, "sink_bin: could not start writing '%s'.\n", path);
+close(k->fd);
+free (k);
+return 0;
+}
+
+
+/********************************************************
+* bin_write: Appends the records.                       *
+********************************************************/
+static int bin_write (void *ctx, const struct s7150_sample *s, size_t n)
+{
+struct  binsink *k = ctx;
+size_t  i;
+
+switch (k->backend)
+    {
+    case BK_STDIO:
+        for (i = 0; i < n; i++)
+            fwrite (&s[i].rec, sizeof(s[i].rec), 1, k->fp);
+        k->nrec += n;
+        return !ferror(k->fp);
+
+    case BK_URING:
+        for (i = 0; i < n; i++)
+            {
+            memcpy (k->buf[k->cur] + k->used, &s[i].rec, sizeof(s[i].rec));
+            k->used += sizeof(s[i].rec);
+            if (k->used + sizeof(s[i].rec) > BUFSZ && 0 == uring_queue(k))
+                return 0;
+            }
+        k->nrec += n;
+        return ring_reap(k, 0);
+
+    case BK_MMAP:
+        if (k->off + n * sizeof(s->rec) > k->mapsize &&
+            0 == map_grow(k, k->off + n * sizeof(s->rec)))
+            {
+            fprintf(stderr, "sink_bin: could not grow the file: %s\n", strerror(errno));
+            return 0;
+            }
+        for (i = 0; i < n; i++, k->off += sizeof(s->rec))
+            memcpy (k->map + k->off, &s[i].rec, sizeof(s->rec));
+        k->nrec += n;
+        return 1;
+    }
+return 0;
+}
+
+
+/********************************************************
+* bin_flush: Makes the records so far visible to        *
+*           readers (nrec), and with 'sync' durable.    *
+********************************************************/
+static int bin_flush (void *ctx)
+{
+struct  binsink *k = ctx;
+size_t  a;
+
+switch (k->backend)
+    {
+    case BK_STDIO:
+        if (fflush(k->fp) || (k->sync && fdatasync(k->fd)))
+            return 0;
+        k->nsys += k->sync;
+        return s7150_commitrec(k->fd, k->nrec);
+
+    case BK_URING:
+        return uring_queue(k) && uring_commit(k);
+
+    case BK_MMAP:
+        /* the records are in the page cache already; nrec after them */
+        __atomic_store_n(&((struct s7150_binhdr *) k->map)->nrec, k->nrec, __ATOMIC_RELEASE);
+        if (k->sync)
+            {
+            a = sysconf(_SC_PAGESIZE);
+            k->nsys++;
+            return 0 == msync(k->map, (k->off + a - 1) / a * a, MS_SYNC);
+            }
+        return 1;
+    }
+return 0;
+}
+
+
+/********************************************************
+* bin_close: Completes the header, trims the file (the  *
+*           mmap backend grows it ahead), closes it.    *
+********************************************************/
+static int bin_close (void *ctx, const struct s7150_runinfo *run)
+{
+struct  binsink *k = ctx;
+int     ok = 1, i;
+
+k->hdr.t1_us = (int64_t) (run->t1 * 1e6);
+k->hdr.nrec = k->nrec;
+switch (k->backend)
+    {
+    case BK_STDIO:
+        ok = (0 == fflush(k->fp));
+        ok &= (sizeof(k->hdr) == pwrite(k->fd, &k->hdr, sizeof(k->hdr), 0));
+        ok &= (0 == fclose(k->fp));
+        break;
+
+    case BK_URING:
+        ok = uring_queue(k);
+        while (ok && uring_inflight(k))
+            ok = ring_reap(k, 1);
+        ring_close(&k->r);
+        for (i = 0; i <= NBUF; i++)
+            free (k->buf[i]);
+        ok &= (sizeof(k->hdr) == pwrite(k->fd, &k->hdr, sizeof(k->hdr), 0));
+        ok &= (0 == close(k->fd));
+        break;
+
+    case BK_MMAP:
+        memcpy (k->map, &k->hdr, sizeof(k->hdr));
+        ok = (0 == munmap(k->map, k->mapsize));
+        ok &= (0 == ftruncate(k->fd, k->off));
+        ok &= (0 == close(k->fd));
+        break;
+    }
+ok &= (k->nerr == 0);
+free (k);
+return ok;
+}
+
+
+const struct s7150_sinkops s7150_sink =
+    {
+    S7150_SINK_ABI, "bin", bin_init, bin_write, bin_flush, bin_close
+    };
+
+
+#ifdef BENCH
+/********************************************************
+* main:     Benchmark: feeds synthetic samples through  *
+*           each backend in batches, with a flush every *
+*           FLUSH samples like s7150 -w, and reports    *
+*           syscalls per MB and the latency of write()  *
+*           and flush() calls (p50, p99, max).          *
+*           stdio's write() syscalls are counted by the *
+*           kernel (syscw in /proc/self/io).            *
+********************************************************/
+#include <math.h>
+#include <sys/time.h>
+
+#define NSAMP  4000000L
+#define BATCH      512
+#define FLUSH    10240
+
+static double now (void)
+{
+struct timeval t;
+
+gettimeofday(&t, NULL);
+return (double)t.tv_sec + (double)t.tv_usec/1000000.0;
+}
+
+static unsigned long syscw (void)
+{
+char    line[80];
+unsigned long n = 0;
+FILE    *fp = fopen("/proc/self/io", "r");
+
+while (fp && fgets(line, sizeof(line), fp))
+    if (1 == sscanf(line, "syscw: %lu", &n))
+        break;
+if (fp)
+    fclose(fp);
+return n;
+}
+
+static int cmp (const void *a, const void *b)
+{
+double x = *(const double *) a, y = *(const double *) b;
+
+return (x > y) - (x < y);
+}
+
+/* p-th percentile of n sorted latencies, in us */
+static double pct (const double *t, long n, double p)
+{
+return n ? 1e6 * t[(long) ceil(p / 100.0 * n) - 1] : 0.0;
+}
+
+int main (int argc, char *argv[])
+{
+static struct s7150_sample b[BATCH];
+struct  s7150_runinfo run = { S7150_SINK_ABI, "sink_bin bench", "-", "benchmark",
+                              16, 0, 0, 0.0, 0.0 };
+struct  s7150_reading r = { 0, -6, U_V, AD_DC, EF_OK };
+char    arg[300];
+void    *ctx;
+double  *tw, *tf, t, tall;
+long    n, nw, nf;
+unsigned long w0;
+int     bk, i;
+
+if (argc < 2)
+    {
+    fprintf(stderr, "Syntax: sink_bin_bench path/to/test.bin [sync]\n");
+    return 1;
+    }
+tw = malloc((NSAMP / BATCH + 1) * sizeof(*tw));
+tf = malloc((NSAMP / FLUSH + 1) * sizeof(*tf));
+
+for (bk = BK_STDIO; bk <= BK_MMAP; bk++)
+    {
+    snprintf(arg, sizeof(arg), "%s:%s%s", argv[1], bk_names[bk], argc > 2 ? ":sync" : "");
+    run.t0 = now();
+    if (0 == s7150_sink.init(arg, &run, &ctx))
+        continue;
+    w0 = syscw();
+    nw = nf = 0;
+    tall = now();
+    for (n = 0; n < NSAMP; n += BATCH)
+        {
+        for (i = 0; i < BATCH; i++)
+            {
+            r.count = (int32_t) ((n + i) % 2000000L) - 1000000;
+            s7150_torec(&r, (n + i) * 1000, 0, &b[i].rec);
+            }
+        t = now();
+        if (0 == s7150_sink.write(ctx, b, BATCH))
+            return 4;
+        tw[nw++] = now() - t;
+        if ((n + BATCH) % FLUSH == 0)
+            {
+            t = now();
+            if (0 == s7150_sink.flush(ctx))
+                return 4;
+            tf[nf++] = now() - t;
+            }
+        }
+    run.t1 = now();
+    if (bk == BK_STDIO)
+        ((struct binsink *) ctx)->nsys += syscw() - w0;
+    i = ((struct binsink *) ctx)->nsys;
+    if (0 == s7150_sink.close(ctx, &run))
+        return 4;
+    tall = run.t1 - tall;
+    qsort(tw, nw, sizeof(*tw), cmp);
+    qsort(tf, nf, sizeof(*tf), cmp);
+    printf("%-5s: %.0f MB/s, %.2f syscalls/MB; write p50 %.1f p99 %.1f max %.0f us;"
+           " flush p50 %.1f p99 %.1f max %.0f us\n", bk_names[bk],
+           NSAMP * 16.0 / 1048576.0 / tall, i / (NSAMP * 16.0 / 1048576.0),
+           pct(tw, nw, 50), pct(tw, nw, 99), pct(tw, nw, 100),
+           pct(tf, nf, 50), pct(tf, nf, 99), pct(tf, nf, 100));
+    }
+return 0;
+}
+#endif
@@ -0,0 +1,349 @@
+/* vi:set syntax=c expandtab tabstop=4 shiftwidth=4:
+
+ S I N K _ S Q L I T E . C
+
+ Output plugin for s7150: writes the samples into an SQLite database,
+ one row per sample, plus one row per acquisition in table 'run'.
+
+ Copyright (c) 2004...2025 by Joerg Hau.
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2 as
+ published by the Free Software Foundation, provided that the copyright
+ notice remains intact even in future versions. See the file LICENSE
+ for details.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ --------------------------------------------------------------------
+
+ Modification/history:
+
+ 2026-10-18     creation
+
+ Compile with something like:
+
+ gcc -Wall -O2 -shared -fPIC -o sink_sqlite.so sink_sqlite.c -lsqlite3
+
+ and use it with:
+
+ s7150 -P ./sink_sqlite.so:path/to/file.db[:rows[:sec]] path/to/file.dat
+
+ The inserts are grouped into transactions, which are committed after
+ 'rows' samples (default 1000), after 'sec' seconds (default 5), and
+ whenever s7150 flushes its files (-w). The database is in WAL mode, so
+ other programs can read it during the acquisition.
+
+ For a benchmark (inserts/s, 1 and 8 channels), compile with
+
+ gcc -Wall -O2 -DBENCH -o sink_sqlite_bench sink_sqlite.c -lsqlite3
+
+ and run 'sink_sqlite_bench path/to/test.db'.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include <sqlite3.h>
+#include "s7150sink.h"
+
+#define ROWS    1000        /* default: commit after this many samples ... */
+#define SECS    5.0         /* ... or after this many seconds */
+
+static const char *schema =
+    "PRAGMA journal_mode=WAL;"
+    "PRAGMA synchronous=NORMAL;"    /* WAL: consistent after a crash, syncs at checkpoints */
+    "CREATE TABLE IF NOT EXISTS run ("
+    "  id INTEGER PRIMARY KEY, program TEXT, datafile TEXT, comment TEXT,"
+    "  pad INTEGER, mode INTEGER, dt REAL, t0 REAL, t1 REAL);"
+    "CREATE TABLE IF NOT EXISTS sample ("
+    "  run INTEGER NOT NULL REFERENCES run(id), chan INTEGER NOT NULL,"
+    "  t REAL NOT NULL, value REAL, count INTEGER, exp INTEGER,"
+    "  unit TEXT, flags INTEGER, reading TEXT);"
+    "CREATE INDEX IF NOT EXISTS sample_run_t ON sample(run, t);";
+
+struct sqlsink
+    {
+    sqlite3 *db;
+    sqlite3_stmt *ins;      /* prepared once, for every sample */
+    sqlite3_int64 run;      /* id of our row in table 'run' */
+    long    rows;           /* commit after this many samples ... */
+    double  secs;           /* ... or seconds */
+    long    n;              /* samples in the open transaction ... */
+    double  tbegin;         /* ... which started then; 0 if none open */
+    };
+
+
+static double now (void)
+{
+struct timeval t;
+
+gettimeofday(&t, NULL);
+return (double)t.tv_sec + (double)t.tv_usec/1000000.0;
+}
+
+
+/********************************************************
+* sql_exec: Runs SQL without results, reports errors.   *
+* Input:    - plugin data                               *
+*           - SQL text                                  *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+static int sql_exec (struct sqlsink *k, const char *sql)
+{
+char *err = NULL;
+
+if (SQLITE_OK == sqlite3_exec(k->db, sql, NULL, NULL, &err))
+    return 1;
+fprintf(stderr, "sink_sqlite: %s\n", err ? err : sqlite3_errmsg(k->db));
+sqlite3_free(err);
+return 0;
+}
+
+
+/********************************************************
+* sql_commit: Commits the open transaction, if any.     *
+* Input:    plugin data                                 *
+* Return:   1 if OK, 0 if error                         *
+********************************************************/
+static int sql_commit (struct sqlsink *k)
+{
+if (k->tbegin == 0.0)
+    return 1;
+k->tbegin = 0.0;
+k->n = 0;
+return sql_exec(k, "COMMIT");
+}
+
+
+/********************************************************
+* sql_init: Opens (or creates) the database, prepares   *
+*           the insert and enters the run.              *
+*           arg is "file.db[:rows[:sec]]".              *
+********************************************************/
+static int sql_init (const char *arg, const struct s7150_runinfo *run, void **ctx)
+{
+struct  sqlsink *k;
+sqlite3_stmt *st;
+char    path[256], *p;
+
+if (NULL == (k = calloc(1, sizeof(*k))))
+    return 0;
+k->rows = ROWS;
+k->secs = SECS;
+strncpy (path, arg, sizeof(path)-1);
+if (NULL != (p = strchr(path, ':')))
+    {
+    *p++ = 0;
+    k->rows = atol(p);
+    if (NULL != (p = strchr(p, ':')))
+        k->secs = atof(p+1);
+    }
+if (path[0] == 0 || k->rows < 1 || k->secs <= 0.0)
+    {
+    fprintf(stderr, "sink_sqlite: use file.db[:rows[:sec]], not '%s'.\n", arg);
+    free (k);
+    return 0;
+    }
+
+if (SQLITE_OK != sqlite3_open(path, &k->db))
+    {
+    fprintf(stderr, "sink_sqlite: could not open '%s': %s\n", path, sqlite3_errmsg(k->db));
+    sqlite3_close(k->db);
+    free (k);
+    return 0;
+    }
+sqlite3_busy_timeout(k->db, 10000);     /* readers may hold a lock briefly */
+if (0 == sql_exec(k, schema))
+    {
+    sqlite3_close(k->db);
+    free (k);
+    return 0;
+    }
+
+if (SQLITE_OK != sqlite3_prepare_v2(k->db, "INSERT INTO run "
+        "(program, datafile, comment, pad, mode, dt, t0) VALUES (?,?,?,?,?,?,?)", -1, &st, NULL))
+    {
+    fprintf(stderr, "sink_sqlite: %s\n", sqlite3_errmsg(k->db));
+    sqlite3_close(k->db);
+    free (k);
+    return 0;
+    }
+sqlite3_bind_text(st, 1, run->program, -1, SQLITE_STATIC);
+sqlite3_bind_text(st, 2, run->datafile, -1, SQLITE_STATIC);
+sqlite3_bind_text(st, 3, run->comment, -1, SQLITE_STATIC);
+sqlite3_bind_int(st, 4, run->pad);
+sqlite3_bind_int(st, 5, run->mode);
+sqlite3_bind_double(st, 6, run->delay / 10.0);
+sqlite3_bind_double(st, 7, run->t0);
+if (SQLITE_DONE != sqlite3_step(st) ||
+    SQLITE_OK != sqlite3_prepare_v2(k->db, "INSERT INTO sample "
+        "(run, chan, t, value, count, exp, unit, flags, reading) VALUES (?,?,?,?,?,?,?,?,?)",
+        -1, &k->ins, NULL))
+    {
+    fprintf(stderr, "sink_sqlite: %s\n", sqlite3_errmsg(k->db));
+    sqlite3_finalize(st);
+    sqlite3_close(k->db);
+    free (k);
+    return 0;
+    }
+sqlite3_finalize(st);
+k->run = sqlite3_last_insert_rowid(k->db);
+*ctx = k;
+return 1;
+}
+
+
+/********************************************************
+* sql_write: One row per sample, inside a transaction   *
+*           that is committed by count or age.          *
+********************************************************/
+static int sql_write (void *ctx, const struct s7150_sample *s, size_t n)
+{
+struct  sqlsink *k = ctx;
+sqlite3_stmt *st = k->ins;
+size_t  i;
+int     ok = 1;
+
+for (i = 0; i < n; i++, s++)
+    {
+    if (k->tbegin == 0.0)
+        {
+        if (0 == sql_exec(k, "BEGIN"))
+            return 0;
+        k->tbegin = now();
+        }
+
+    sqlite3_bind_int64(st, 1, k->run);
+    sqlite3_bind_int(st, 2, s->rec.chan);
+    sqlite3_bind_double(st, 3, s->rec.t_us / 1e6);
+    if (isnan(s->value))
+        {
+        sqlite3_bind_null(st, 4);
+        sqlite3_bind_null(st, 5);
+        sqlite3_bind_null(st, 6);
+        sqlite3_bind_null(st, 7);
+        }
+    else
+        {
+        sqlite3_bind_double(st, 4, s->value);
+        sqlite3_bind_int(st, 5, s->rec.count);
+        sqlite3_bind_int(st, 6, s->rec.exp);
+        sqlite3_bind_text(st, 7, s7150_units[s->rec.unit & RU_UNIT],
+                          s7150_units[s->rec.unit & RU_UNIT][1] == ' ' ? 1 : 2, SQLITE_STATIC);
+        }
+    sqlite3_bind_int(st, 8, s->rec.flags);
+    sqlite3_bind_text(st, 9, s->text, -1, SQLITE_STATIC);
+    if (SQLITE_DONE != sqlite3_step(st))
+        {
+        fprintf(stderr, "sink_sqlite: %s\n", sqlite3_errmsg(k->db));
+        ok = 0;
+        }
+    sqlite3_reset(st);
+
+    if (++k->n >= k->rows)
+        ok &= sql_commit(k);
+    }
+if (k->tbegin != 0.0 && now() - k->tbegin >= k->secs)
+    ok &= sql_commit(k);
+return ok;
+}
+
+
+static int sql_flush (void *ctx)
+{
+return sql_commit(ctx);
+}
+
+
+/********************************************************
+* sql_close: Commits the rest, completes the run entry. *
+********************************************************/
+static int sql_close (void *ctx, const struct s7150_runinfo *run)
+{
+struct  sqlsink *k = ctx;
+sqlite3_stmt *st;
+int     ok;
+
+ok = sql_commit(k);
+sqlite3_finalize(k->ins);
+if (SQLITE_OK == sqlite3_prepare_v2(k->db, "UPDATE run SET t1 = ? WHERE id = ?", -1, &st, NULL))
+    {
+    sqlite3_bind_double(st, 1, run->t1);
+    sqlite3_bind_int64(st, 2, k->run);
+    ok &= (SQLITE_DONE == sqlite3_step(st));
+    sqlite3_finalize(st);
+    }
+else
+    ok = 0;
+ok &= (SQLITE_OK == sqlite3_close(k->db));
+free (k);
+return ok;
+}
+
+
+const struct s7150_sinkops s7150_sink =
+    {
+    S7150_SINK_ABI, "sqlite", sql_init, sql_write, sql_flush, sql_close
+    };
+
+
+#ifdef BENCH
+/********************************************************
+* main:     Benchmark: feeds synthetic samples through  *
+*           the plugin as fast as possible, in batches  *
+*           like s7150 does, for 1 and for 8 channels.  *
+********************************************************/
+#define NSAMP  1000000L
+#define BATCH      512
+
+int main (int argc, char *argv[])
+{
+static struct s7150_sample b[BATCH];
+struct  s7150_runinfo run = { S7150_SINK_ABI, "sink_sqlite bench", "-", "benchmark",
+                              16, 0, 0, 0.0, 0.0 };
+struct  s7150_reading r = { 0, -6, U_V, AD_DC, EF_OK };
+void    *ctx;
+int     nchan, i;
+long    n;
+double  t;
+
+if (argc != 2)
+    {
+    fprintf(stderr, "Syntax: sink_sqlite_bench path/to/test.db\n");
+    return 1;
+    }
+
+for (nchan = 1; nchan <= 8; nchan *= 8)
+    {
+    run.t0 = now();
+    if (0 == s7150_sink.init(argv[1], &run, &ctx))
+        return 4;
+    t = now();
+    for (n = 0; n < NSAMP; n += BATCH)
+        {
+        for (i = 0; i < BATCH; i++)
+            {
+            r.count = (int32_t) ((n + i) % 2000000L) - 1000000;
+            s7150_torec(&r, (n + i) / nchan * 1000, (n + i) % nchan, &b[i].rec);
+            b[i].value = s7150_value(&r);
+            s7150_encode(&r, b[i].text);
+            b[i].text[S7150_LEN] = 0;
+            }
+        if (0 == s7150_sink.write(ctx, b, BATCH))
+            return 4;
+        }
+    run.t1 = now();
+    s7150_sink.close(ctx, &run);
+    t = now() - t;
+    printf("%d channel(s): %ld rows in %.2f s, %.0f inserts/s\n", nchan, n, t, n / t);
+    }
+return 0;
+}
+#endif
@@ -0,0 +1,199 @@
+/* vi:set syntax=c expandtab tabstop=4 shiftwidth=4:
+
+ S I N K _ S T R E A M . C
+
+ Output plugin for s7150: a live stream of the samples over TCP, in the
+ format of the text data file, for any number of clients.
+
+ Copyright (c) 2004...2025 by Joerg Hau.
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2 as
+ published by the Free Software Foundation, provided that the copyright
+ notice remains intact even in future versions. See the file LICENSE
+ for details.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ --------------------------------------------------------------------
+
+ Modification/history:
+
+ 2026-10-18     creation
+
+ Compile with something like:
+
+ gcc -Wall -O2 -shared -fPIC -o sink_stream.so sink_stream.c
+
+ and use it with:
+
+ s7150 -P ./sink_stream.so:port path/to/file.dat
+ nc localhost port
+
+ The lines are the ones s7150 has formatted for its data file (see
+ s7150sink.h), so they are not formatted again. A client that connects
+ gets the comment header and then the samples from that moment on.
+ Nothing waits for a client: one that does not keep up (its socket
+ buffer is full) is disconnected, the others go on.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "s7150sink.h"
+
+#define MAXCLIENT  16       /* clients at the same time */
+#define BUFLEN  65536       /* bytes sent per call, at most */
+
+struct stream
+    {
+    int     lfd;            /* listening socket */
+    int     cfd[MAXCLIENT]; /* clients, -1 if free */
+    char    head[512];      /* comment header for new clients */
+    char    buf[BUFLEN];    /* lines of one batch */
+    };
+
+
+/********************************************************
+* st_accept: Takes the clients that have connected      *
+*           since, and sends them the header.           *
+* Input:    plugin data                                 *
+* Return:   nothing                                     *
+********************************************************/
+static void st_accept (struct stream *k)
+{
+int fd, i, n = strlen(k->head);
+
+while ((fd = accept(k->lfd, NULL, NULL)) >= 0)
+    {
+    for (i = 0; i < MAXCLIENT && k->cfd[i] >= 0; i++)
+        ;
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    if (i == MAXCLIENT || n != send(fd, k->head, n, MSG_NOSIGNAL))
+        {
+        close(fd);
+        continue;
+        }
+    k->cfd[i] = fd;
+    }
+}
+
+
+/********************************************************
+* st_send: Sends a buffer to all clients; drops those   *
+*           that cannot take all of it right now.       *
+* Input:    - plugin data                               *
+*           - buffer and its length                     *
+* Return:   nothing                                     *
+********************************************************/
+static void st_send (struct stream *k, const char *buf, size_t len)
+{
+int i;
+
+for (i = 0; i < MAXCLIENT; i++)
+    if (k->cfd[i] >= 0 && (ssize_t) len != send(k->cfd[i], buf, len, MSG_NOSIGNAL))
+        {
+        close(k->cfd[i]);
+        k->cfd[i] = -1;
+        }
+}
+
+
+/********************************************************
+* st_init: Listens on the port given as argument.       *
+********************************************************/
+static int st_init (const char *arg, const struct s7150_runinfo *run, void **ctx)
+{
+struct  stream *k;
+struct  sockaddr_in a;
+time_t  t = (time_t) run->t0;
+int     i, on = 1, port = atoi(arg);
+
+if (port < 1 || port > 65535)
+    {
+    fprintf(stderr, "sink_stream: use a port number, not '%s'.\n", arg);
+    return 0;
+    }
+if (NULL == (k = calloc(1, sizeof(*k))))
+    return 0;
+for (i = 0; i < MAXCLIENT; i++)
+    k->cfd[i] = -1;
+
+memset (&a, 0, sizeof(a));
+a.sin_family = AF_INET;
+a.sin_port = htons(port);
+a.sin_addr.s_addr = htonl(INADDR_ANY);
+if ((k->lfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0)) < 0 ||
+    setsockopt(k->lfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) ||
+    bind(k->lfd, (struct sockaddr *) &a, sizeof(a)) || listen(k->lfd, MAXCLIENT))
+    {
+    fprintf(stderr, "sink_stream: could not listen on port %d: %s\n", port, strerror(errno));
+    if (k->lfd >= 0)
+        close(k->lfd);
+    free (k);
+    return 0;
+    }
+snprintf(k->head, sizeof(k->head), "# %s\n# %s\n# Acquisition start: %s",
+         run->program, run->comment, ctime(&t));
+*ctx = k;
+return 1;
+}
+
+
+/********************************************************
+* st_write: Collects the lines of a batch and sends     *
+*           them in one go.                             *
+********************************************************/
+static int st_write (void *ctx, const struct s7150_sample *s, size_t n)
+{
+struct  stream *k = ctx;
+size_t  i, len = 0;
+
+st_accept(k);
+for (i = 0; i < n; i++, s++)
+    {
+    if (len + s->linelen > BUFLEN)
+        {
+        st_send(k, k->buf, len);
+        len = 0;
+        }
+    memcpy (k->buf + len, s->line, s->linelen);
+    len += s->linelen;
+    }
+st_send(k, k->buf, len);
+return 1;
+}
+
+
+static int st_close (void *ctx, const struct s7150_runinfo *run)
+{
+struct  stream *k = ctx;
+char    buf[128];
+time_t  t = (time_t) run->t1;
+int     i;
+
+snprintf(buf, sizeof(buf), "# Acquisition stop: %s\n", ctime(&t));
+st_send(k, buf, strlen(buf));
+for (i = 0; i < MAXCLIENT; i++)
+    if (k->cfd[i] >= 0)
+        close(k->cfd[i]);
+close(k->lfd);
+free (k);
+return 1;
+}
+
+
+const struct s7150_sinkops s7150_sink =
+    {
+    S7150_SINK_ABI, "stream", st_init, st_write, NULL, st_close
+    };
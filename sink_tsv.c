@@ -0,0 +1,97 @@
+/* vi:set syntax=c expandtab tabstop=4 shiftwidth=4:
+
+ S I N K _ T S V . C
+
+ Example output plugin for s7150: writes the decoded samples as
+ tab-separated values (time in s, value, count, exponent, unit).
+
+ Copyright (c) 2004...2025 by Joerg Hau.
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2 as
+ published by the Free Software Foundation, provided that the copyright
+ notice remains intact even in future versions. See the file LICENSE
+ for details.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ --------------------------------------------------------------------
+
+ Modification/history:
+
+ 2026-10-18     creation
+
+ Compile with something like:
+
+ gcc -Wall -O2 -shared -fPIC -o sink_tsv.so sink_tsv.c
+
+ and use it with:
+
+ s7150 -P ./sink_tsv.so:path/to/file.tsv path/to/file.dat
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "s7150sink.h"
+
+
+/********************************************************
+* tsv_init: Opens the output file given as argument.    *
+********************************************************/
+static int tsv_init (const char *arg, const struct s7150_runinfo *run, void **ctx)
+{
+FILE *fp;
+time_t t = (time_t) run->t0;
+
+if (arg[0] == 0 || NULL == (fp = fopen(arg, "wt")))
+    {
+    fprintf(stderr, "sink_tsv: could not open '%s' for writing.\n", arg);
+    return 0;
+    }
+fprintf(fp, "# %s\n# %s\n# Acquisition start: %s", run->program, run->comment, ctime(&t));
+fprintf(fp, "# s\tvalue\tcount\texp\tunit\n");
+*ctx = fp;
+return 1;
+}
+
+
+/********************************************************
+* tsv_write: One line per sample.                       *
+********************************************************/
+static int tsv_write (void *ctx, const struct s7150_sample *s, size_t n)
+{
+FILE *fp = ctx;
+size_t i;
+
+for (i = 0; i < n; i++, s++)
+    fprintf(fp, "%.6f\t%.7g\t%d\t%d\t%.2s\n", s->rec.t_us / 1e6, s->value,
+            s->rec.count, s->rec.exp, s7150_units[s->rec.unit & RU_UNIT]);
+return !ferror(fp);
+}
+
+
+static int tsv_flush (void *ctx)
+{
+return 0 == fflush((FILE *) ctx);
+}
+
+
+static int tsv_close (void *ctx, const struct s7150_runinfo *run)
+{
+FILE *fp = ctx;
+time_t t = (time_t) run->t1;
+
+fprintf(fp, "# Acquisition stop: %s\n", ctime(&t));
+return 0 == fclose(fp);
+}
+
+
+const struct s7150_sinkops s7150_sink =
+    {
+    S7150_SINK_ABI, "tsv", tsv_init, tsv_write, tsv_flush, tsv_close
+    };
@@ -0,0 +1,250 @@
+/* vi:set syntax=c expandtab tabstop=4 shiftwidth=4:
+
+ R O U N D T R I P . C
+
+ Round trip of the 15-character readings of the 7150 through the
+ decoder, the binary record and the encoder (see s7150fmt.h).
+
+ Copyright (c) 2004...2025 by Joerg Hau.
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2 as
+ published by the Free Software Foundation, provided that the copyright
+ notice remains intact even in future versions. See the file LICENSE
+ for details.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ --------------------------------------------------------------------
+
+ Modification/history:
+
+ 2026-10-18     creation
+
+ Compile and run from the top directory with something like:
+
+ gcc -Wall -O2 -o roundtrip test/roundtrip.c -lm && ./roundtrip test/readings.dat
+
+ Every reading of the table below must decode to the given count,
+ exponent, unit, mode and error flag, and come back byte for byte
+ from its binary record, also as raw bytes with CR (s7150_regen()).
+ The table has every range of every mode, both signs (also of a zero,
+ which the record keeps in RU_NEG) and overloads; the readings that
+ must be rejected are checked as such.
+ Means with more digits than the readings (s7150 -O) must round to the
+ readings given with them (s7150_round()).
+ Data files given as arguments (such as test/readings.dat, the corpus
+ of s7150 -V) go through the same round trip, reading by reading.
+ The exit code is 0 if all is well, 1 if not.
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "../s7150fmt.h"
+
+#define MAXLEN 90
+
+struct good
+    {
+    const char *s;          /* as sent by the instrument */
+    int32_t count;
+    int8_t  exp;
+    uint8_t unit, acdc, eflag;
+    };
+
+static const struct good good[] =
+    {
+    /* DCV: 0.2, 2, 20, 200, 2000 V */
+    { "+.1234567  V DC",  1234567, -7, U_V, AD_DC, EF_OK },
+    { "+1.234567  V DC",  1234567, -6, U_V, AD_DC, EF_OK },
+    { "-12.34567  V DC", -1234567, -5, U_V, AD_DC, EF_OK },
+    { "+123.4567  V DC",  1234567, -4, U_V, AD_DC, EF_OK },
+    { "-1000.000  V DC", -1000000, -3, U_V, AD_DC, EF_OK },
+    { "+199.9999  mVDC",  1999999, -4, U_MV, AD_DC, EF_OK },
+    /* ACV */
+    { "+.0012345  V AC",    12345, -7, U_V, AD_AC, EF_OK },
+    { "+1.000000  V AC",  1000000, -6, U_V, AD_AC, EF_OK },
+    { "+19.99999  V AC",  1999999, -5, U_V, AD_AC, EF_OK },
+    { "+199.9999  V AC",  1999999, -4, U_V, AD_AC, EF_OK },
+    { "+0750.000  V AC",   750000, -3, U_V, AD_AC, EF_OK },
+    /* Ohm: 20 k, 200 k, 2 M, 20 M */
+    { "+19.99999  kO  ",  1999999, -5, U_KOHM, AD_NONE, EF_OK },
+    { "+100.0000  kO  ",  1000000, -4, U_KOHM, AD_NONE, EF_OK },
+    { "+1.999999  MO  ",  1999999, -6, U_MOHM, AD_NONE, EF_OK },
+    { "+10.00000  MO  ",  1000000, -5, U_MOHM, AD_NONE, EF_OK },
+    /* DCA and ACA: 2000 mA */
+    { "-1999.999  mADC", -1999999, -3, U_MA, AD_DC, EF_OK },
+    { "+0000.001  mADC",        1, -3, U_MA, AD_DC, EF_OK },
+    { "+1000.000  mAAC",  1000000, -3, U_MA, AD_AC, EF_OK },
+    /* diode, temperatures (7150 plus) */
+    { "+0612.345  mVDC",   612345, -3, U_MV, AD_DC, EF_OK },
+    { "-040.0000  C   ",  -400000, -4, U_DEGC, AD_NONE, EF_OK },
+    { "+1234567.  F   ",  1234567,  0, U_DEGF, AD_NONE, EF_OK },
+    /* zero, and the smallest steps of both signs */
+    { "+0.000000  V DC",        0, -6, U_V, AD_DC, EF_OK },
+    { "+.0000001  V DC",        1, -7, U_V, AD_DC, EF_OK },
+    { "-.0000001  V DC",       -1, -7, U_V, AD_DC, EF_OK },
+    { "-0.000000  V DC",        0, -6, U_V, AD_DC, EF_OK },
+    { "-0000.000  mAAC",        0, -3, U_MA, AD_AC, EF_OK },
+    /* overloads */
+    { "+1.999999 !V DC",  1999999, -6, U_V, AD_DC, EF_OVER },
+    { "-1.999999 !V DC", -1999999, -6, U_V, AD_DC, EF_OVER },
+    { "+9999.999 !mAAC",  9999999, -3, U_MA, AD_AC, EF_OVER },
+    { "+19.99999 !MO  ",  1999999, -5, U_MOHM, AD_NONE, EF_OVER },
+    };
+
+/* not the layout of a reading: decode must say so */
+static const char *bad[] =
+    {
+    "1.2345670  V DC",      /* no sign */
+    "+1.23456   V DC",      /* a digit short */
+    "+1.2345678 V DC",      /* a digit too many */
+    "+12345678  V DC",      /* no decimal point */
+    "+1.23.567  V DC",      /* two of them */
+    "+1.2a4567  V DC",      /* not a digit */
+    };
+
+/* decodable, but not to be encoded again */
+static const char *noenc[] =
+    {
+    "+1.234567 ?V DC",      /* unknown error flag */
+    "+1.234567  X DC",      /* unknown unit */
+    "+1.234567  V XX",      /* unknown mode */
+    };
+
+/* means with more digits, and how they are shown */
+static const struct good mean[] =
+    {
+    { "+1.234568  V DC",  12345675, -7, U_V, AD_DC, EF_OK },
+    { "-.1234568  V DC", -12345675, -8, U_V, AD_DC, EF_OK },
+    { "+10.00000  V DC",  99999996, -7, U_V, AD_DC, EF_OK },
+    { "+.0000001  V DC",        50, -9, U_V, AD_DC, EF_OK },
+    { "-1999.999  mADC", -199999912, -5, U_MA, AD_DC, EF_OK },
+    { "+1.234567  V DC",   1234567, -6, U_V, AD_DC, EF_OK },
+    { "-.0000000  V DC",        -4, -9, U_V, AD_DC, EF_OK },
+    };
+
+static int nfail = 0;
+
+
+/********************************************************
+* roundtrip: Decodes a reading, stores it in a record   *
+*           and encodes it again.                       *
+* Input:    - reading, 15 chars                         *
+*           - ptr to decoded reading                    *
+* Return:   1 if it came back byte for byte, 0 if not   *
+********************************************************/
+int roundtrip (const char *s, struct s7150_reading *r)
+{
+struct  s7150_reading back;
+struct  s7150_rec rec;
+char    out[S7150_LEN+1], raw[S7150_RAWLEN+1];
+
+if (!s7150_decode(s, r))
+    return 0;
+s7150_torec(r, 0, 0, &rec);
+if (!s7150_fromrec(&rec, &back) || !s7150_encode(&back, out) || memcmp(out, s, S7150_LEN))
+    return 0;
+return s7150_regen(&rec, raw) == S7150_RAWLEN && !memcmp(raw, s, S7150_LEN) && raw[S7150_LEN] == '\r';
+}
+
+
+void fail (const char *what, const char *s)
+{
+printf("  %s: '%s'\n", what, s);
+nfail++;
+}
+
+
+/********************************************************
+* corpus:   Round trip of all readings in a data file   *
+*           (s7150 or s7150duo).                        *
+* Input:    name of the file                            *
+* Return:   number of readings                          *
+********************************************************/
+long corpus (const char *fname)
+{
+FILE    *fp;
+char    line[4*MAXLEN], s[S7150_LEN+1], *p;
+struct  s7150_reading r;
+long    n = 0;
+
+if (NULL == (fp = fopen(fname, "rt")))
+    {
+    fail("could not open", fname);
+    return 0;
+    }
+while (fgets(line, sizeof(line), fp))
+    {
+    if (line[0] == '#')
+        continue;
+    for (p = strchr(line, '\t'); p; p = strchr(p, '\t'))
+        {
+        p++;
+        memset (s, 0, sizeof(s));
+        strncpy (s, p, S7150_LEN);
+        s[strcspn(s, "\t\r\n")] = 0;
+        n++;
+        if (!roundtrip(s, &r))
+            fail("not reproduced", s);
+        }
+    }
+fclose(fp);
+return n;
+}
+
+
+int main (int argc, char *argv[])
+{
+struct  s7150_reading r;
+char    out[S7150_LEN+1];
+unsigned i;
+long    n = 0;
+double  v;
+
+for (i = 0; i < sizeof(good) / sizeof(good[0]); i++)
+    {
+    if (!roundtrip(good[i].s, &r))
+        fail("not reproduced", good[i].s);
+    else if (r.count != good[i].count || r.exp != good[i].exp || r.unit != good[i].unit || \
+             r.acdc != good[i].acdc || r.eflag != good[i].eflag)
+        fail("decoded wrong", good[i].s);
+    v = good[i].count * pow(10.0, good[i].exp);
+    if (fabs(s7150_value(&r) - v) > 1e-12 * fabs(v))
+        fail("wrong value", good[i].s);
+    }
+for (i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    if (s7150_decode(bad[i], &r))
+        fail("not rejected", bad[i]);
+for (i = 0; i < sizeof(noenc) / sizeof(noenc[0]); i++)
+    if (roundtrip(noenc[i], &r))
+        fail("encoded", noenc[i]);
+
+for (i = 0; i < sizeof(mean) / sizeof(mean[0]); i++)
+    {
+    r.count = mean[i].count;
+    r.exp = mean[i].exp;
+    r.unit = mean[i].unit;
+    r.acdc = mean[i].acdc;
+    r.eflag = mean[i].eflag;
+    r.neg = (mean[i].count < 0);
+    v = s7150_value(&r);
+    s7150_round(&r);
+    if (!s7150_encode(&r, out) || strcmp(out, mean[i].s))
+        fail("mean rounded wrong", mean[i].s);
+    else if (fabs(s7150_value(&r) - v) > 0.51 * pow(10.0, r.exp))
+        fail("mean rounded too far", mean[i].s);
+    }
+
+for (i = 1; i < (unsigned) argc; i++)
+    n += corpus(argv[i]);
+
+printf("%u readings of the table, %ld from files: %d failed.\n",
+       (unsigned) (sizeof(good) / sizeof(good[0])), n, nfail);
+return nfail ? 1 : 0;
+}